@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <cstdint>
+#include "network/protocol.hpp"
+
+namespace dkv {
+
+/**
+ * AsyncClient - Thread-safe client for one server that multiplexes requests
+ * from any number of threads over a small pool of pipelined connections.
+ *
+ * Each request is framed into the output buffer of the next connection in
+ * round-robin order and completes through a future or a callback. A single
+ * background I/O thread writes whatever has been queued, so requests from
+ * many callers leave in a few large writes. It completes each request when
+ * its response arrives, matched by id. When a connection fails, its
+ * outstanding requests complete with STATUS_ERROR. The next request routed
+ * to it queues while the I/O thread reconnects with a non-blocking connect;
+ * if that fails, requests to it fail at once for a short backoff, so no
+ * caller ever waits on a connect.
+ */
+class AsyncClient {
+public:
+    // Called once per response, including each STATUS_PARTIAL chunk of a
+    // scan. Runs on the I/O thread, so it must not block. It runs on the
+    // submitting thread if the request could not be queued.
+    using Callback = std::function<void(Response)>;
+
+    explicit AsyncClient(size_t pool_size = DEFAULT_POOL_SIZE);
+    ~AsyncClient();
+
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    // Open every pooled connection and start the I/O thread
+    bool connect(const std::string& host, uint16_t port);
+    void disconnect();
+    bool isConnected() const { return running_; }
+
+    void submit(Request req, Callback callback);
+    // Future of the final response; use the callback form to see scan chunks
+    std::future<Response> submit(Request req);
+
+    std::future<std::optional<std::string>> getAsync(const std::string& key);
+    std::future<bool> putAsync(const std::string& key, const std::string& value);
+    std::future<bool> delAsync(const std::string& key);
+
+    // Blocking forms, safe to call from any number of threads at once
+    std::optional<std::string> get(const std::string& key) { return getAsync(key).get(); }
+    bool put(const std::string& key, const std::string& value) { return putAsync(key, value).get(); }
+    bool del(const std::string& key) { return delAsync(key).get(); }
+    bool ping();
+
+    size_t poolSize() const { return pool_size_; }
+
+    static constexpr size_t DEFAULT_POOL_SIZE = 4;
+
+private:
+    struct Conn;
+
+    void ioLoop();
+    bool openConnection(Conn& conn);       // Blocking; only for connect()
+    bool startConnectLocked(Conn& conn);   // Non-blocking; the I/O thread finishes it
+    static void connectedLocked(Conn& conn);
+    static bool flushLocked(Conn& conn);  // Write queued requests; false on a socket error
+    // Read whatever has arrived; false if the connection failed
+    bool readResponses(Conn& conn, std::vector<std::pair<Callback, Response>>& done);
+    // backoff: the connect failed, so fail requests for a while before retrying
+    void failConnection(Conn& conn, const std::string& why, bool backoff = false);
+    void wake();
+
+    size_t pool_size_;
+    std::string host_;
+    uint16_t port_ = 0;
+    std::vector<std::unique_ptr<Conn>> conns_;
+    std::atomic<size_t> next_conn_{0};
+    std::atomic<bool> running_{false};
+    int wake_fd_ = -1;           // eventfd: queued output or shutdown
+    std::thread io_thread_;
+    std::vector<uint8_t> read_buffer_;   // I/O thread only
+};
+
+} // namespace dkv
@@ -2,7 +2,10 @@
 
 #include <string>
 #include <optional>
+#include <utility>
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include "network/protocol.hpp"
 
 #ifdef _WIN32
@@ -42,13 +45,47 @@ public:
     bool ping();
     std::optional<std::string> status();
 
+    // Pairs with start <= key < end (empty end = no bound), at most limit of
+    // them (0 = no limit); nullopt if the server reports an error
+    std::optional<std::vector<std::pair<std::string, std::string>>>
+    scan(const std::string& start, const std::string& end = "", uint32_t limit = 0);
+
+    // Batch operations, one round trip each. multiPut and multiDel are
+    // applied atomically; multiGet returns one slot per key, in order, or
+    // nullopt if the server reports an error.
+    std::optional<std::vector<std::optional<std::string>>>
+    multiGet(const std::vector<std::string>& keys);
+    bool multiPut(const std::vector<std::pair<std::string, std::string>>& pairs);
+    bool multiDel(const std::vector<std::string>& keys);
+
+    // Pipelining: submit() assigns the request an id and queues it without
+    // waiting; queued requests go out together on the next wait(). Responses
+    // are matched by id, so they may arrive in any order, and ones that
+    // aren't being waited for yet are held until they are. Callers should
+    // keep the number outstanding bounded (pipeline() does).
+    uint32_t submit(Request req);
+    // Next response for id; a scan answers with STATUS_PARTIAL until its last chunk
+    Response wait(uint32_t id);
+
+    // Send all of requests over this connection with up to PIPELINE_WINDOW
+    // in flight, and return their responses in the same order
+    std::vector<Response> pipeline(std::vector<Request> requests);
+
+    static constexpr size_t PIPELINE_WINDOW = 128;
+
 private:
     Response sendRequest(const Request& req);
-    bool sendMessage(const std::vector<uint8_t>& data);
+    bool flushRequests();
     std::vector<uint8_t> recvMessage();
 
     SocketType sock_ = INVALID_SOCK;
     bool connected_ = false;
+
+    uint32_t next_id_ = 1;
+    std::vector<uint8_t> out_;      // Framed requests not yet written
+    std::vector<uint8_t> in_;       // Received bytes not yet returned as messages
+    size_t in_offset_ = 0;
+    std::unordered_map<uint32_t, std::deque<Response>> inflight_;  // Outstanding ids and their unclaimed responses
 };
 
 } // namespace dkv
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+namespace dkv {
+
+/**
+ * Connection - One accepted socket, owned by the reactor that accepted it.
+ *
+ * Messages are framed with a 4-byte little-endian length prefix. Reads are
+ * parsed into frames incrementally, so a connection only holds a buffer
+ * while a frame is partially received. send() is safe from any thread: it
+ * frames the message into a reusable output buffer, writes it straight to
+ * the socket when it can and leaves the rest for the reactor, and never
+ * waits for the peer. Once MAX_PENDING_OUTPUT is queued the reactor stops
+ * reading the peer's requests until it has taken most of it, and a send
+ * that would queue more than MAX_QUEUED_OUTPUT fails and closes the
+ * connection. While the reactor is handling a batch of pipelined frames
+ * the connection is corked, and their responses go out together afterwards.
+ */
+class Connection {
+public:
+    Connection(int fd, int epoll_fd);
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Queue one framed message; false once the connection is closed
+    bool send(const std::vector<uint8_t>& message);
+    bool send(std::string_view message);
+
+    // Frame a message that knows its encodedSize() and can encodeTo() a
+    // buffer (Request, Response), encoding it straight into the output
+    // buffer instead of serializing it to a vector first
+    template <typename Message>
+    bool send(const Message& message) {
+        std::lock_guard<std::mutex> lock(out_mutex_);
+        if (closed_) {
+            return false;
+        }
+        bool idle = out_offset_ == out_.size();
+        message.encodeTo(appendFrameLocked(message.encodedSize()));
+        return finishSendLocked(idle);
+    }
+
+    // Hang up; the owning reactor releases the socket
+    void close();
+    bool isOpen() const { return !closed_; }
+
+private:
+    friend class EventServer;
+
+    bool flushLocked();        // Write queued output; false on a socket error
+    uint8_t* appendFrameLocked(size_t len);  // Queue a length header, return room for the body
+    bool finishSendLocked(bool was_idle);
+    void updateInterest(bool want_write, bool pause_reading);
+    void cork();               // Queue sends instead of writing them
+    bool uncork();             // Write everything queued; false on a socket error
+
+    int fd_;
+    int epoll_fd_;                 // Owning reactor's epoll instance
+    std::vector<uint8_t> in_;      // Partial frame carried over between reads
+
+    std::mutex out_mutex_;
+    std::vector<uint8_t> out_;
+    size_t out_offset_ = 0;
+    bool want_write_ = false;
+    std::atomic<bool> reading_paused_{false};  // Set with out_mutex_ held
+    bool corked_ = false;
+    std::atomic<bool> closed_{false};
+};
+
+/**
+ * EventServer - Non-blocking TCP server core shared by Server, ReplicaNode
+ * and RaftNode.
+ *
+ * A fixed set of reactor threads each run their own epoll loop. All of them
+ * watch the listening socket (EPOLLEXCLUSIVE), so whichever is woken
+ * accepts the connection and serves it from then on; connecting never
+ * spawns a thread. Each complete frame is passed to the handler on the
+ * reactor thread, so a handler that blocks delays other connections on the
+ * same reactor. The message is a view into the receive buffer and is only
+ * valid for the duration of the call.
+ */
+class EventServer {
+public:
+    using MessageHandler =
+        std::function<void(const std::shared_ptr<Connection>& conn, std::string_view message)>;
+
+    // num_reactors = 0 uses one per hardware thread
+    EventServer(uint16_t port, MessageHandler handler, size_t num_reactors = 0);
+    ~EventServer();
+
+    EventServer(const EventServer&) = delete;
+    EventServer& operator=(const EventServer&) = delete;
+
+    // Bind and start the reactors; throws std::runtime_error on failure
+    void start();
+    void stop();
+
+    uint16_t port() const { return port_; }  // Bound port, useful when constructed with 0
+    size_t connectionCount() const { return connections_; }
+
+    static constexpr size_t MAX_MESSAGE_SIZE = 10 * 1024 * 1024;
+    static constexpr size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;   // Stop reading requests past this
+    static constexpr size_t MAX_QUEUED_OUTPUT = 64 * 1024 * 1024;   // Close the connection past this
+
+private:
+    struct Reactor;
+
+    void reactorLoop(Reactor& reactor);
+    void acceptConnections(Reactor& reactor);
+    bool readConnection(Reactor& reactor, const std::shared_ptr<Connection>& conn);
+    void destroyConnection(Reactor& reactor, Connection* conn);
+
+    uint16_t port_;
+    MessageHandler handler_;
+    size_t num_reactors_;
+    int listen_fd_ = -1;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> connections_{0};
+};
+
+} // namespace dkv
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace dkv {
@@ -11,6 +14,10 @@ enum class OpCode : uint8_t {
     OP_GET = 2,
     OP_DELETE = 3,
     OP_PING = 4,
+    OP_SCAN = 5,                 // Range read, answered with a stream of ScanChunks
+    OP_MGET = 6,                 // Batch read, keys in a MultiRequest, answered with a MultiGetResult
+    OP_MPUT = 7,                 // Batch write of MultiRequest pairs, applied atomically
+    OP_MDEL = 8,                 // Batch delete of MultiRequest keys, applied atomically
     // Replication opcodes (legacy)
     OP_REPLICATE = 10,
     OP_REPLICATE_ACK = 11,
@@ -21,31 +28,138 @@ enum class OpCode : uint8_t {
     OP_REQUEST_VOTE = 20,        // Candidate -> All: request vote
     OP_REQUEST_VOTE_RESP = 21,   // Response to vote request
     OP_APPEND_ENTRIES = 22,      // Leader -> Follower: heartbeat + log replication
-    OP_APPEND_ENTRIES_RESP = 23  // Follower -> Leader: response
+    OP_APPEND_ENTRIES_RESP = 23, // Follower -> Leader: response
+    OP_INSTALL_SNAPSHOT = 24,    // Leader -> Follower: one chunk of a snapshot
+    OP_INSTALL_SNAPSHOT_RESP = 25
 };
 
 enum class StatusCode : uint8_t {
     STATUS_OK = 0,
     STATUS_NOT_FOUND = 1,
-    STATUS_ERROR = 2
+    STATUS_ERROR = 2,
+    STATUS_PARTIAL = 3           // More responses follow for the same request
 };
 
+/**
+ * Every Request carries an id that the server copies into each Response it
+ * sends for it, so a client can keep many requests in flight on one
+ * connection and match the answers even if they come back out of order.
+ *
+ * Request:  op | id | keyLen | key | valLen | value
+ * Response: status | id | valLen | value | errLen | error
+ */
 struct Request {
     OpCode op;
     std::string key;
     std::string value;
+    uint32_t id = 0;
     
+    size_t encodedSize() const;           // Exact length of serialize()
+    void encodeTo(uint8_t* out) const;    // Write encodedSize() bytes at out
     std::vector<uint8_t> serialize() const;
     static Request deserialize(const std::vector<uint8_t>& data);
 };
 
+/**
+ * Views parse a received frame in place: their byte fields point into the
+ * buffer they were parsed from, which must outlive them. Servers handle
+ * requests through views, so keys and values are only copied when they are
+ * stored (the LSM tree, a log entry, toRequest()). Parsing throws
+ * std::runtime_error on a malformed frame, like deserialize().
+ */
+struct RequestView {
+    OpCode op;
+    std::string_view key;
+    std::string_view value;
+    uint32_t id = 0;
+
+    static RequestView parse(std::string_view data);
+    Request toRequest() const;
+};
+
 struct Response {
     StatusCode status;
     std::string value;
     std::string error;
+    uint32_t id = 0;     // Id of the request being answered
     
+    size_t encodedSize() const;           // Exact length of serialize()
+    void encodeTo(uint8_t* out) const;    // Write encodedSize() bytes at out
     std::vector<uint8_t> serialize() const;
     static Response deserialize(const std::vector<uint8_t>& data);
+    static Response deserialize(std::string_view data);
+};
+
+/**
+ * Append message (a Request or Response) to out as one wire frame: a 4-byte
+ * little-endian length, then the encoding. out grows once by exactly the
+ * frame size, so a reused buffer frames without allocating and the whole
+ * frame can go out in one send.
+ */
+template <typename Message>
+void appendFrame(std::vector<uint8_t>& out, const Message& message) {
+    size_t len = message.encodedSize();
+    size_t offset = out.size();
+    out.resize(offset + 4 + len);
+
+    uint8_t* p = out.data() + offset;
+    p[0] = (len >> 0) & 0xFF;
+    p[1] = (len >> 8) & 0xFF;
+    p[2] = (len >> 16) & 0xFF;
+    p[3] = (len >> 24) & 0xFF;
+    message.encodeTo(p + 4);
+}
+
+template <typename Message>
+std::vector<uint8_t> encodeFrame(const Message& message) {
+    std::vector<uint8_t> out;
+    appendFrame(out, message);
+    return out;
+}
+
+// OP_SCAN arguments, carried in Request::value (Request::key is the start key)
+struct ScanRequest {
+    std::string end;     // Exclusive upper bound, empty for none
+    uint32_t limit = 0;  // Maximum number of pairs, 0 for no limit
+
+    std::vector<uint8_t> serialize() const;
+    static ScanRequest deserialize(std::string_view data);
+};
+
+// One batch of OP_SCAN results, carried in Response::value. Every chunk but
+// the last is sent with STATUS_PARTIAL; the last one has STATUS_OK.
+struct ScanChunk {
+    std::vector<std::pair<std::string, std::string>> entries;  // Key order
+
+    std::vector<uint8_t> serialize() const;
+    static ScanChunk deserialize(const std::vector<uint8_t>& data);
+};
+
+// Keys for OP_MGET and OP_MDEL, or key/value pairs for OP_MPUT, carried in
+// Request::value. Counts and lengths are varints, so a small key costs a
+// single byte of framing.
+struct MultiRequest {
+    std::vector<std::string> keys;
+    std::vector<std::string> values;  // OP_MPUT only, one per key
+
+    std::vector<uint8_t> serialize() const;
+    static MultiRequest deserialize(std::string_view data);
+};
+
+struct MultiRequestView {
+    std::vector<std::string_view> keys;
+    std::vector<std::string_view> values;
+
+    static MultiRequestView parse(std::string_view data);
+};
+
+// OP_MGET answer in Response::value: one slot per requested key, in request
+// order, empty where the key has no value
+struct MultiGetResult {
+    std::vector<std::optional<std::string>> values;
+
+    std::vector<uint8_t> serialize() const;
+    static MultiGetResult deserialize(const std::vector<uint8_t>& data);
 };
 
 // Replication entry for leader-follower sync
@@ -82,10 +196,23 @@ struct RaftLogEntry {
     std::string key;
     std::string value;
     
+    size_t encodedSize() const;           // Exact length of serialize()
+    void encodeTo(uint8_t* out) const;    // Write encodedSize() bytes at out
     std::vector<uint8_t> serialize() const;
     static RaftLogEntry deserialize(const std::vector<uint8_t>& data);
 };
 
+struct RaftLogEntryView {
+    uint64_t term;
+    uint64_t index;
+    OpCode op;
+    std::string_view key;
+    std::string_view value;
+
+    static RaftLogEntryView parse(std::string_view data);
+    RaftLogEntry toEntry() const;
+};
+
 // RequestVote RPC
 struct RequestVote {
     uint64_t term;           // Candidate's term
@@ -118,13 +245,53 @@ struct AppendEntries {
     static AppendEntries deserialize(const std::vector<uint8_t>& data);
 };
 
+struct AppendEntriesView {
+    uint64_t term;
+    std::string_view leader_id;
+    uint64_t prev_log_index;
+    uint64_t prev_log_term;
+    std::vector<RaftLogEntryView> entries;
+    uint64_t leader_commit;
+
+    static AppendEntriesView parse(std::string_view data);
+};
+
 struct AppendEntriesResponse {
     uint64_t term;       // Current term, for leader to update itself
     bool success;        // True if follower contained entry matching prev_log
     uint64_t match_index; // Highest log index known to be replicated
+    // On a mismatch, so the leader can skip a whole term per round trip:
+    uint64_t conflict_term = 0;   // Term of the follower's entry at prev_log_index, 0 if it has none
+    uint64_t conflict_index = 0;  // First index of conflict_term, or the follower's last index + 1
     
     std::vector<uint8_t> serialize() const;
     static AppendEntriesResponse deserialize(const std::vector<uint8_t>& data);
 };
 
+// InstallSnapshot RPC: one chunk of one file of the leader's snapshot,
+// sent to a follower that needs entries the leader has compacted away.
+// Files go one after another, each from offset 0; the chunk with done set
+// is the last one, and installs the snapshot.
+struct InstallSnapshot {
+    uint64_t term;                 // Leader's term
+    std::string leader_id;
+    uint64_t last_included_index;  // The snapshot replaces the log up to here
+    uint64_t last_included_term;
+    std::string file;              // Name within the snapshot
+    uint64_t offset;               // Where data goes in file
+    std::string data;
+    bool done;
+    
+    std::vector<uint8_t> serialize() const;
+    static InstallSnapshot deserialize(std::string_view data);
+};
+
+struct InstallSnapshotResponse {
+    uint64_t term;       // Current term, for leader to update itself
+    bool success;        // False if the chunk was out of order; start over
+    
+    std::vector<uint8_t> serialize() const;
+    static InstallSnapshotResponse deserialize(std::string_view data);
+};
+
 } // namespace dkv
@@ -2,33 +2,18 @@
 
 #include <string>
 #include <memory>
-#include <thread>
 #include <atomic>
 #include <vector>
+#include <functional>
 #include "storage/lsm_tree.hpp"
 #include "network/protocol.hpp"
-
-#ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-using SocketType = SOCKET;
-#define INVALID_SOCK INVALID_SOCKET
-#define CLOSE_SOCKET closesocket
-#else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <unistd.h>
-using SocketType = int;
-#define INVALID_SOCK -1
-#define CLOSE_SOCKET close
-#endif
+#include "network/event_server.hpp"
 
 namespace dkv {
 
 class Server {
 public:
-    Server(const std::string& data_dir, uint16_t port);
+    Server(const std::string& data_dir, uint16_t port, size_t num_reactors = 0);
     ~Server();
 
     Server(const Server&) = delete;
@@ -37,22 +22,28 @@ public:
     void start();
     void stop();
     bool isRunning() const { return running_; }
+    uint16_t port() const { return events_.port(); }
 
 private:
-    void acceptLoop();
-    void handleClient(SocketType client_sock);
-    Response processRequest(const Request& req);
-    
-    bool sendMessage(SocketType sock, const std::vector<uint8_t>& data);
-    std::vector<uint8_t> recvMessage(SocketType sock);
-
-    uint16_t port_;
-    SocketType server_sock_ = INVALID_SOCK;
+    void handleMessage(const std::shared_ptr<Connection>& conn, std::string_view data);
+    Response processRequest(const RequestView& req);
+
     std::atomic<bool> running_{false};
     std::unique_ptr<LSMTree> store_;
-    std::thread accept_thread_;
-    std::vector<std::thread> client_threads_;
-    std::mutex threads_mutex_;
+    EventServer events_;
 };
 
+/**
+ * Answer an OP_SCAN from store. Results are sent as they are merged, in
+ * ScanChunks of about SCAN_CHUNK_BYTES, so a large range is never held in
+ * memory at once. send returns false once the client has gone away.
+ */
+bool streamScan(const LSMTree& store, const RequestView& req,
+                const std::function<bool(const Response&)>& send);
+
+constexpr size_t SCAN_CHUNK_BYTES = 64 * 1024;
+
+// Answer an OP_MGET from store with one MultiGetResult
+Response serveMultiGet(const LSMTree& store, const RequestView& req);
+
 } // namespace dkv
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "network/protocol.hpp"
+
+namespace dkv {
+
+struct RaftLogOptions {
+    uint64_t segment_bytes = 64 * 1024 * 1024;  // Start a new segment once one grows past this
+    size_t cache_entries = 4096;                // Newest entries kept in memory
+};
+
+/**
+ * RaftLog - Durable Raft log kept in append-only segment files.
+ *
+ * Segments live in their own directory, each named after the index of its
+ * first entry, and hold records framed as
+ *   crc32c(payload) | payload length | RaftLogEntry encoding
+ * In memory the log keeps the term and file offset of every entry plus a
+ * bounded cache of the newest entries; older entries are read back from
+ * their segment when asked for. append() writes straight away but nothing is
+ * durable until sync(), so a whole batch of appends costs one fdatasync.
+ * Truncating a suffix deletes the later segments outright and cuts the one
+ * holding the first removed entry. Opening the log rebuilds the index from
+ * the segments and cuts off a torn or corrupt tail.
+ *
+ * Index 0 is never stored: an empty log has lastIndex() 0, and termAt(0) is
+ * 0 to match the prev_log_index/prev_log_term sent with the first entry.
+ *
+ * Once a snapshot covers a prefix, compact() drops it: whole segments below
+ * the new first index are deleted, and termAt() still answers for the entry
+ * just before it. That base is not persisted here; after a restart the
+ * owner calls compact() again with the snapshot it recovers.
+ * All methods are thread-safe.
+ */
+class RaftLog {
+public:
+    explicit RaftLog(const std::string& dir, RaftLogOptions options = {});
+    ~RaftLog();
+
+    RaftLog(const RaftLog&) = delete;
+    RaftLog& operator=(const RaftLog&) = delete;
+
+    uint64_t firstIndex() const;   // Oldest entry held; lastIndex() + 1 when empty
+    uint64_t lastIndex() const;
+    uint64_t lastTerm() const;
+    // Term of the entry at index, or of the last compacted one at
+    // firstIndex() - 1; 0 for index 0 and anything else outside the log
+    uint64_t termAt(uint64_t index) const;
+    // Throws std::out_of_range if the log has no entry at index
+    RaftLogEntry entry(uint64_t index) const;
+    // Entries from..to inclusive, clamped to the log, at most max_entries of
+    // them, stopping once they add up to max_bytes of encoded entries (but
+    // always at least one). Entries older than the cache are read with one
+    // pread per segment rather than two per entry.
+    std::vector<RaftLogEntry> entries(uint64_t from, uint64_t to,
+                                      size_t max_entries = std::numeric_limits<size_t>::max(),
+                                      size_t max_bytes = std::numeric_limits<size_t>::max()) const;
+    // First and last index holding an entry of term, 0 if there is none.
+    // Terms never decrease along a Raft log, so both are binary searches.
+    uint64_t firstIndexOfTerm(uint64_t term) const;
+    uint64_t lastIndexOfTerm(uint64_t term) const;
+
+    // Append at lastIndex() + 1, whatever entry.index says; returns the new index
+    uint64_t append(RaftLogEntry entry);
+    // Append several entries with one write; returns the last new index
+    uint64_t append(std::vector<RaftLogEntry> entries);
+    // Remove the entry at index and everything after it
+    void truncateFrom(uint64_t index);
+    // Make every append and truncation so far durable; cheap when there are none
+    void sync();
+    // Drop every entry up to and including index, which has the given term
+    // and is covered by a snapshot. Past the end, this empties the log and
+    // the next append gets index + 1.
+    void compact(uint64_t index, uint64_t term);
+
+    size_t segmentCount() const;
+
+private:
+    struct Segment {
+        uint64_t first_index;
+        std::string path;
+        int fd = -1;
+        uint64_t size = 0;   // Bytes written, excluding pending_
+    };
+
+    void recover();
+    void openNewSegment(uint64_t first_index);
+    void appendLocked(RaftLogEntry& entry);
+    void writePending();
+    void truncateLocked(uint64_t index);
+    uint64_t lastIndexLocked() const { return first_index_ + terms_.size() - 1; }
+    RaftLogEntry entryLocked(uint64_t index) const;
+    void readRunLocked(uint64_t& index, uint64_t to, size_t max_entries, size_t max_bytes,
+                       std::vector<RaftLogEntry>& out, size_t& bytes) const;
+    const Segment& segmentFor(uint64_t index) const;
+
+    std::string dir_;
+    RaftLogOptions options_;
+    mutable std::mutex mutex_;
+    std::vector<Segment> segments_;   // Oldest first; the last one takes appends
+    uint64_t first_index_ = 1;
+    uint64_t base_term_ = 0;          // Term of entry first_index_ - 1
+    std::vector<uint64_t> terms_;     // terms_[i] belongs to entry first_index_ + i
+    std::vector<uint64_t> offsets_;   // Record offset of each entry within its segment
+    std::deque<RaftLogEntry> cache_;  // Newest entries, always ending at the last index
+    std::vector<uint8_t> pending_;    // Records framed for the active segment, not yet written
+    bool dirty_ = false;              // Active segment changed since the last sync
+    bool dir_dirty_ = false;          // Segments created or removed since the last sync
+};
+
+} // namespace dkv
@@ -9,9 +9,15 @@
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <deque>
+#include <optional>
+#include <chrono>
 #include "storage/lsm_tree.hpp"
 #include "network/protocol.hpp"
+#include "network/event_server.hpp"
 #include "raft/raft_state.hpp"
+#include "raft/raft_log.hpp"
+#include "raft/raft_snapshot.hpp"
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -32,13 +38,34 @@ using SocketType = int;
 
 namespace dkv {
 
-// Peer connection info
+// Peer connection info, plus the replicator thread that feeds this peer
 struct PeerInfo {
     std::string id;        // peer_host:peer_port
     std::string host;
     uint16_t port;
     SocketType socket = INVALID_SOCK;
-    bool connected = false;
+    std::atomic<bool> connected{false};
+    std::mutex io_mutex;   // Held for a whole RPC, so one exchange at a time on socket
+    
+    std::thread replicator;
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    bool wake = false;     // New entries to send; guarded by wake_mutex
+    // Until an AppendEntries succeeds, next_index is a guess and RPCs go out
+    // one at a time; after that they are pipelined
+    std::atomic<bool> probing{true};
+    // Latest read round an answer from this peer has confirmed leadership for
+    std::atomic<uint64_t> read_ack{0};
+};
+
+struct RaftOptions {
+    size_t max_append_entries = 1000;             // Entries per AppendEntries RPC
+    size_t max_append_bytes = 1024 * 1024;        // Entry bytes per AppendEntries RPC
+    size_t max_inflight_appends = 8;              // Unanswered AppendEntries per peer
+    size_t max_inflight_bytes = 8 * 1024 * 1024;  // Unanswered entry bytes per peer
+    uint64_t snapshot_entries = 10000;            // Applied entries between snapshots; 0 never snapshots
+    uint64_t snapshot_trailing_entries = 1000;    // Entries kept in the log behind a snapshot
+    size_t snapshot_chunk_bytes = 1024 * 1024;    // Data per InstallSnapshot RPC
 };
 
 /**
@@ -47,12 +74,51 @@ struct PeerInfo {
  * Handles:
  * - Leader election via RequestVote RPCs
  * - Log replication via AppendEntries RPCs
- * - Client requests (PUT, GET, DELETE)
+ * - Client requests (PUT, GET, DELETE, and the MPUT/MGET/MDEL batches)
+ *
+ * Writes are proposals: the reactor that receives a PUT or DELETE queues it
+ * and returns to its other connections. Each leader tick appends everything
+ * queued since the last one with a single write and fsync, and replicates it
+ * to every peer in one AppendEntries, so concurrent writers share both the
+ * disk flush and the round trip. A client is answered only after its entry
+ * is committed and applied, from a waiter registered under the entry's log
+ * index; if this node loses leadership first, its waiters get an error.
+ * An MPUT or MDEL is one entry carrying its MultiRequest, so the whole batch
+ * commits and applies together.
+ *
+ * Every peer has its own replicator thread and socket. A replicator sleeps
+ * until the leader has new entries for it or a heartbeat is due, then keeps
+ * sending AppendEntries until the peer has caught up. A slow or unreachable
+ * follower only ever blocks its own replicator, and the commit index moves
+ * as soon as any majority has answered.
+ *
+ * Once a peer has accepted an AppendEntries, its replicator pipelines them:
+ * next_index moves past each batch as soon as it is sent, and more batches
+ * follow while fewer than max_inflight_appends RPCs (and max_inflight_bytes
+ * of entries) are unanswered. Answers come back in order on the same socket.
+ * A rejection carries the follower's conflicting term and that term's first
+ * index, so the leader backs up a whole term per round trip and then probes
+ * one RPC at a time until the logs match again.
+ *
+ * Every snapshot_entries applied entries, the node checkpoints its store as
+ * a RaftSnapshot and drops the log up to snapshot_trailing_entries behind
+ * it. A follower that needs an entry the leader no longer has is sent the
+ * snapshot's files instead, in InstallSnapshot chunks, and replaces its
+ * store with them before AppendEntries resumes after the snapshot.
+ *
+ * GET and MGET on the leader are linearizable without touching the log
+ * (ReadIndex): reads that arrive together wait for one confirmation round,
+ * which records the commit index and is confirmed once a majority has
+ * answered an AppendEntries sent after it started. The reads are then served
+ * from the store as soon as it has applied that index. A new leader first
+ * commits a no-op entry of its own term, and a round not confirmed within an
+ * election timeout fails its reads, so a deposed leader never answers from
+ * stale state. Followers still answer reads from their own store.
  */
 class RaftNode {
 public:
     RaftNode(const std::string& data_dir, uint16_t port, 
-             const std::vector<std::string>& peers);
+             const std::vector<std::string>& peers, RaftOptions options = {});
     ~RaftNode();
 
     RaftNode(const RaftNode&) = delete;
@@ -70,29 +136,60 @@ public:
 
 private:
     // Main loops
-    void acceptLoop();           // Accept client connections
     void raftLoop();             // Election timeout & heartbeat logic
     void peerConnectionLoop();   // Maintain peer connections
     
-    // Client handling
-    void handleClient(SocketType client_sock);
-    Response processClientRequest(const Request& req);
+    // Client and peer RPC handling
+    void handleMessage(const std::shared_ptr<Connection>& conn, std::string_view data);
+    Response processClientRequest(const RequestView& req);
+    void proposeWrite(const std::shared_ptr<Connection>& conn, const RequestView& req);
+    void proposeRead(const std::shared_ptr<Connection>& conn, std::string_view data);
     
     // Raft RPCs
     void startElection();
     void requestVoteFromPeer(PeerInfo& peer);
     RequestVoteResponse handleRequestVote(const RequestVote& rv);
     
-    void sendHeartbeats();
-    void sendAppendEntriesToPeer(PeerInfo& peer);
-    AppendEntriesResponse handleAppendEntries(const AppendEntries& ae);
+    struct InflightAppend {
+        uint32_t id;
+        uint64_t term;         // Leader term it was sent in
+        uint64_t last_index;   // Last index it carries, prev_log_index if none
+        size_t bytes;          // Encoded size of its entries
+        bool stale = false;    // Sent before a rejection reset next_index
+        uint64_t read_round = 0;  // Read round in progress when it was sent
+    };
+    void replicatorLoop(PeerInfo& peer);
+    void wakeReplicators();
+    void replicateToPeer(PeerInfo& peer);
+    bool sendAppendEntriesToPeer(PeerInfo& peer, bool heartbeat, InflightAppend& rpc);
+    bool handleAppendEntriesReply(PeerInfo& peer, const InflightAppend& rpc,
+                                  const std::vector<uint8_t>& data);
+    AppendEntriesResponse handleAppendEntries(const AppendEntriesView& ae);
+    bool needsSnapshot(PeerInfo& peer);
+    bool sendSnapshotToPeer(PeerInfo& peer);
+    InstallSnapshotResponse handleInstallSnapshot(const InstallSnapshot& is);
     
     // Log management
-    uint64_t appendLog(OpCode op, const std::string& key, const std::string& value);
+    bool appendProposals();          // Leader: move queued proposals into the log
+    void advanceCommitIndex();       // Leader: commit what a majority has stored
     RaftLogEntry getLogEntry(uint64_t index) const;
     uint64_t getLastLogIndex() const;
     uint64_t getLastLogTerm() const;
     void applyCommittedEntries();
+    void failWaiters(const std::string& error);
+    
+    // Linearizable reads (ReadIndex)
+    void startReadRound();           // Leader: confirm leadership for queued reads
+    void confirmReads();             // Leader: called with leader_mutex_ held
+    void serveReads();               // Answer confirmed reads the store has caught up with
+    void failReads(const std::string& error);
+    
+    // Snapshots
+    void recoverSnapshot();
+    void maybeSnapshot();            // Snapshot and compact once enough is applied
+    void installPendingSnapshot();   // Follower: restore the store from a received snapshot
+    void installSnapshot(const std::shared_ptr<RaftSnapshot>& snapshot);
+    std::shared_ptr<RaftSnapshot> currentSnapshot() const;
     
     // State transitions
     void becomeFollower(uint64_t term);
@@ -104,7 +201,7 @@ private:
     void disconnectPeer(PeerInfo& peer);
     bool sendMessage(SocketType sock, OpCode op, const std::vector<uint8_t>& data);
     std::pair<OpCode, std::vector<uint8_t>> recvMessage(SocketType sock);
-    bool sendRawMessage(SocketType sock, const std::vector<uint8_t>& data);
+    bool sendFrame(SocketType sock, const std::vector<uint8_t>& frame);  // From encodeFrame()
     std::vector<uint8_t> recvRawMessage(SocketType sock);
     
     // Status response for clients
@@ -113,7 +210,8 @@ private:
     // Configuration
     uint16_t port_;
     std::string data_dir_;
-    std::vector<PeerInfo> peers_;
+    RaftOptions options_;
+    std::vector<std::unique_ptr<PeerInfo>> peers_;
     
     // State
     RaftState state_;
@@ -121,27 +219,68 @@ private:
     
     // Storage
     std::unique_ptr<LSMTree> store_;
-    std::vector<RaftLogEntry> log_;  // Raft log (index 0 is dummy)
-    mutable std::mutex log_mutex_;
+    RaftLog log_;                    // Durable log in data_dir/raft_log
+    std::mutex log_mutex_;           // Serializes check-then-modify sequences on log_
+    std::mutex apply_mutex_;         // Held while the store moves forward: apply, snapshot, install
+    
+    // Latest snapshot; a replicator sending it keeps its own reference
+    std::shared_ptr<RaftSnapshot> snapshot_;
+    mutable std::mutex snapshot_mutex_;
+    // Follower: the snapshot being received, 0 if none
+    uint64_t incoming_snapshot_ = 0;
+    // Follower: received in full and durable, for the raft thread to
+    // install; guarded by raft_mutex_
+    std::shared_ptr<RaftSnapshot> pending_install_;
+    std::mutex incoming_mutex_;
+    
+    // Client writes waiting to be appended, and then to be applied
+    struct Proposal {
+        std::shared_ptr<Connection> conn;
+        uint32_t request_id;
+        RaftLogEntry entry;
+    };
+    struct Waiter {
+        std::shared_ptr<Connection> conn;
+        uint32_t request_id;
+        uint64_t term;                   // Term the entry was appended in
+    };
+    std::deque<Proposal> proposals_;     // Guarded by raft_mutex_
+    std::map<uint64_t, Waiter> waiters_; // By log index
+    std::mutex waiters_mutex_;
+    std::atomic<uint64_t> leader_term_{0};  // Term this node last became leader in
+    
+    // Client reads waiting for the leader to confirm it still leads, then
+    // for the store to apply the commit index recorded when they arrived
+    struct ReadRequest {
+        std::shared_ptr<Connection> conn;
+        std::string data;                // The request, parsed again to serve it
+    };
+    struct ReadBatch {
+        uint64_t round;
+        uint64_t read_index;             // Commit index when the round started
+        std::chrono::steady_clock::time_point started;
+        std::vector<ReadRequest> reads;
+    };
+    std::vector<ReadRequest> reads_;     // Guarded by raft_mutex_, as are the next three
+    std::optional<ReadBatch> read_batch_;  // The round in progress
+    std::deque<ReadBatch> confirmed_reads_;
+    bool read_work_ = false;             // Reads arrived or were confirmed
+    std::atomic<uint64_t> read_round_{0};
     
     // Election state
     std::atomic<int> votes_received_{0};
     std::mutex election_mutex_;
     
-    // Server socket
-    SocketType server_sock_ = INVALID_SOCK;
-    
     // Threads
-    std::thread accept_thread_;
     std::thread raft_thread_;
     std::thread peer_thread_;
-    std::vector<std::thread> client_threads_;
-    std::mutex threads_mutex_;
-    std::mutex peers_mutex_;
+    std::mutex leader_mutex_;        // Guards leader_state() and commit advancement
     
     // Condition variable for raft loop
     std::condition_variable raft_cv_;
     std::mutex raft_mutex_;
+
+    EventServer events_;
 };
 
 } // namespace dkv
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "storage/lsm_tree.hpp"
+
+namespace dkv {
+
+/**
+ * RaftSnapshot - The state machine as of one applied log index.
+ *
+ * A snapshot is a directory data_dir/snapshot-<index> holding an LSMTree
+ * checkpoint (hard-linked SSTables and their MANIFEST) and a META file with
+ * the index and term of the last entry it covers. It is assembled under a
+ * temporary name and renamed into place once META is written, so every
+ * directory with a final name is complete. Every snapshot is made durable
+ * before it is renamed into place, since the log below it is then dropped.
+ *
+ * A snapshot received from the leader carries an INSTALL marker until the
+ * store has been restored from it, so a restart in between finishes the
+ * install.
+ *
+ * A replaced snapshot is marked obsolete and its directory removed when the
+ * last holder lets go, so a replicator can finish streaming it to a follower
+ * while a newer one is taken.
+ */
+class RaftSnapshot {
+public:
+    RaftSnapshot(std::string dir, uint64_t last_index, uint64_t last_term, bool pending_install = false);
+    ~RaftSnapshot();
+
+    RaftSnapshot(const RaftSnapshot&) = delete;
+    RaftSnapshot& operator=(const RaftSnapshot&) = delete;
+
+    // Checkpoint store, whose contents are the log applied through index
+    static std::shared_ptr<RaftSnapshot> create(const std::string& data_dir, LSMTree& store,
+                                                uint64_t index, uint64_t term);
+    // Where a follower collects the files of a snapshot sent by its leader
+    static std::string incomingDir(const std::string& data_dir, uint64_t index);
+    // Complete a snapshot whose files were received into incomingDir(),
+    // durably and marked as pending install
+    static std::shared_ptr<RaftSnapshot> install(const std::string& data_dir,
+                                                 uint64_t index, uint64_t term);
+    // Newest complete snapshot in data_dir, or nullptr; removes the others
+    // and any left unfinished
+    static std::shared_ptr<RaftSnapshot> loadLatest(const std::string& data_dir);
+
+    uint64_t lastIndex() const { return last_index_; }
+    uint64_t lastTerm() const { return last_term_; }
+    const std::string& dir() const { return dir_; }
+
+    // Files a follower needs, in sending order: the SSTables, then MANIFEST
+    std::vector<std::string> files() const;
+
+    // Received, but the store has not been restored from it yet
+    bool pendingInstall() const { return pending_install_; }
+    void markInstalled();
+
+    void markObsolete() { obsolete_ = true; }
+
+private:
+    static std::shared_ptr<RaftSnapshot> finish(const std::string& data_dir, const std::string& from,
+                                                 uint64_t index, uint64_t term, bool received);
+
+    std::string dir_;
+    uint64_t last_index_;
+    uint64_t last_term_;
+    bool pending_install_;
+    std::atomic<bool> obsolete_{false};
+};
+
+} // namespace dkv
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <optional>
@@ -27,8 +28,8 @@ struct PersistentState {
  * Volatile state on all servers
  */
 struct VolatileState {
-    uint64_t commit_index = 0;   // Index of highest log entry known to be committed
-    uint64_t last_applied = 0;  // Index of highest log entry applied to state machine
+    std::atomic<uint64_t> commit_index{0};   // Index of highest log entry known to be committed
+    std::atomic<uint64_t> last_applied{0};   // Index of highest log entry applied to state machine
 };
 
 /**
@@ -82,6 +83,7 @@ public:
     // Heartbeat timing
     void resetHeartbeatTimer();
     bool shouldSendHeartbeat() const;
+    int getHeartbeatIntervalMs() const { return HEARTBEAT_INTERVAL_MS; }
     
     // Persist to disk
     void persist();
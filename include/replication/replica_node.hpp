@@ -10,6 +10,7 @@
 #include <condition_variable>
 #include "storage/lsm_tree.hpp"
 #include "network/protocol.hpp"
+#include "network/event_server.hpp"
 #include "replication/replication_log.hpp"
 
 #ifdef _WIN32
@@ -34,7 +35,7 @@ namespace dkv {
 // Information about a connected follower
 struct FollowerInfo {
     std::string node_id;
-    SocketType socket;
+    std::shared_ptr<Connection> conn;  // The follower's connection to us
     uint64_t last_acked_seq;
     std::chrono::steady_clock::time_point last_heartbeat;
     bool connected;
@@ -70,25 +71,25 @@ public:
     std::vector<std::string> getFollowerIds() const;
 
 private:
-    // Server functionality (accepts client and follower connections)
-    void acceptLoop();
-    void handleClient(SocketType client_sock);
-    Response processRequest(const Request& req, bool from_replication = false);
+    // Server functionality (serves client and follower connections)
+    void handleMessage(const std::shared_ptr<Connection>& conn, std::string_view data);
+    Response processRequest(const RequestView& req, bool from_replication = false);
     
     // Leader functionality
     void replicateToFollowers(const ReplicationEntry& entry);
-    void handleFollowerJoin(SocketType sock, const Request& req);
+    void handleFollowerJoin(const std::shared_ptr<Connection>& conn, const RequestView& req);
     void heartbeatLoop();
     void sendToFollower(FollowerInfo& follower, const std::vector<uint8_t>& data);
     
     // Follower functionality
     void followerLoop();
     void connectToLeader();
-    void handleReplication(const ReplicationEntry& entry);
+    // Apply entries in sequence order as one atomic write
+    void handleReplication(const std::vector<ReplicationEntry>& entries);
     void sendJoinRequest();
     
     // Network helpers
-    bool sendMessage(SocketType sock, const std::vector<uint8_t>& data);
+    bool sendFrame(SocketType sock, const std::vector<uint8_t>& frame);  // From encodeFrame()
     std::vector<uint8_t> recvMessage(SocketType sock);
     
     // Status response
@@ -102,7 +103,6 @@ private:
     uint16_t leader_port_ = 0;
     
     // State
-    SocketType server_sock_ = INVALID_SOCK;
     SocketType leader_sock_ = INVALID_SOCK;  // Follower's connection to leader
     std::atomic<bool> running_{false};
     
@@ -117,13 +117,13 @@ private:
     // Follower state
     uint64_t last_applied_seq_ = 0;
     std::mutex follower_mutex_;
+    static constexpr size_t MAX_APPLY_BATCH = 1024;  // Replication entries applied per write
     
     // Threads
-    std::thread accept_thread_;
     std::thread follower_thread_;
     std::thread heartbeat_thread_;
-    std::vector<std::thread> client_threads_;
-    std::mutex threads_mutex_;
+
+    EventServer events_;
 };
 
 } // namespace dkv
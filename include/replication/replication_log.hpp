@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <mutex>
 #include <fstream>
@@ -25,7 +26,7 @@ public:
     ReplicationLog& operator=(const ReplicationLog&) = delete;
 
     // Append a new entry and return its sequence number
-    uint64_t append(OpCode op, const std::string& key, const std::string& value);
+    uint64_t append(OpCode op, std::string_view key, std::string_view value);
     
     // Get all entries since (but not including) the given sequence number
     std::vector<ReplicationEntry> getEntriesSince(uint64_t seq_num) const;
@@ -2,8 +2,9 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
+#include <memory>
 #include <set>
 #include <mutex>
 
@@ -14,9 +15,30 @@ namespace dkv {
  * 
  * Uses virtual nodes for better distribution of keys across physical nodes.
  * Hash positions are uint32_t (0 to 2^32-1).
+ *
+ * Lookups read an immutable Snapshot of the ring, published through an
+ * atomic shared_ptr, so routing a key takes no lock and allocates nothing.
+ * addNode() and removeNode() build a new snapshot and swap it in; readers
+ * holding the old one keep using it undisturbed.
  */
 class HashRing {
 public:
+    /**
+     * One version of the ring. Positions are a flat sorted array with a
+     * parallel array of small indices into nodes, so a lookup is a binary
+     * search over contiguous uint32_t values.
+     */
+    struct Snapshot {
+        std::vector<uint32_t> positions;   // Sorted virtual node positions
+        std::vector<uint16_t> owners;      // owners[i] indexes nodes for positions[i]
+        std::vector<std::string> nodes;    // Physical nodes, sorted
+
+        // Node responsible for key; empty if the ring has no nodes
+        const std::string& getNode(std::string_view key) const;
+        // Index into nodes of the first position >= pos, wrapping around
+        size_t ownerIndex(uint32_t pos) const;
+    };
+
     explicit HashRing(int virtual_nodes = 150);
     
     // Add a physical node to the ring
@@ -27,6 +49,10 @@ public:
     
     // Get the node responsible for a key
     std::string getNode(const std::string& key) const;
+
+    // Current ring; route many keys against one snapshot to avoid the copy
+    // getNode() returns
+    std::shared_ptr<const Snapshot> snapshot() const;
     
     // Get all physical nodes
     std::vector<std::string> getNodes() const;
@@ -41,13 +67,15 @@ public:
     void clear();
     
     // Hash a key to a position on the ring
-    uint32_t hash(const std::string& key) const;
+    uint32_t hash(std::string_view key) const;
 
 private:
+    void publish();  // Rebuild the snapshot from physical_nodes_; caller holds mutex_
+
     int virtual_nodes_;                        // Number of virtual nodes per physical node
-    std::map<uint32_t, std::string> ring_;     // position -> node_id
     std::set<std::string> physical_nodes_;     // Set of physical node IDs
-    mutable std::mutex mutex_;
+    std::shared_ptr<const Snapshot> snapshot_; // Read and replaced with std::atomic_load/store
+    std::mutex mutex_;                         // Serializes writers only
     
     // Generate virtual node key
     std::string virtualNodeKey(const std::string& node_id, int index) const;
@@ -5,8 +5,10 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <future>
+#include <shared_mutex>
 #include "shard/hash_ring.hpp"
-#include "network/client.hpp"
+#include "network/async_client.hpp"
 
 namespace dkv {
 
@@ -14,12 +16,22 @@ namespace dkv {
  * ShardedClient - A client that routes requests to the correct shard
  * using consistent hashing.
  * 
- * Each shard is a separate server instance. The client maintains
- * connections to all shards and routes each key to the correct one.
+ * Each shard is a separate server instance. The client keeps an AsyncClient
+ * pool of pipelined connections to every shard and routes each key to the
+ * right one. It is safe to share between threads: requests only take the
+ * shard map's lock long enough to find their shard, so threads never wait
+ * on one another's round trips.
  */
 class ShardedClient {
 public:
-    ShardedClient();
+    // Outcome for one key of a multi-key operation
+    struct KeyResult {
+        std::optional<std::string> value;  // multiGet: the value, if the key exists
+        std::string error;                 // Why the key's shard failed; empty on success
+        bool ok() const { return error.empty(); }
+    };
+
+    explicit ShardedClient(size_t connections_per_shard = AsyncClient::DEFAULT_POOL_SIZE);
     ~ShardedClient();
 
     ShardedClient(const ShardedClient&) = delete;
@@ -38,6 +50,23 @@ public:
     bool put(const std::string& key, const std::string& value);
     std::optional<std::string> get(const std::string& key);
     bool del(const std::string& key);
+
+    std::future<bool> putAsync(const std::string& key, const std::string& value);
+    std::future<std::optional<std::string>> getAsync(const std::string& key);
+    std::future<bool> delAsync(const std::string& key);
+
+    /**
+     * Multi-key operations, one result per key in the order given. Keys are
+     * grouped by shard and each shard gets its batches at the same time, so
+     * the whole call costs about one round trip however many shards are
+     * involved. A shard that fails marks only its own keys as failed. Writes
+     * are atomic per shard batch, not across shards.
+     */
+    std::vector<KeyResult> multiGet(const std::vector<std::string>& keys);
+    std::vector<KeyResult> multiPut(const std::vector<std::pair<std::string, std::string>>& pairs);
+    std::vector<KeyResult> multiDel(const std::vector<std::string>& keys);
+
+    static constexpr size_t MAX_BATCH_KEYS = 1024;  // Larger groups are split
     
     // Utility
     bool ping(const std::string& shard_addr);  // Ping a specific shard
@@ -53,15 +82,17 @@ public:
     size_t shardCount() const;
 
 private:
-    // Get or create connection to a shard
-    Client* getConnection(const std::string& shard_addr);
+    // Connection pool of a shard, or of the shard owning key; null if none
+    std::shared_ptr<AsyncClient> getConnection(const std::string& shard_addr) const;
+    std::shared_ptr<AsyncClient> connectionForKey(const std::string& key) const;
     
     // Parse host:port
     static bool parseAddress(const std::string& addr, std::string& host, uint16_t& port);
 
+    size_t connections_per_shard_;
     HashRing ring_;
-    std::map<std::string, std::unique_ptr<Client>> connections_;
-    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<AsyncClient>> connections_;
+    mutable std::shared_mutex mutex_;  // Guards connections_; requests take it shared
 };
 
 } // namespace dkv
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+
+namespace dkv {
+
+/**
+ * Arena - Bump allocator backing a single memtable.
+ *
+ * Allocations of up to 16KB are carved out of 64KB blocks, so a full 4MB
+ * memtable is about 64 heap allocations whatever its entry count; larger
+ * values get a block of their own. Blocks are left uninitialized. Nothing
+ * is freed until the arena is destroyed. Allocation is not thread-safe;
+ * memoryUsage() may be read from any thread.
+ */
+class Arena {
+public:
+    Arena() = default;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    char* allocate(size_t bytes);
+    char* allocateAligned(size_t bytes);  // Suitably aligned for pointers and atomics
+
+    // Bytes handed out so far, including alignment padding
+    size_t memoryUsage() const { return usage_.load(std::memory_order_relaxed); }
+
+private:
+    char* allocateFallback(size_t bytes);
+    char* allocateBlock(size_t bytes);
+
+    char* ptr_ = nullptr;
+    size_t remaining_ = 0;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::atomic<size_t> usage_{0};
+
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+};
+
+} // namespace dkv
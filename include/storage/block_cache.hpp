@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace dkv {
+
+struct BlockCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t usage = 0;      // Bytes currently cached
+    size_t capacity = 0;   // Byte budget
+};
+
+/**
+ * BlockCache - Process-wide LRU cache of SSTable data blocks.
+ *
+ * Blocks are keyed by (table id, block offset) and spread over independently
+ * locked shards so concurrent readers rarely contend. Each shard evicts its
+ * least recently used blocks once it exceeds its share of the byte budget.
+ *
+ * The budget belongs to the process, not to any one tree: it is set once at
+ * startup (kv_server --block-cache), and 0 disables caching.
+ */
+class BlockCache {
+public:
+    using Block = std::shared_ptr<const std::string>;
+
+    static BlockCache& global();
+
+    explicit BlockCache(size_t capacity);
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    Block lookup(uint64_t table_id, uint64_t offset);
+    void insert(uint64_t table_id, uint64_t offset, Block block);
+
+    void setCapacity(size_t capacity);
+    size_t capacity() const { return capacity_; }
+    BlockCacheStats stats() const;
+
+    // Unique id for each opened table so cache keys never collide
+    static uint64_t newTableId();
+
+private:
+    struct Key {
+        uint64_t table_id;
+        uint64_t offset;
+        bool operator==(const Key& o) const { return table_id == o.table_id && offset == o.offset; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<uint64_t>()(k.table_id * 0x9e3779b97f4a7c15ULL ^ k.offset);
+        }
+    };
+
+    struct Shard {
+        std::list<std::pair<Key, Block>> lru;  // Front is most recently used
+        std::unordered_map<Key, std::list<std::pair<Key, Block>>::iterator, KeyHash> map;
+        size_t usage = 0;
+        mutable std::mutex mutex;
+    };
+
+    Shard& shardFor(const Key& key);
+    void evict(Shard& shard, size_t limit);
+
+    static constexpr size_t NUM_SHARDS = 16;
+
+    Shard shards_[NUM_SHARDS];
+    std::atomic<size_t> capacity_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+} // namespace dkv
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace dkv {
+
+/**
+ * BloomFilter - Probabilistic set membership for SSTable keys.
+ *
+ * mightContain() never returns false for a key that was added. With
+ * 10 bits per key the false positive rate is roughly 1%.
+ * Serialized layout: bit array followed by one byte holding the probe count.
+ */
+class BloomFilter {
+public:
+    BloomFilter() = default;
+    explicit BloomFilter(std::string data) : data_(std::move(data)) {}
+
+    static BloomFilter build(const std::vector<uint32_t>& key_hashes, size_t bits_per_key);
+    static uint32_t hash(std::string_view key);
+
+    bool mightContain(const std::string& key) const;
+    bool empty() const { return data_.empty(); }
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+} // namespace dkv
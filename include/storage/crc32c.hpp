@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dkv {
+
+/**
+ * CRC-32C (Castagnoli) as used for WAL record checksums.
+ *
+ * Uses the SSE4.2 crc32 instruction when the CPU has it and a
+ * slicing-by-8 table otherwise. Pass a previous result as `crc` to extend
+ * a checksum over data that arrives in pieces.
+ */
+uint32_t crc32c(const char* data, size_t len, uint32_t crc = 0);
+
+} // namespace dkv
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace dkv {
+
+/**
+ * Flush a file's contents, or a directory's entries, to stable storage.
+ *
+ * A new file survives power loss only once both it and the directory that
+ * names it have been synced. Throws std::runtime_error on failure.
+ */
+void syncPath(const std::string& path);
+
+// Called with every path syncPath flushes, so tests can check the order;
+// nullptr removes it
+void setSyncObserver(std::function<void(const std::string&)> observer);
+
+} // namespace dkv
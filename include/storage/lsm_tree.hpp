@@ -6,17 +6,68 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <string_view>
+#include <condition_variable>
+#include <exception>
 #include "storage/memtable.hpp"
 #include "storage/sstable.hpp"
 #include "storage/wal.hpp"
+#include "storage/write_batch.hpp"
 
 namespace dkv {
 
 struct LSMConfig {
     size_t memtable_size_limit = 4 * 1024 * 1024;  // 4MB
-    size_t max_sstables = 10;
+    size_t max_immutable_memtables = 2;            // Full memtables queued for flush before writes stall
+    size_t max_sstables = 10;                      // L0 files at which writes stall
+    size_t bloom_bits_per_key = 10;                // 0 disables SSTable bloom filters
+    size_t sstable_block_size = 4096;              // Target size of prefix-compressed data blocks
+    bool use_mmap_reads = false;                   // mmap SSTables instead of pread + block cache
+
+    // WAL durability; concurrent writers share one write (and sync) per group commit.
+    // FDATASYNC and PERIODIC also sync new SSTables and the MANIFEST before
+    // the WAL segments or files they replace are deleted.
+    WALSyncMode wal_sync_mode = WALSyncMode::FLUSH;
+    uint32_t wal_sync_interval_ms = 100;           // PERIODIC only
+
+    // Leveled compaction
+    size_t level0_compaction_trigger = 4;          // L0 files before merging into L1
+    size_t num_levels = 7;
+    uint64_t level1_max_bytes = 10 * 1024 * 1024;  // 10MB, each level below is larger
+    size_t level_size_multiplier = 10;
+    uint64_t sstable_target_size = 2 * 1024 * 1024; // 2MB per compaction output file
+};
+
+struct LSMStats {
+    size_t memtable_bytes = 0;
+    size_t immutable_memtables = 0;      // Waiting to be flushed
+    std::vector<size_t> level_sstables;  // SSTable count per level
+    BlockCacheStats block_cache;
+
+    // "name:value" lines in the format used by OP_STATUS responses
+    std::string toString() const;
 };
 
+/**
+ * LSMTree - Log-structured merge tree storage engine.
+ *
+ * Writes go to the WAL and memtable. Concurrent writers queue up and the one
+ * at the head commits the whole group with a single WAL write (and sync),
+ * then applies it to the memtable in log order. A full memtable becomes
+ * immutable and writes move on to a fresh memtable and WAL segment while a
+ * background thread flushes it to level 0. A second thread merges L0 into
+ * L1 and each level into the next once it exceeds its size budget. Levels
+ * >= 1 hold non-overlapping SSTables, so a lookup reads at most one file
+ * per level.
+ *
+ * The set of live SSTables is an immutable snapshot replaced on every flush
+ * or compaction, so reads only hold mutex_ long enough to copy pointers.
+ * Range scans merge every memtable and SSTable in key order through a heap.
+ */
 class LSMTree {
 public:
     explicit LSMTree(const std::string& data_dir, LSMConfig config = {});
@@ -25,32 +76,162 @@ public:
     LSMTree(const LSMTree&) = delete;
     LSMTree& operator=(const LSMTree&) = delete;
 
-    bool put(const std::string& key, const std::string& value);
+    bool put(std::string_view key, std::string_view value);
     std::optional<std::string> get(const std::string& key) const;
-    bool del(const std::string& key);
+    bool del(std::string_view key);
     bool contains(const std::string& key) const;
 
+    // Apply every entry of batch in order, logged as one WAL record so
+    // recovery sees all of them or none. Readers may observe a batch half
+    // applied.
+    bool write(const WriteBatch& batch);
+
+    // One result per key, in the order given. The keys are looked up in
+    // sorted order, so each SSTable is probed front to back.
+    std::vector<std::optional<std::string>> multiGet(const std::vector<std::string>& keys) const;
+
+    // Live pairs with start <= key < end in key order, at most limit of them
+    // (0 = no limit). An empty end means no upper bound.
+    std::vector<std::pair<std::string, std::string>> scan(const std::string& start,
+                                                          const std::string& end,
+                                                          size_t limit = 0) const;
+
+    /**
+     * Ordered cursor over the live keys of the tree, starting at the first
+     * key >= start. A k-way merge of the memtables and SSTables captured at
+     * construction: the newest version of each key wins and deleted keys are
+     * skipped. Writes made after construction may or may not be seen.
+     */
+    class Iterator {
+    public:
+        explicit Iterator(const LSMTree& tree, const std::string& start = "");
+        ~Iterator();
+
+        Iterator(const Iterator&) = delete;
+        Iterator& operator=(const Iterator&) = delete;
+
+        bool valid() const { return !heap_.empty(); }
+        void next();
+        std::string_view key() const { return heap_.top().first; }
+        std::string_view value() const;
+
+        class Source;  // One memtable, L0 file or sorted level
+
+    private:
+        void advance(size_t src);
+        void skipShadowed();
+
+        // Views point into the source's current entry, which stays put until
+        // that source is advanced
+        using HeapItem = std::pair<std::string_view, size_t>;  // key, source
+
+        std::vector<std::unique_ptr<Source>> sources_;  // Newest first
+        std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap_;
+    };
+
+    // Flush the memtable and wait until every immutable memtable is on disk
     void flush();
     void sync();
-    
+
+    // Block until no level needs compaction
+    void compact();
+
+    // Flush the memtable, then make dir a standalone copy of the tree: every
+    // live SSTable hard-linked into it (copied where links are unsupported)
+    // plus a MANIFEST. SSTables are never modified, so no data is copied and
+    // the copy stays valid after this tree compacts the originals away.
+    // Writes that race with the call may or may not be included.
+    void checkpoint(const std::string& dir);
+
+    // Replace the whole contents of the tree with a checkpoint() directory.
+    // Waits for in-progress flushes and compactions, drops the memtables and
+    // their WAL segments, and links the checkpoint's SSTables in under fresh
+    // ids; the new MANIFEST is the switch-over point on disk.
+    void restore(const std::string& dir);
+
     size_t memtableSize() const;
     size_t sstableCount() const;
+    size_t levelSSTableCount(size_t level) const;
+    LSMStats stats() const;
 
 private:
+    using SSTablePtr = std::shared_ptr<SSTable>;
+    using Levels = std::vector<std::vector<SSTablePtr>>;  // L0 newest first, L1+ sorted by key
+
+    struct Writer {
+        explicit Writer(LogEntry* e, const WriteBatch* b = nullptr) : entry(e), batch(b) {}
+
+        LogEntry* entry;                 // nullptr for flush(), which only needs its turn
+        const WriteBatch* batch;         // write(WriteBatch): the entries entry packs
+        std::exception_ptr error;
+        bool done = false;
+        std::condition_variable cv;
+    };
+
+    struct ImmutableMemTable {
+        std::shared_ptr<MemTable> memtable;
+        std::vector<uint64_t> wal_segments;  // Deleted once the memtable is on disk
+    };
+
+    struct Compaction {
+        size_t level;                       // Inputs come from level and level + 1
+        std::vector<SSTablePtr> inputs;     // Newest first
+        std::vector<SSTablePtr> next_inputs;
+        std::vector<SSTablePtr> deeper;     // Files below the output level
+    };
+
     void recover();
-    void maybeFlush();
+    void commit(LogEntry& entry, const WriteBatch* write_batch = nullptr);
+    void makeRoomForWrite(std::unique_lock<std::mutex>& lock);
+    void switchMemTable();
+    void flushLoop();
     void loadSSTables();
+    void writeManifest(const Levels& levels) { writeManifest(levels, data_dir_); }
+    void writeManifest(const Levels& levels, const std::string& dir);
+    std::string walPath(uint64_t segment) const;
+    SSTablePtr openSSTable(const std::string& path) const;
+    // Whether files replacing the WAL must reach stable storage before it goes
+    bool syncFiles() const {
+        return config_.wal_sync_mode == WALSyncMode::FDATASYNC ||
+               config_.wal_sync_mode == WALSyncMode::PERIODIC;
+    }
     uint64_t nextSSTableId();
 
+    // Compaction (called with mutex_ held unless noted)
+    void compactionLoop();
+    bool needsCompaction() const;
+    std::optional<Compaction> pickCompaction();
+    std::vector<SSTablePtr> runCompaction(const Compaction& c);  // mutex_ not held
+    void installCompaction(const Compaction& c, const std::vector<SSTablePtr>& outputs);
+    uint64_t maxBytesForLevel(size_t level) const;
+    uint64_t levelBytes(size_t level) const;
+
     std::string data_dir_;
     LSMConfig config_;
-    
-    std::unique_ptr<MemTable> memtable_;
+
+    std::shared_ptr<MemTable> memtable_;
+    std::deque<ImmutableMemTable> immutables_;     // Newest first
     std::unique_ptr<WAL> wal_;
-    std::vector<std::unique_ptr<SSTable>> sstables_;
-    
+    std::deque<Writer*> writers_;                  // Pending writes; the front one commits
+    static constexpr size_t MAX_GROUP_BYTES = 1024 * 1024;
+    std::vector<uint64_t> wal_segments_;           // Segments holding memtable_'s writes
+    uint64_t next_wal_segment_ = 0;
+    std::shared_ptr<const Levels> levels_;
+    std::vector<std::string> compact_pointer_;     // Per level: where the next pick starts
+
     mutable std::mutex mutex_;
     std::atomic<uint64_t> sstable_id_{0};
+
+    std::thread flush_thread_;
+    std::condition_variable flush_cv_;             // Wakes the flush thread
+    bool flush_failed_ = false;                    // Last flush attempt failed
+    bool flushing_ = false;                        // A memtable is being written, mutex_ released
+
+    std::thread compaction_thread_;
+    std::condition_variable compaction_cv_;        // Wakes the compaction thread
+    std::condition_variable background_done_cv_;   // Wakes stalled writers, flush() and compact()
+    bool compaction_running_ = false;
+    bool stop_ = false;
 };
 
 } // namespace dkv
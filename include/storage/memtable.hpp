@@ -1,41 +1,92 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <optional>
-#include <map>
-#include <shared_mutex>
+#include <atomic>
 #include <mutex>
+#include <random>
 #include <cstdint>
+#include "storage/arena.hpp"
 
 namespace dkv {
 
+class WriteBatch;
+
 struct MemTableEntry {
     std::string value;
     bool deleted;
 };
 
+/**
+ * MemTable - Sorted in-memory write buffer for the LSM tree.
+ *
+ * A skiplist whose nodes, keys and values are allocated from a per-memtable
+ * Arena. Writers are serialized by a mutex; readers never lock and only see
+ * a node once it is fully linked. Overwriting a key publishes a new value
+ * record, so earlier values stay in the arena until the memtable is dropped
+ * (and count towards memoryUsage()).
+ */
 class MemTable {
 public:
-    MemTable() = default;
+    MemTable();
+
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
 
     void put(const std::string& key, const std::string& value);
     void del(const std::string& key);
+    // Insert every entry of batch under a single acquisition of the write lock
+    void apply(const WriteBatch& batch);
     std::optional<MemTableEntry> get(const std::string& key) const;
     bool contains(const std::string& key) const;
 
     size_t size() const;
     size_t memoryUsage() const;
     bool empty() const;
-    void clear();
 
-    using Iterator = std::map<std::string, MemTableEntry>::const_iterator;
-    Iterator begin() const { return data_.begin(); }
-    Iterator end() const { return data_.end(); }
+private:
+    struct Node;
+    struct Value;
+
+public:
+    /**
+     * Forward iterator in key order. Safe alongside concurrent writers, but
+     * entries inserted after the iterator has passed them are not seen.
+     */
+    class Iterator {
+    public:
+        explicit Iterator(const MemTable& table);
+
+        bool valid() const { return node_ != nullptr; }
+        void next();
+        // Position at the first entry >= target
+        void seek(std::string_view target);
+        std::string_view key() const;
+        std::string_view value() const;
+        bool deleted() const;
+
+    private:
+        const MemTable& table_;
+        const Node* node_;
+    };
 
 private:
-    std::map<std::string, MemTableEntry> data_;
-    mutable std::shared_mutex mutex_;
-    size_t memory_usage_ = 0;
+    static constexpr int MAX_HEIGHT = 12;
+
+    void insert(std::string_view key, std::string_view value, bool deleted);
+    void insertLocked(std::string_view key, std::string_view value, bool deleted);
+    Node* findGreaterOrEqual(std::string_view key, Node** prev) const;
+    Node* newNode(std::string_view key, int height);
+    const Value* newValue(std::string_view value, bool deleted);
+    int randomHeight();
+
+    Arena arena_;
+    Node* head_;
+    std::atomic<int> max_height_{1};
+    std::atomic<size_t> count_{0};
+    std::mutex write_mutex_;
+    std::minstd_rand rng_{0x5eed};  // Only used by the writer
 };
 
 } // namespace dkv
@@ -2,10 +2,14 @@
 
 #include <string>
 #include <optional>
+#include <string_view>
 #include <vector>
 #include <fstream>
+#include <atomic>
 #include <cstdint>
 #include "storage/memtable.hpp"
+#include "storage/bloom_filter.hpp"
+#include "storage/block_cache.hpp"
 
 namespace dkv {
 
@@ -20,32 +24,188 @@ struct IndexEntry {
     uint64_t offset;
 };
 
+/**
+ * SSTableBuilder - Writes sorted entries into a new SSTable file.
+ *
+ * Keys must be added in strictly increasing order. Entries are packed into
+ * data blocks of about block_size bytes; within a block each key stores
+ * only the suffix it doesn't share with the previous key, except at
+ * restart points (every RESTART_INTERVAL entries) where it is stored whole
+ * so lookups can binary search them.
+ *
+ * Block layout:
+ *   entry*: varint shared | varint unshared | varint valLen | deleted | key suffix | value
+ *   uint32 restart offsets | uint32 restart count
+ *
+ * With sync, finish() returns only once the file is on stable storage; the
+ * caller still has to sync the directory that names it.
+ */
+class SSTableBuilder {
+public:
+    explicit SSTableBuilder(const std::string& path, size_t bloom_bits_per_key = 10,
+                            size_t block_size = 4096, bool sync = false);
+
+    SSTableBuilder(const SSTableBuilder&) = delete;
+    SSTableBuilder& operator=(const SSTableBuilder&) = delete;
+
+    void add(std::string_view key, std::string_view value, bool deleted);
+    std::string finish();
+
+    uint64_t fileSize() const { return offset_ + block_.size(); }
+    size_t entryCount() const { return count_; }
+
+private:
+    void flushBlock();
+
+    std::string path_;
+    std::ofstream file_;
+    std::vector<IndexEntry> index_;     // First key and offset of each block
+    std::vector<uint32_t> key_hashes_;
+    size_t bloom_bits_per_key_;
+    size_t block_size_;
+    bool sync_;
+    size_t count_ = 0;
+    uint64_t offset_ = 0;               // Bytes of finished blocks
+
+    std::string block_;                 // Block being built
+    std::vector<uint32_t> restarts_;
+    size_t block_entries_ = 0;
+    std::string last_key_;
+
+    static constexpr size_t RESTART_INTERVAL = 16;
+};
+
+/**
+ * SSTable - Immutable sorted table on disk.
+ *
+ * Point lookups read one data block through the shared BlockCache, so hot
+ * blocks are served from memory without touching the file. In mmap mode
+ * the file is mapped instead and blocks are parsed in place, leaving
+ * caching to the OS page cache.
+ *
+ * Format 2 (written today) uses prefix-compressed blocks and a footer of
+ *   bloomOffset | indexOffset | count | version | FOOTER_MAGIC
+ * Format 1 (FOOTER_MAGIC_V1) and the original footer-less format 0 store
+ * flat deleted|keyLen|key|valLen|value records, with one index entry per
+ * INDEX_INTERVAL records; both are still readable.
+ */
 class SSTable {
 public:
-    static std::string create(const std::string& dir, uint64_t id, const MemTable& memtable);
-    
-    explicit SSTable(const std::string& path);
-    
+    static std::string create(const std::string& dir, uint64_t id, const MemTable& memtable,
+                              size_t bloom_bits_per_key = 10, size_t block_size = 4096,
+                              bool sync = false);
+    static std::string pathFor(const std::string& dir, uint64_t id);
+
+    explicit SSTable(const std::string& path, bool use_mmap = false);
+    ~SSTable();
+
+    SSTable(const SSTable&) = delete;
+    SSTable& operator=(const SSTable&) = delete;
+
     std::optional<SSTableEntry> get(const std::string& key) const;
     bool mightContain(const std::string& key) const;
-    
+
     const std::string& path() const { return path_; }
     const std::string& minKey() const { return min_key_; }
     const std::string& maxKey() const { return max_key_; }
     size_t entryCount() const { return entry_count_; }
+    uint64_t fileSize() const { return file_size_; }
+    uint32_t formatVersion() const { return format_version_; }
+
+    // Delete the file once the last reference to this table goes away
+    void markObsolete() { obsolete_ = true; }
+
+private:
+    /**
+     * Decodes the records of one block, in whichever format the table uses.
+     */
+    class BlockCursor {
+    public:
+        BlockCursor() = default;
+        BlockCursor(std::string_view block, uint32_t version);
+
+        // Step to the next record; false at the end of the block or on corruption
+        bool next();
+        // Position at the first record >= target; false if there is none
+        bool seek(std::string_view target);
+
+        std::string_view key() const { return key_; }
+        std::string_view value() const { return value_; }
+        bool deleted() const { return deleted_; }
+
+    private:
+        bool restartKey(uint32_t restart, std::string_view& key) const;
+
+        const char* data_ = nullptr;
+        const char* p_ = nullptr;
+        const char* end_ = nullptr;     // Start of the restart array in format 2
+        uint32_t num_restarts_ = 0;
+        uint32_t version_ = 0;
+        std::string key_;
+        std::string_view value_;
+        bool deleted_ = false;
+    };
+
+public:
+    /**
+     * Sequential reader over entries in key order. By default blocks are
+     * read straight from the file so a compaction's full pass doesn't evict
+     * the block cache; short range scans pass fill_cache to share it.
+     */
+    class Iterator {
+    public:
+        explicit Iterator(const SSTable& table, bool fill_cache = false);
+
+        bool valid() const { return valid_; }
+        void next();
+        // Position at the first entry >= target
+        void seek(std::string_view target);
+        const SSTableEntry& entry() const { return current_; }
+
+    private:
+        void loadBlock(size_t block);
+        void setCurrent();
+
+        const SSTable& table_;
+        bool fill_cache_;
+        size_t block_ = 0;
+        std::string data_;
+        BlockCache::Block holder_;
+        BlockCursor cursor_;
+        SSTableEntry current_;
+        bool valid_ = false;
+    };
 
 private:
     void loadIndex();
-    std::optional<SSTableEntry> readEntryAt(uint64_t offset) const;
-    uint64_t findOffset(const std::string& key) const;
+    void closeFile();
+    size_t findBlock(std::string_view key) const;
+    std::string_view blockData(size_t block, BlockCache::Block& holder) const;
+    uint64_t blockEnd(size_t block) const;
+    BlockCache::Block readBlock(size_t block) const;
+    std::string readRange(uint64_t offset, size_t len) const;
 
     std::string path_;
+    int fd_ = -1;
+    const char* map_ = nullptr;  // Whole file when opened with use_mmap
+    size_t map_size_ = 0;
+    uint64_t cache_id_;
     std::vector<IndexEntry> index_;
     std::string min_key_;
     std::string max_key_;
     size_t entry_count_ = 0;
-    
-    static constexpr size_t INDEX_INTERVAL = 16;
+    uint64_t data_end_ = 0;
+    uint64_t file_size_ = 0;
+    uint32_t format_version_ = 0;
+    BloomFilter bloom_;
+    std::atomic<bool> obsolete_{false};
+
+    static constexpr size_t INDEX_INTERVAL = 16;                        // Formats 0 and 1
+    static constexpr uint32_t FORMAT_VERSION = 2;
+    static constexpr uint64_t FOOTER_MAGIC = 0x4656545353564b44ULL;     // "DKVSSTVF" little-endian
+    static constexpr uint64_t FOOTER_MAGIC_V1 = 0x31305453534b5644ULL;  // "DKVSST01" little-endian
+
+    friend class SSTableBuilder;
 };
 
 } // namespace dkv
@@ -1,16 +1,20 @@
 #pragma once
 
 #include <string>
-#include <fstream>
 #include <vector>
+#include <functional>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 #include <cstdint>
 
 namespace dkv {
 
 enum class OpType : uint8_t {
     PUT = 1,
-    DELETE = 2
+    DELETE = 2,
+    BATCH = 3    // A WriteBatch's encoded entries in value, logged as one record
 };
 
 struct LogEntry {
@@ -19,27 +23,68 @@ struct LogEntry {
     std::string value;
 };
 
+enum class WALSyncMode : uint8_t {
+    NONE,       // Buffer in the process; written when the buffer fills or on sync()
+    FLUSH,      // write() every batch; survives a process crash
+    FDATASYNC,  // write() and fdatasync() every batch; survives power loss
+    PERIODIC    // write() every batch, fdatasync() from a background thread
+};
+
+struct WALOptions {
+    WALSyncMode sync_mode = WALSyncMode::FLUSH;
+    uint32_t sync_interval_ms = 100;  // PERIODIC only
+};
+
+/**
+ * WAL - Append-only log of writes not yet persisted elsewhere.
+ *
+ * File layout: an 8-byte magic, then records framed as
+ *   crc32c(payload) | payload length | op | keyLen | key | valLen | value
+ * Replay reads the file in large sequential chunks and stops at the first
+ * record that is torn or fails its checksum; everything after it is cut
+ * off so later appends stay reachable. BATCH records are unpacked, and
+ * fn sees their entries only once the whole record has been verified.
+ * Logs written before framing was added are rewritten in the new format
+ * when opened.
+ */
 class WAL {
 public:
-    explicit WAL(const std::string& path);
+    using ReplayFn = std::function<void(const LogEntry&)>;
+
+    explicit WAL(const std::string& path, WALOptions options = {});
     ~WAL();
 
     WAL(const WAL&) = delete;
     WAL& operator=(const WAL&) = delete;
 
     bool append(OpType op, const std::string& key, const std::string& value = "");
+    // Log several records with a single writev and at most one fdatasync
+    void appendBatch(const std::vector<LogEntry>& entries);
+    // Feed every intact entry to fn in log order; returns the entry count
+    size_t replay(const ReplayFn& fn);
     std::vector<LogEntry> recover();
     void checkpoint();
+    // Force everything appended so far to stable storage, whatever the mode
     void sync();
 
 private:
-    void writeEntry(const LogEntry& entry);
-    LogEntry readEntry();
-    bool hasMore();
+    void openFile();
+    void upgradeLegacyFormat();
+    void writeBuffered(const std::vector<LogEntry>& entries);
+    void writeDirect(const std::vector<LogEntry>& entries);
+    void flushBuffer();
+    void syncLoop();
 
     std::string path_;
-    std::fstream file_;
+    WALOptions options_;
+    int fd_ = -1;
+    std::string buffer_;               // Pending records in NONE mode
     std::mutex mutex_;
+
+    std::atomic<bool> dirty_{false};   // Written since the last fdatasync
+    std::thread sync_thread_;
+    std::condition_variable sync_cv_;
+    bool stop_ = false;
 };
 
 } // namespace dkv
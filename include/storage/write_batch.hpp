@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstdint>
+#include "storage/wal.hpp"
+
+namespace dkv {
+
+/**
+ * WriteBatch - Puts and deletes applied to an LSMTree as one unit.
+ *
+ * Entries are encoded as they are added, in the layout of a BATCH WAL
+ * record's value:
+ *   count | (op | keyLen | key | valLen | value)*
+ * so LSMTree::write() logs a batch without re-encoding it, and recovery
+ * replays either all of its entries or none of them.
+ */
+class WriteBatch {
+public:
+    using Handler = std::function<void(OpType op, std::string_view key, std::string_view value)>;
+
+    WriteBatch();
+
+    void put(std::string_view key, std::string_view value);
+    void del(std::string_view key);
+    void clear();
+
+    size_t count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    size_t byteSize() const { return rep_.size(); }
+
+    // Visit the entries in the order they were added
+    void forEach(const Handler& fn) const;
+
+    // Encoded form, the value of a BATCH log entry
+    const std::string& data() const { return rep_; }
+    // Adopt an encoded batch; false, leaving the batch empty, if it is malformed
+    bool setData(std::string data);
+
+private:
+    void append(OpType op, std::string_view key, std::string_view value);
+
+    std::string rep_;
+    uint32_t count_ = 0;
+};
+
+} // namespace dkv
@@ -7,6 +7,10 @@ void printHelp() {
     std::cout << "  put <key> <value>  - Store a key-value pair\n";
     std::cout << "  get <key>          - Retrieve a value\n";
     std::cout << "  del <key>          - Delete a key\n";
+    std::cout << "  scan [start] [end] [limit] - List keys in [start, end)\n";
+    std::cout << "  mget <key>...      - Retrieve several values at once\n";
+    std::cout << "  mput <key> <value>... - Store several pairs atomically\n";
+    std::cout << "  mdel <key>...      - Delete several keys atomically\n";
     std::cout << "  ping               - Check server connection\n";
     std::cout << "  status             - Show server node status\n";
     std::cout << "  quit               - Exit client\n";
@@ -104,6 +108,75 @@ int main(int argc, char* argv[]) {
                     std::cout << "ERROR\n";
                 }
             }
+            else if (cmd == "scan") {
+                std::string start, end;
+                uint32_t limit = 0;
+                iss >> start >> end >> limit;
+
+                auto entries = client.scan(start, end, limit);
+                if (entries) {
+                    for (const auto& [key, value] : *entries) {
+                        std::cout << key << " = " << value << "\n";
+                    }
+                    std::cout << "(" << entries->size() << " keys)\n";
+                } else {
+                    std::cout << "ERROR\n";
+                }
+            }
+            else if (cmd == "mget") {
+                std::vector<std::string> keys;
+                for (std::string key; iss >> key;) {
+                    keys.push_back(key);
+                }
+
+                if (keys.empty()) {
+                    std::cout << "Usage: mget <key>...\n";
+                    continue;
+                }
+
+                auto values = client.multiGet(keys);
+                if (values) {
+                    for (size_t i = 0; i < keys.size(); i++) {
+                        std::cout << keys[i] << " = " << ((*values)[i] ? *(*values)[i] : "(nil)") << "\n";
+                    }
+                } else {
+                    std::cout << "ERROR\n";
+                }
+            }
+            else if (cmd == "mput") {
+                std::vector<std::pair<std::string, std::string>> pairs;
+                for (std::string key, value; iss >> key >> value;) {
+                    pairs.emplace_back(key, value);
+                }
+
+                if (pairs.empty()) {
+                    std::cout << "Usage: mput <key> <value>...\n";
+                    continue;
+                }
+
+                if (client.multiPut(pairs)) {
+                    std::cout << "OK (" << pairs.size() << " keys)\n";
+                } else {
+                    std::cout << "ERROR\n";
+                }
+            }
+            else if (cmd == "mdel") {
+                std::vector<std::string> keys;
+                for (std::string key; iss >> key;) {
+                    keys.push_back(key);
+                }
+
+                if (keys.empty()) {
+                    std::cout << "Usage: mdel <key>...\n";
+                    continue;
+                }
+
+                if (client.multiDel(keys)) {
+                    std::cout << "OK (" << keys.size() << " keys)\n";
+                } else {
+                    std::cout << "ERROR\n";
+                }
+            }
             else if (cmd == "ping") {
                 if (client.ping()) {
                     std::cout << "PONG\n";
@@ -5,9 +5,26 @@
 #include <chrono>
 #include <atomic>
 #include <filesystem>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
 #include "storage/kv_store.hpp"
 #include "storage/persistent_kv_store.hpp"
 #include "storage/lsm_tree.hpp"
+#include "storage/crc32c.hpp"
+#include "storage/file_sync.hpp"
+#include "network/event_server.hpp"
+#include "network/server.hpp"
+#include "network/client.hpp"
+#include "network/async_client.hpp"
+#include "shard/sharded_client.hpp"
+#include "raft/raft_log.hpp"
+#include "raft/raft_node.hpp"
 
 using namespace dkv;
 
@@ -255,12 +272,154 @@ void test_persistence_performance() {
     std::cout << "[PASS] Persistence Performance\n\n";
 }
 
+void test_wal_checksums() {
+    std::cout << "[TEST] WAL Checksums and Tolerant Replay\n";
+    cleanup_test_dir();
+    std::filesystem::create_directories(TEST_DATA_DIR);
+
+    const std::string path = TEST_DATA_DIR + "/test.wal";
+    assert(crc32c("123456789", 9) == 0xe3069283);
+
+    constexpr int NUM_RECORDS = 200000;
+    {
+        WAL wal(path);
+        std::vector<LogEntry> batch;
+        for (int i = 0; i < NUM_RECORDS; i++) {
+            batch.push_back({OpType::PUT, "key" + std::to_string(i), "value" + std::to_string(i)});
+        }
+        wal.appendBatch(batch);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        WAL wal(path);
+        int expected = 0;
+        size_t count = wal.replay([&expected](const LogEntry& entry) {
+            assert(entry.key == "key" + std::to_string(expected));
+            expected++;
+        });
+        assert(count == NUM_RECORDS);
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    std::cout << "  Replayed " << NUM_RECORDS << " records ("
+              << std::filesystem::file_size(path) / 1024 << "KB) in " << duration.count() << "ms\n";
+
+    // A torn tail is cut off, and appends after it are replayed next time
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    {
+        WAL wal(path);
+        assert(wal.replay([](const LogEntry&) {}) == NUM_RECORDS - 1);
+        wal.append(OpType::DELETE, "after");
+    }
+    {
+        WAL wal(path);
+        auto entries = wal.recover();
+        assert(entries.size() == NUM_RECORDS);
+        assert(entries.back().op == OpType::DELETE && entries.back().key == "after");
+    }
+
+    // A flipped byte stops replay at the damaged record
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(std::filesystem::file_size(path) / 2);
+        file.put('\xff');
+    }
+    {
+        WAL wal(path);
+        size_t count = wal.replay([](const LogEntry&) {});
+        assert(count > 0 && count < NUM_RECORDS);
+    }
+
+    // Logs from before checksums are upgraded in place
+    {
+        std::ofstream legacy(path, std::ios::binary | std::ios::trunc);
+        for (int i = 0; i < 3; i++) {
+            std::string key = "legacy" + std::to_string(i);
+            uint8_t op = static_cast<uint8_t>(OpType::PUT);
+            uint32_t keyLen = key.size(), valLen = 1;
+            legacy.write(reinterpret_cast<const char*>(&op), 1);
+            legacy.write(reinterpret_cast<const char*>(&keyLen), 4);
+            legacy.write(key.data(), keyLen);
+            legacy.write(reinterpret_cast<const char*>(&valLen), 4);
+            legacy.write("v", 1);
+        }
+    }
+    {
+        WAL wal(path);
+        auto entries = wal.recover();
+        assert(entries.size() == 3);
+        assert(entries[2].key == "legacy2" && entries[2].value == "v");
+    }
+
+    cleanup_test_dir();
+    std::cout << "[PASS] WAL Checksums and Tolerant Replay\n\n";
+}
+
 const std::string LSM_TEST_DIR = "./lsm_test_data";
 
 void cleanup_lsm_dir() {
     std::filesystem::remove_all(LSM_TEST_DIR);
 }
 
+void test_memtable_skiplist() {
+    std::cout << "[TEST] MemTable Skiplist\n";
+
+    constexpr int NUM_KEYS = 100000;
+    MemTable memtable;
+    std::atomic<int> written{0};
+    std::atomic<bool> done{false};
+
+    // Readers run lock-free against the writer and must see every published key
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; t++) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                int upto = written.load();
+                if (upto == 0) continue;
+                int i = (upto * 7919) % upto;
+                char key[16];
+                std::snprintf(key, sizeof(key), "key%08d", i);
+                assert(memtable.get(key).has_value());
+            }
+        });
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        char key[16];
+        std::snprintf(key, sizeof(key), "key%08d", i);
+        memtable.put(key, "value" + std::to_string(i));
+        written = i + 1;
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    done = true;
+    for (auto& t : readers) t.join();
+
+    memtable.put("key00000042", "updated");
+    memtable.del("key00000043");
+    assert(memtable.get("key00000042").value().value == "updated");
+    assert(memtable.get("key00000043").value().deleted);
+    assert(!memtable.get("missing").has_value());
+    assert(memtable.size() == NUM_KEYS);
+
+    std::string prev;
+    size_t count = 0;
+    for (MemTable::Iterator it(memtable); it.valid(); it.next()) {
+        assert(prev.empty() || prev < it.key());
+        prev = std::string(it.key());
+        count++;
+    }
+    assert(count == NUM_KEYS);
+
+    std::cout << "  " << NUM_KEYS << " inserts in " << duration.count() << "ms, arena "
+              << memtable.memoryUsage() / 1024 << "KB\n";
+    std::cout << "[PASS] MemTable Skiplist\n\n";
+}
+
 void test_lsm_basic() {
     std::cout << "[TEST] LSM Basic Operations\n";
     cleanup_lsm_dir();
@@ -394,6 +553,2015 @@ void test_lsm_large_dataset() {
     std::cout << "[PASS] LSM Large Dataset\n\n";
 }
 
+void test_lsm_compaction() {
+    std::cout << "[TEST] LSM Leveled Compaction\n";
+    cleanup_lsm_dir();
+
+    LSMConfig config;
+    config.memtable_size_limit = 1024;
+    config.level0_compaction_trigger = 4;
+    config.level1_max_bytes = 8 * 1024;
+    config.sstable_target_size = 4 * 1024;
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+
+        // Overwrite the same keys many times so most versions are shadowed
+        for (int round = 0; round < 20; round++) {
+            for (int i = 0; i < 100; i++) {
+                lsm.put("key" + std::to_string(i), "value" + std::to_string(round));
+            }
+        }
+        for (int i = 0; i < 100; i += 2) {
+            lsm.del("key" + std::to_string(i));
+        }
+        lsm.flush();
+        lsm.compact();
+
+        assert(lsm.levelSSTableCount(0) < config.level0_compaction_trigger);
+        std::cout << "  SSTables after compaction: " << lsm.sstableCount() << "\n";
+
+        for (int i = 0; i < 100; i++) {
+            auto val = lsm.get("key" + std::to_string(i));
+            if (i % 2 == 0) {
+                assert(!val.has_value());
+            } else {
+                assert(val.value() == "value19");
+            }
+        }
+    }
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        assert(!lsm.get("key0").has_value());
+        assert(lsm.get("key1").value() == "value19");
+        assert(lsm.get("key99").value() == "value19");
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Leveled Compaction\n\n";
+}
+
+void test_sstable_bloom_filter() {
+    std::cout << "[TEST] SSTable Bloom Filter\n";
+    cleanup_lsm_dir();
+    std::filesystem::create_directories(LSM_TEST_DIR);
+
+    constexpr int NUM_KEYS = 1000;
+    constexpr int NUM_PROBES = 10000;
+
+    {
+        SSTableBuilder builder(SSTable::pathFor(LSM_TEST_DIR, 1), 10);
+        for (int i = 0; i < NUM_KEYS; i++) {
+            // Even numbers only, so odd probes fall inside the key range
+            char key[16];
+            std::snprintf(key, sizeof(key), "key%08d", i * 2);
+            builder.add(key, "value", false);
+        }
+        SSTable sst(builder.finish());
+
+        for (int i = 0; i < NUM_KEYS; i++) {
+            char key[16];
+            std::snprintf(key, sizeof(key), "key%08d", i * 2);
+            assert(sst.mightContain(key));
+            assert(sst.get(key).has_value());
+        }
+
+        int false_positives = 0;
+        for (int i = 0; i < NUM_PROBES; i++) {
+            char key[16];
+            std::snprintf(key, sizeof(key), "key%08d", (i % NUM_KEYS) * 2 + 1);
+            if (sst.mightContain(key)) {
+                false_positives++;
+            }
+        }
+
+        double rate = 100.0 * false_positives / NUM_PROBES;
+        std::cout << "  False positive rate: " << rate << "%\n";
+        assert(rate < 3.0);
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] SSTable Bloom Filter\n\n";
+}
+
+void test_sstable_block_format() {
+    std::cout << "[TEST] SSTable Block Format\n";
+    cleanup_lsm_dir();
+    std::filesystem::create_directories(LSM_TEST_DIR);
+
+    constexpr int NUM_KEYS = 10000;
+    auto keyFor = [](int i) {
+        char key[64];
+        std::snprintf(key, sizeof(key), "tenant-%04d/users/profile/%08d", i / 1000, i);
+        return std::string(key);
+    };
+
+    {
+        SSTableBuilder builder(SSTable::pathFor(LSM_TEST_DIR, 1));
+        size_t raw_bytes = 0;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            std::string key = keyFor(i);
+            std::string value = "v" + std::to_string(i);
+            builder.add(key, value, i % 100 == 0);
+            raw_bytes += key.size() + value.size();
+        }
+        SSTable sst(builder.finish());
+        assert(sst.formatVersion() == 2);
+        assert(sst.entryCount() == NUM_KEYS);
+        assert(sst.minKey() == keyFor(0) && sst.maxKey() == keyFor(NUM_KEYS - 1));
+
+        for (int i = 0; i < NUM_KEYS; i++) {
+            auto entry = sst.get(keyFor(i));
+            assert(entry.has_value() && entry->value == "v" + std::to_string(i));
+            assert(entry->deleted == (i % 100 == 0));
+        }
+        assert(!sst.get("tenant-0003/users/profile/").has_value());
+        assert(!sst.get(keyFor(42) + "x").has_value());
+
+        int count = 0;
+        for (SSTable::Iterator it(sst); it.valid(); it.next()) {
+            assert(it.entry().key == keyFor(count));
+            count++;
+        }
+        assert(count == NUM_KEYS);
+
+        std::cout << "  Keys+values " << raw_bytes / 1024 << "KB, file "
+                  << sst.fileSize() / 1024 << "KB\n";
+        assert(sst.fileSize() < raw_bytes);
+    }
+
+    // Tables written before the block format (flat records, no footer magic) still read
+    {
+        std::string path = SSTable::pathFor(LSM_TEST_DIR, 2);
+        std::ofstream out(path, std::ios::binary);
+        std::vector<std::pair<std::string, uint64_t>> index;
+        uint64_t offset = 0;
+        for (int i = 0; i < 40; i++) {
+            std::string key = keyFor(i), value = "old" + std::to_string(i);
+            if (i % 16 == 0) index.push_back({key, offset});
+            uint8_t deleted = 0;
+            uint32_t keyLen = key.size(), valLen = value.size();
+            out.write(reinterpret_cast<const char*>(&deleted), 1);
+            out.write(reinterpret_cast<const char*>(&keyLen), 4);
+            out.write(key.data(), keyLen);
+            out.write(reinterpret_cast<const char*>(&valLen), 4);
+            out.write(value.data(), valLen);
+            offset += 1 + 4 + keyLen + 4 + valLen;
+        }
+        uint32_t indexSize = index.size();
+        out.write(reinterpret_cast<const char*>(&indexSize), 4);
+        for (const auto& [key, off] : index) {
+            uint32_t keyLen = key.size();
+            out.write(reinterpret_cast<const char*>(&keyLen), 4);
+            out.write(key.data(), keyLen);
+            out.write(reinterpret_cast<const char*>(&off), 8);
+        }
+        size_t count = 40;
+        out.write(reinterpret_cast<const char*>(&offset), 8);
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.close();
+
+        SSTable sst(path);
+        assert(sst.formatVersion() == 0);
+        assert(sst.get(keyFor(17)).value().value == "old17");
+        assert(sst.maxKey() == keyFor(39));
+        int n = 0;
+        for (SSTable::Iterator it(sst); it.valid(); it.next()) n++;
+        assert(n == 40);
+    }
+
+    // A table that fails to open gives back its descriptor and mapping
+    {
+        std::string path = SSTable::pathFor(LSM_TEST_DIR, 1);
+        uint64_t version = 99;
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-static_cast<int>(2 * sizeof(uint64_t)), std::ios::end);
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.close();
+
+        auto openFds = [] {
+            return std::distance(std::filesystem::directory_iterator("/proc/self/fd"),
+                                 std::filesystem::directory_iterator());
+        };
+        auto before = openFds();
+        for (int i = 0; i < 100; i++) {
+            bool threw = false;
+            try {
+                SSTable sst(path, i % 2 == 0);
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            assert(threw);
+            (void)threw;
+        }
+        assert(openFds() == before);
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] SSTable Block Format\n\n";
+}
+
+void test_lsm_block_cache() {
+    std::cout << "[TEST] LSM Block Cache\n";
+    cleanup_lsm_dir();
+
+    {
+        LSMConfig config;
+        config.memtable_size_limit = 64 * 1024;
+        LSMTree lsm(LSM_TEST_DIR, config);
+
+        for (int i = 0; i < 1000; i++) {
+            lsm.put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        lsm.flush();
+
+        auto before = lsm.stats().block_cache;
+        for (int i = 0; i < 100; i++) {
+            assert(lsm.get("key42").value() == "value42");
+        }
+        auto after = lsm.stats().block_cache;
+
+        // Only the first read of the block may miss
+        assert(after.misses - before.misses <= 1);
+        assert(after.hits - before.hits >= 99);
+        assert(after.usage > 0 && after.usage <= after.capacity);
+        std::cout << "  Hits: " << after.hits - before.hits
+                  << ", misses: " << after.misses - before.misses << "\n";
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Block Cache\n\n";
+}
+
+void test_lsm_mmap_reads() {
+    std::cout << "[TEST] LSM mmap Reads\n";
+    cleanup_lsm_dir();
+
+    constexpr int NUM_ENTRIES = 10000;
+
+    LSMConfig config;
+    config.memtable_size_limit = 64 * 1024;
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        for (int i = 0; i < NUM_ENTRIES; i++) {
+            lsm.put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        for (int i = 0; i < NUM_ENTRIES; i += 10) {
+            lsm.del("key" + std::to_string(i));
+        }
+    }
+
+    for (bool use_mmap : {false, true}) {
+        config.use_mmap_reads = use_mmap;
+        LSMTree lsm(LSM_TEST_DIR, config);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        int found = 0;
+        for (int i = 0; i < NUM_ENTRIES; i++) {
+            auto val = lsm.get("key" + std::to_string(i));
+            if (i % 10 == 0) {
+                assert(!val.has_value());
+            } else {
+                assert(val.value() == "value" + std::to_string(i));
+                found++;
+            }
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+
+        assert(found == NUM_ENTRIES - NUM_ENTRIES / 10);
+        std::cout << "  " << (use_mmap ? "mmap" : "stream") << ": " << NUM_ENTRIES
+                  << " reads in " << duration.count() << "ms\n";
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM mmap Reads\n\n";
+}
+
+void test_lsm_background_flush() {
+    std::cout << "[TEST] LSM Background Flush\n";
+    cleanup_lsm_dir();
+
+    LSMConfig config;
+    config.memtable_size_limit = 4 * 1024;
+    config.max_immutable_memtables = 2;
+
+    auto walSegments = []() {
+        int count = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(LSM_TEST_DIR)) {
+            if (entry.path().filename().string().find("wal_") == 0) {
+                count++;
+            }
+        }
+        return count;
+    };
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+
+        // Every key must stay readable while its memtable waits to be flushed
+        for (int i = 0; i < 5000; i++) {
+            lsm.put("key" + std::to_string(i), "value" + std::to_string(i));
+            assert(lsm.stats().immutable_memtables <= config.max_immutable_memtables);
+            if (i % 97 == 0) {
+                assert(lsm.get("key" + std::to_string(i / 2)).value() ==
+                       "value" + std::to_string(i / 2));
+            }
+        }
+
+        lsm.flush();
+        assert(lsm.stats().immutable_memtables == 0);
+        // Flushed memtables retire their WAL segments, leaving only the active one
+        assert(walSegments() == 1);
+        std::cout << "  SSTables: " << lsm.sstableCount() << "\n";
+
+        for (int i = 0; i < 5000; i += 7) {
+            assert(lsm.get("key" + std::to_string(i)).value() == "value" + std::to_string(i));
+        }
+
+        lsm.put("unflushed", "value");
+    }
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        assert(lsm.get("unflushed").value() == "value");
+        assert(lsm.get("key4999").value() == "value4999");
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Background Flush\n\n";
+}
+
+void test_lsm_group_commit() {
+    std::cout << "[TEST] LSM Group Commit\n";
+
+    constexpr int NUM_WRITERS = 8;
+    constexpr int WRITES_PER_THREAD = 500;
+
+    for (WALSyncMode mode : {WALSyncMode::NONE, WALSyncMode::FLUSH,
+                             WALSyncMode::FDATASYNC, WALSyncMode::PERIODIC}) {
+        cleanup_lsm_dir();
+
+        LSMConfig config;
+        config.wal_sync_mode = mode;
+        config.wal_sync_interval_ms = 10;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        {
+            LSMTree lsm(LSM_TEST_DIR, config);
+            std::vector<std::thread> writers;
+            for (int t = 0; t < NUM_WRITERS; t++) {
+                writers.emplace_back([&lsm, t]() {
+                    for (int i = 0; i < WRITES_PER_THREAD; i++) {
+                        lsm.put("t" + std::to_string(t) + "_k" + std::to_string(i), "v");
+                    }
+                });
+            }
+            for (auto& t : writers) t.join();
+            lsm.del("t0_k0");
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+
+        // Reopen to check every write reached the WAL or an SSTable
+        {
+            LSMTree lsm(LSM_TEST_DIR, config);
+            assert(!lsm.get("t0_k0").has_value());
+            for (int t = 0; t < NUM_WRITERS; t++) {
+                for (int i = (t == 0 ? 1 : 0); i < WRITES_PER_THREAD; i++) {
+                    assert(lsm.get("t" + std::to_string(t) + "_k" + std::to_string(i)).has_value());
+                }
+            }
+        }
+
+        const char* names[] = {"none", "flush", "fdatasync", "periodic"};
+        std::cout << "  " << names[static_cast<int>(mode)] << ": "
+                  << (NUM_WRITERS * WRITES_PER_THREAD) << " writes in "
+                  << duration.count() << "ms\n";
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Group Commit\n\n";
+}
+
+void test_lsm_durable_flush() {
+    std::cout << "[TEST] LSM Durable Flush\n";
+
+    std::mutex synced_mutex;
+    std::vector<std::string> synced;
+    setSyncObserver([&](const std::string& path) {
+        std::lock_guard<std::mutex> lock(synced_mutex);
+        synced.push_back(path);
+    });
+
+    for (WALSyncMode mode : {WALSyncMode::FLUSH, WALSyncMode::FDATASYNC}) {
+        cleanup_lsm_dir();
+        synced.clear();
+
+        LSMConfig config;
+        config.memtable_size_limit = 16 * 1024;
+        config.wal_sync_mode = mode;
+        {
+            LSMTree lsm(LSM_TEST_DIR, config);
+            for (int i = 0; i < 2000; i++) {
+                lsm.put("key" + std::to_string(i), "value" + std::to_string(i));
+            }
+            lsm.flush();
+        }
+
+        std::lock_guard<std::mutex> lock(synced_mutex);
+        if (mode == WALSyncMode::FLUSH) {
+            // Only power-loss durable modes pay for syncs
+            assert(synced.empty());
+            continue;
+        }
+
+        // Each SSTable is synced, then the MANIFEST naming it, then the
+        // directory, all before the flush that wrote them returns
+        size_t tables = 0;
+        for (size_t i = 0; i < synced.size(); i++) {
+            if (synced[i].size() < 4 || synced[i].compare(synced[i].size() - 4, 4, ".sst") != 0) {
+                continue;
+            }
+            tables++;
+            auto manifest = std::find(synced.begin() + i, synced.end(),
+                                      LSM_TEST_DIR + "/MANIFEST.tmp");
+            assert(manifest != synced.end());
+            assert(std::find(manifest, synced.end(), LSM_TEST_DIR) != synced.end());
+            (void)manifest;
+        }
+        assert(tables > 1);
+        std::cout << "  " << tables << " SSTables synced, " << synced.size() << " syncs in all\n";
+    }
+    setSyncObserver(nullptr);
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Durable Flush\n\n";
+}
+
+void test_lsm_write_batch() {
+    std::cout << "[TEST] LSM Write Batch and MultiGet\n";
+    cleanup_lsm_dir();
+    std::filesystem::create_directories(LSM_TEST_DIR);
+
+    // Entries come back in order, and damaged encodings are refused
+    WriteBatch first;
+    first.put("b1", "x");
+    first.del("before");
+    assert(first.count() == 2);
+    std::vector<std::string> seen;
+    first.forEach([&seen](OpType op, std::string_view key, std::string_view value) {
+        seen.push_back(std::to_string(static_cast<int>(op)) + std::string(key) + std::string(value));
+    });
+    assert((seen == std::vector<std::string>{"1b1x", "2before"}));
+
+    WriteBatch copy;
+    assert(copy.setData(first.data()) && copy.count() == 2 && copy.data() == first.data());
+    assert(!copy.setData(first.data().substr(0, first.data().size() - 1)) && copy.empty());
+    assert(!copy.setData(first.data() + "x") && copy.empty());
+
+    // A batch is one WAL record: a torn one is dropped whole on replay
+    WriteBatch second;
+    second.put("b2", "y");
+    second.put("b3", "z");
+    const std::string wal_path = LSM_TEST_DIR + "/batch.wal";
+    {
+        WAL wal(wal_path);
+        wal.append(OpType::PUT, "before", "1");
+        wal.append(OpType::BATCH, "", first.data());
+        wal.append(OpType::BATCH, "", second.data());
+    }
+    std::filesystem::resize_file(wal_path, std::filesystem::file_size(wal_path) - 1);
+    {
+        WAL wal(wal_path);
+        auto entries = wal.recover();
+        assert(entries.size() == 3);
+        assert(entries[1].key == "b1" && entries[2].op == OpType::DELETE);
+    }
+    std::filesystem::remove(wal_path);
+
+    constexpr int NUM_KEYS = 3000;
+
+    LSMConfig config;
+    config.memtable_size_limit = 64 * 1024;
+    config.level0_compaction_trigger = 2;
+
+    std::map<std::string, std::string> expected;
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        WriteBatch batch;
+        for (int b = 0; b < NUM_KEYS / 100; b++) {
+            batch.clear();
+            for (int i = b * 100; i < (b + 1) * 100; i++) {
+                std::string key = "mkey" + std::to_string(i);
+                batch.put(key, "value" + std::to_string(i));
+                expected[key] = "value" + std::to_string(i);
+            }
+            lsm.write(batch);
+        }
+
+        // Deletes and overwrites mixed into one batch
+        batch.clear();
+        for (int i = 0; i < NUM_KEYS; i += 7) {
+            std::string key = "mkey" + std::to_string(i);
+            if (i % 2) {
+                batch.del(key);
+                expected.erase(key);
+            } else {
+                batch.put(key, "new");
+                expected[key] = "new";
+            }
+        }
+        lsm.write(batch);
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        lsm.compact();
+
+        // Unsorted, with duplicates and missing keys
+        std::vector<std::string> keys;
+        for (int i = NUM_KEYS + 50; i >= 0; i -= 3) {
+            keys.push_back("mkey" + std::to_string(i));
+        }
+        keys.push_back("mkey9");
+        keys.push_back("mkey9");
+        keys.push_back("absent");
+
+        auto results = lsm.multiGet(keys);
+        assert(results.size() == keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto it = expected.find(keys[i]);
+            assert(results[i] == (it == expected.end() ? std::nullopt
+                                                       : std::optional<std::string>(it->second)));
+            assert(results[i] == lsm.get(keys[i]));
+        }
+        assert(lsm.multiGet({}).empty());
+    }
+    std::cout << "  " << NUM_KEYS << " keys in " << NUM_KEYS / 100 << " batches written in "
+              << duration.count() << "ms\n";
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Write Batch and MultiGet\n\n";
+}
+
+void test_lsm_scan() {
+    std::cout << "[TEST] LSM Range Scan\n";
+    cleanup_lsm_dir();
+
+    LSMConfig config;
+    config.memtable_size_limit = 8 * 1024;
+    config.level0_compaction_trigger = 2;
+
+    auto key = [](int i) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "key%05d", i);
+        return std::string(buf);
+    };
+
+    // Reference model of what the tree should hold
+    std::map<std::string, std::string> expected;
+    using Pairs = std::vector<std::pair<std::string, std::string>>;
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+
+        // Spread versions of the same keys across deeper levels, L0 and the memtables
+        for (int round = 0; round < 3; round++) {
+            for (int i = round; i < 3000; i += 2) {
+                std::string value = "v" + std::to_string(round) + "_" + std::to_string(i);
+                lsm.put(key(i), value);
+                expected[key(i)] = value;
+            }
+            for (int i = round * 7; i < 3000; i += 13) {
+                lsm.del(key(i));
+                expected.erase(key(i));
+            }
+            if (round == 0) {
+                lsm.flush();
+                lsm.compact();
+            }
+        }
+
+        assert(lsm.scan("", "") == Pairs(expected.begin(), expected.end()));
+
+        // Bounded range: start inclusive, end exclusive
+        auto range = lsm.scan(key(1000), key(1100));
+        assert(range == Pairs(expected.lower_bound(key(1000)), expected.lower_bound(key(1100))));
+
+        auto limited = lsm.scan(key(500), "", 10);
+        assert(limited.size() == 10);
+        assert(limited.front().first == expected.lower_bound(key(500))->first);
+
+        assert(lsm.scan("zzz", "").empty());
+        assert(lsm.scan(key(2000), key(1000)).empty());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t count = 0;
+        for (LSMTree::Iterator it(lsm, key(0)); it.valid(); it.next()) {
+            count++;
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+        assert(count == expected.size());
+        std::cout << "  Iterated " << count << " keys in " << duration.count() << "us\n";
+    }
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        assert(lsm.scan("", "") == Pairs(expected.begin(), expected.end()));
+    }
+
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Range Scan\n\n";
+}
+
+void test_lsm_checkpoint() {
+    std::cout << "[TEST] LSM Checkpoint and Restore\n";
+    cleanup_lsm_dir();
+    const std::string checkpoint_dir = LSM_TEST_DIR + "_checkpoint";
+    std::filesystem::remove_all(checkpoint_dir);
+
+    LSMConfig config;
+    config.memtable_size_limit = 4 * 1024;
+
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        for (int i = 0; i < 500; i++) {
+            lsm.put("key" + std::to_string(i), "old" + std::to_string(i));
+        }
+
+        // The checkpoint shares the SSTables' files rather than copying them
+        lsm.checkpoint(checkpoint_dir);
+        size_t files = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(checkpoint_dir)) {
+            if (entry.path().filename() != "MANIFEST") {
+                assert(std::filesystem::hard_link_count(entry.path()) >= 2);
+                files++;
+            }
+        }
+        // A compaction may already have replaced the live files, so count
+        // against what the checkpoint's MANIFEST names
+        std::ifstream manifest(checkpoint_dir + "/MANIFEST");
+        size_t listed = 0;
+        size_t level;
+        std::string filename;
+        while (manifest >> level >> filename) {
+            listed++;
+        }
+        assert(files > 0 && files == listed);
+
+        for (int i = 0; i < 500; i++) {
+            lsm.put("key" + std::to_string(i), "new" + std::to_string(i));
+        }
+        lsm.put("later", "value");
+        lsm.del("key0");
+
+        // Restoring drops everything written since, in memtables and on disk
+        lsm.restore(checkpoint_dir);
+        assert(lsm.get("key0").value() == "old0");
+        assert(lsm.get("key499").value() == "old499");
+        assert(!lsm.get("later").has_value());
+        lsm.put("after", "restore");
+    }
+
+    // The restored contents are what a reopen recovers, WAL included
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        assert(lsm.get("key250").value() == "old250");
+        assert(!lsm.get("later").has_value());
+        assert(lsm.get("after").value() == "restore");
+    }
+
+    // The checkpoint stands on its own once the tree has moved on
+    std::filesystem::remove_all(LSM_TEST_DIR);
+    {
+        LSMTree lsm(LSM_TEST_DIR, config);
+        lsm.restore(checkpoint_dir);
+        assert(lsm.get("key123").value() == "old123");
+    }
+
+    std::filesystem::remove_all(checkpoint_dir);
+    cleanup_lsm_dir();
+    std::cout << "[PASS] LSM Checkpoint and Restore\n\n";
+}
+
+void test_protocol_views() {
+    std::cout << "[TEST] Protocol Views\n";
+
+    Request req{OpCode::OP_PUT, "view-key", std::string("bin\0ary", 7), 42};
+    auto frame = req.serialize();
+    std::string_view bytes(reinterpret_cast<const char*>(frame.data()), frame.size());
+
+    // Views point into the frame rather than owning copies
+    RequestView view = RequestView::parse(bytes);
+    assert(view.op == OpCode::OP_PUT && view.id == 42);
+    assert(view.key == "view-key" && view.value == req.value);
+    assert(view.key.data() >= bytes.data() && view.key.data() < bytes.data() + bytes.size());
+    Request copy = view.toRequest();
+    assert(copy.key == req.key && copy.value == req.value && copy.id == req.id);
+
+    AppendEntries ae;
+    ae.term = 7;
+    ae.leader_id = "127.0.0.1:9001";
+    ae.prev_log_index = 3;
+    ae.prev_log_term = 6;
+    ae.leader_commit = 2;
+    for (uint64_t i = 4; i < 104; i++) {
+        ae.entries.push_back({7, i, OpCode::OP_PUT, "k" + std::to_string(i), std::string(i, 'v')});
+    }
+    auto ae_data = ae.serialize();
+    std::string_view ae_bytes(reinterpret_cast<const char*>(ae_data.data()), ae_data.size());
+
+    AppendEntriesView ae_view = AppendEntriesView::parse(ae_bytes);
+    assert(ae_view.term == 7 && ae_view.leader_id == ae.leader_id);
+    assert(ae_view.prev_log_index == 3 && ae_view.prev_log_term == 6 && ae_view.leader_commit == 2);
+    assert(ae_view.entries.size() == ae.entries.size());
+    for (size_t i = 0; i < ae.entries.size(); i++) {
+        RaftLogEntry entry = ae_view.entries[i].toEntry();
+        assert(entry.term == 7 && entry.index == ae.entries[i].index);
+        assert(entry.key == ae.entries[i].key && entry.value == ae.entries[i].value);
+    }
+    AppendEntries round_trip = AppendEntries::deserialize(ae_data);
+    assert(round_trip.entries.size() == ae.entries.size());
+    assert(round_trip.entries.back().value == ae.entries.back().value);
+
+    // Encodings are sized exactly up front; frames are length | encoding
+    assert(frame.size() == req.encodedSize() && frame.capacity() == frame.size());
+    assert(ae_data.size() == ae_data.capacity());
+    Response resp{StatusCode::STATUS_OK, std::string(1000, 'r'), "", 9};
+    std::vector<uint8_t> framed;
+    appendFrame(framed, req);
+    appendFrame(framed, resp);
+    assert(framed.size() == 8 + req.encodedSize() + resp.encodedSize());
+    assert(framed[0] == req.encodedSize() && framed[1] == 0);
+    assert(std::equal(frame.begin(), frame.end(), framed.begin() + 4));
+    Response decoded = Response::deserialize(std::vector<uint8_t>(framed.begin() + 8 + frame.size(), framed.end()));
+    assert(decoded.value == resp.value && decoded.id == 9);
+    assert(encodeFrame(resp).size() == 4 + resp.serialize().size());
+
+    // Every truncation of a frame is rejected instead of read past the end
+    size_t rejected = 0;
+    for (size_t len = 0; len < bytes.size(); len++) {
+        try {
+            RequestView::parse(bytes.substr(0, len));
+        } catch (const std::runtime_error&) {
+            rejected++;
+        }
+    }
+    assert(rejected == bytes.size());
+    for (size_t len : {size_t(0), size_t(12), ae_bytes.size() / 2, ae_bytes.size() - 1}) {
+        bool threw = false;
+        try {
+            AppendEntriesView::parse(ae_bytes.substr(0, len));
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        (void)threw;
+    }
+    (void)rejected;
+
+    // A reply cut short is refused; one without conflict hints (17 bytes,
+    // from an older node) reads as having none
+    std::vector<uint8_t> aer = AppendEntriesResponse{7, false, 3, 5, 40}.serialize();
+    size_t aer_rejected = 0;
+    for (size_t len = 0; len < aer.size(); len++) {
+        try {
+            auto partial = AppendEntriesResponse::deserialize(std::vector<uint8_t>(aer.begin(), aer.begin() + len));
+            assert(len == 17 && partial.match_index == 3 && partial.conflict_index == 0);
+        } catch (const std::runtime_error&) {
+            aer_rejected++;
+        }
+    }
+    assert(aer_rejected == aer.size() - 1);
+    assert(AppendEntriesResponse::deserialize(aer).conflict_index == 40);
+    (void)aer_rejected;
+
+    std::cout << "[PASS] Protocol Views\n\n";
+}
+
+void test_event_server() {
+    std::cout << "[TEST] Event Server\n";
+
+    constexpr int NUM_CONNECTIONS = 400;
+
+    // Echo every frame back; port 0 lets the kernel pick a free port
+    EventServer server(0, [](const std::shared_ptr<Connection>& conn, std::string_view message) {
+        conn->send(message);
+    }, 4);
+    server.start();
+
+    auto connectTo = [&server]() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(server.port());
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        int rc = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        assert(rc == 0);
+        (void)rc;
+        return fd;
+    };
+    auto sendAll = [](int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, 0);
+            assert(n > 0);
+            sent += n;
+        }
+    };
+    auto recvAll = [](int fd, size_t len) {
+        std::string data(len, '\0');
+        size_t received = 0;
+        while (received < len) {
+            ssize_t n = recv(fd, data.data() + received, len - received, 0);
+            assert(n > 0);
+            received += n;
+        }
+        return data;
+    };
+    auto frame = [](const std::string& payload) {
+        uint32_t len = static_cast<uint32_t>(payload.size());
+        std::string out(reinterpret_cast<const char*>(&len), 4);
+        return out + payload;
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<int> fds;
+    for (int i = 0; i < NUM_CONNECTIONS; i++) {
+        fds.push_back(connectTo());
+    }
+
+    // Frames split at awkward points must be reassembled by the reactor
+    for (int i = 0; i < NUM_CONNECTIONS; i++) {
+        std::string f = frame("hello" + std::to_string(i));
+        sendAll(fds[i], f.substr(0, 2));
+        sendAll(fds[i], f.substr(2, 5));
+        sendAll(fds[i], f.substr(7) + frame("second"));
+    }
+    for (int i = 0; i < NUM_CONNECTIONS; i++) {
+        assert(recvAll(fds[i], 4 + 5 + std::to_string(i).size()).substr(4) ==
+               "hello" + std::to_string(i));
+        assert(recvAll(fds[i], 10).substr(4) == "second");
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    assert(server.connectionCount() == NUM_CONNECTIONS);
+    std::cout << "  " << NUM_CONNECTIONS << " connections served in " << duration.count() << "ms\n";
+
+    // A frame much larger than the read buffer, echoed through queued output
+    std::string big(3 * 1024 * 1024, 'x');
+    for (size_t i = 0; i < big.size(); i += 4096) {
+        big[i] = static_cast<char>('a' + i % 26);
+    }
+    std::thread writer([&]() { sendAll(fds[0], frame(big)); });
+    assert(recvAll(fds[0], 4 + big.size()).substr(4) == big);
+    writer.join();
+
+    for (int fd : fds) {
+        close(fd);
+    }
+    for (int i = 0; i < 100 && server.connectionCount() > 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(server.connectionCount() == 0);
+    server.stop();
+
+    // A client that stops reading its responses never stalls the reactor:
+    // its requests wait until it catches up, while others are still served
+    constexpr int NUM_BIG_RESPONSES = 20;
+    std::string big_response(1024 * 1024, 'r');
+    EventServer single(0, [&](const std::shared_ptr<Connection>& conn, std::string_view message) {
+        conn->send(message == "ping" ? std::string_view("pong") : std::string_view(big_response));
+    }, 1);
+    single.start();
+    auto connectSingle = [&single]() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(single.port());
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        int rc = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        assert(rc == 0);
+        (void)rc;
+        return fd;
+    };
+    int slow = connectSingle();
+    std::string requests;
+    for (int i = 0; i < NUM_BIG_RESPONSES; i++) {
+        requests += frame("big");
+    }
+    sendAll(slow, requests);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int fast = connectSingle();
+    start = std::chrono::high_resolution_clock::now();
+    sendAll(fast, frame("ping"));
+    assert(recvAll(fast, 8).substr(4) == "pong");
+    auto ping_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    ).count();
+    assert(ping_ms < 1000);
+
+    // Once the slow client reads, its remaining requests are answered
+    for (int i = 0; i < NUM_BIG_RESPONSES; i++) {
+        assert(recvAll(slow, 4 + big_response.size()).substr(4) == big_response);
+    }
+    std::cout << "  Ping answered in " << ping_ms << "ms behind a client not reading "
+              << NUM_BIG_RESPONSES << "MB of responses\n";
+    close(slow);
+    close(fast);
+    single.stop();
+
+    std::cout << "[PASS] Event Server\n\n";
+}
+
+void test_request_pipelining() {
+    std::cout << "[TEST] Request Pipelining\n";
+    cleanup_test_dir();
+
+    constexpr int NUM_KEYS = 2000;
+
+    {
+        Server server(TEST_DATA_DIR, 0, 2);
+        server.start();
+        Client client;
+        bool connected = client.connect("127.0.0.1", server.port());
+        assert(connected);
+        (void)connected;
+
+        std::vector<Request> puts;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            puts.push_back({OpCode::OP_PUT, "pipe" + std::to_string(10000 + i), "value" + std::to_string(i)});
+        }
+        for (const auto& resp : client.pipeline(puts)) {
+            assert(resp.status == StatusCode::STATUS_OK);
+            (void)resp;
+        }
+
+        std::vector<Request> gets;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            gets.push_back({OpCode::OP_GET, "pipe" + std::to_string(10000 + i), ""});
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        auto responses = client.pipeline(gets);
+        auto pipelined = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+        assert(responses.size() == NUM_KEYS);
+        for (int i = 0; i < NUM_KEYS; i++) {
+            assert(responses[i].status == StatusCode::STATUS_OK);
+            assert(responses[i].value == "value" + std::to_string(i));
+        }
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < NUM_KEYS; i++) {
+            auto value = client.get("pipe" + std::to_string(10000 + i));
+            assert(value && *value == "value" + std::to_string(i));
+        }
+        auto sequential = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+        std::cout << "  " << NUM_KEYS << " GETs: pipelined " << pipelined.count()
+                  << "us, one at a time " << sequential.count() << "us\n";
+
+        // Responses can be claimed in any order, including a streamed scan
+        uint32_t get_id = client.submit({OpCode::OP_GET, "pipe10005", ""});
+        auto args = ScanRequest{"pipe10100", 0}.serialize();
+        uint32_t scan_id = client.submit({OpCode::OP_SCAN, "pipe10000", std::string(args.begin(), args.end())});
+        uint32_t missing_id = client.submit({OpCode::OP_GET, "missing", ""});
+
+        Response missing = client.wait(missing_id);
+        assert(missing.status == StatusCode::STATUS_NOT_FOUND && missing.id == missing_id);
+
+        size_t scanned = 0;
+        while (true) {
+            Response chunk = client.wait(scan_id);
+            assert(chunk.id == scan_id);
+            scanned += ScanChunk::deserialize(std::vector<uint8_t>(chunk.value.begin(), chunk.value.end())).entries.size();
+            if (chunk.status != StatusCode::STATUS_PARTIAL) {
+                assert(chunk.status == StatusCode::STATUS_OK);
+                break;
+            }
+        }
+        assert(scanned == 100);
+
+        Response got = client.wait(get_id);
+        assert(got.status == StatusCode::STATUS_OK && got.value == "value5");
+
+        client.disconnect();
+        server.stop();
+    }
+    cleanup_test_dir();
+    std::cout << "[PASS] Request Pipelining\n\n";
+}
+
+void test_multi_key_requests() {
+    std::cout << "[TEST] Multi-key Requests\n";
+    cleanup_test_dir();
+
+    constexpr int NUM_KEYS = 1000;
+
+    {
+        Server server(TEST_DATA_DIR, 0, 2);
+        server.start();
+        Client client;
+        bool connected = client.connect("127.0.0.1", server.port());
+        assert(connected);
+        (void)connected;
+
+        std::vector<std::pair<std::string, std::string>> pairs;
+        std::vector<std::string> keys;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            pairs.emplace_back("multi" + std::to_string(i), "value" + std::to_string(i));
+            keys.push_back("multi" + std::to_string(i));
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        bool ok = client.multiPut(pairs);
+        assert(ok);
+        auto values = client.multiGet(keys);
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+        assert(values && values->size() == NUM_KEYS);
+        for (int i = 0; i < NUM_KEYS; i++) {
+            assert((*values)[i] == "value" + std::to_string(i));
+        }
+        std::cout << "  MPUT + MGET of " << NUM_KEYS << " keys in " << duration.count() << "us\n";
+
+        ok = client.multiDel({"multi1", "multi2", "never-written"});
+        assert(ok);
+        values = client.multiGet({"multi0", "multi1", "multi2", "multi3"});
+        assert(values && values->size() == 4);
+        assert((*values)[0] == "value0" && !(*values)[1] && !(*values)[2] && (*values)[3] == "value3");
+
+        // A value count that doesn't match the keys is rejected whole
+        auto bad = MultiRequest{{"x", "y"}, {"1"}}.serialize();
+        Response resp = client.wait(client.submit({OpCode::OP_MPUT, "", std::string(bad.begin(), bad.end())}));
+        assert(resp.status == StatusCode::STATUS_ERROR);
+        assert(!client.get("x"));
+        (void)ok;
+
+        client.disconnect();
+        server.stop();
+    }
+    cleanup_test_dir();
+    std::cout << "[PASS] Multi-key Requests\n\n";
+}
+
+void test_async_client() {
+    std::cout << "[TEST] Async Client\n";
+    cleanup_test_dir();
+
+    constexpr int NUM_THREADS = 16;
+    constexpr int OPS_PER_THREAD = 500;
+
+    {
+        Server server(TEST_DATA_DIR, 0, 2);
+        server.start();
+        AsyncClient client(4);
+        bool connected = client.connect("127.0.0.1", server.port());
+        assert(connected);
+        (void)connected;
+
+        // Every thread keeps its whole batch in flight through one shared client
+        std::atomic<int> failures{0};
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_THREADS; t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<std::future<bool>> puts;
+                for (int i = 0; i < OPS_PER_THREAD; i++) {
+                    std::string key = "async" + std::to_string(t) + "_" + std::to_string(i);
+                    puts.push_back(client.putAsync(key, "value" + std::to_string(i)));
+                }
+                for (auto& put : puts) {
+                    if (!put.get()) failures++;
+                }
+
+                std::vector<std::future<std::optional<std::string>>> gets;
+                for (int i = 0; i < OPS_PER_THREAD; i++) {
+                    gets.push_back(client.getAsync("async" + std::to_string(t) + "_" + std::to_string(i)));
+                }
+                for (int i = 0; i < OPS_PER_THREAD; i++) {
+                    if (gets[i].get() != "value" + std::to_string(i)) failures++;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+        assert(failures == 0);
+        std::cout << "  " << NUM_THREADS * OPS_PER_THREAD * 2 << " ops from " << NUM_THREADS
+                  << " threads over " << client.poolSize() << " connections in "
+                  << duration.count() << "us\n";
+
+        // Callbacks run once per response
+        std::atomic<int> pongs{0};
+        std::promise<void> all_done;
+        for (int i = 0; i < 100; i++) {
+            client.submit({OpCode::OP_PING, "", ""}, [&](Response resp) {
+                if (resp.status == StatusCode::STATUS_OK && ++pongs == 100) {
+                    all_done.set_value();
+                }
+            });
+        }
+        all_done.get_future().wait();
+        assert(client.del("async0_0") && !client.get("async0_0"));
+
+        // Losing the server fails requests instead of leaving them hanging
+        uint16_t port = server.port();
+        server.stop();
+        assert(!client.get("async0_1"));
+
+        // While the server is down, requests fail without waiting on a connect
+        auto down_start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 100; i++) {
+            assert(!client.put("down", "value"));
+        }
+        assert(std::chrono::steady_clock::now() - down_start < std::chrono::seconds(5));
+
+        // and the I/O thread reconnects once it is back
+        Server restarted(TEST_DATA_DIR + "/restarted", port, 1);
+        restarted.start();
+        bool reconnected = false;
+        for (int i = 0; i < 100 && !reconnected; i++) {
+            reconnected = client.put("back", "value");
+            if (!reconnected) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+        assert(reconnected && client.get("back") == "value");
+        (void)reconnected;
+        restarted.stop();
+        client.disconnect();
+        assert(!client.put("after", "disconnect"));
+    }
+
+    {
+        Server shard0(TEST_DATA_DIR + "/shard0", 0, 1);
+        Server shard1(TEST_DATA_DIR + "/shard1", 0, 1);
+        shard0.start();
+        shard1.start();
+        ShardedClient client(2);
+        bool ok = client.initialize({"127.0.0.1:" + std::to_string(shard0.port()),
+                                     "127.0.0.1:" + std::to_string(shard1.port())});
+        assert(ok);
+        (void)ok;
+
+        std::atomic<int> failures{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < 200; i++) {
+                    std::string key = "sharded" + std::to_string(t) + "_" + std::to_string(i);
+                    if (!client.put(key, key) || client.get(key) != key) failures++;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        assert(failures == 0);
+        assert(client.pingAll());
+
+        shard0.stop();
+        shard1.stop();
+    }
+    cleanup_test_dir();
+    std::cout << "[PASS] Async Client\n\n";
+}
+
+void test_sharded_multi_key() {
+    std::cout << "[TEST] Sharded Multi-key\n";
+    cleanup_test_dir();
+
+    constexpr int NUM_SHARDS = 3;
+    constexpr int NUM_KEYS = 500;
+
+    std::vector<std::unique_ptr<Server>> shards;
+    std::vector<std::string> addrs;
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        shards.push_back(std::make_unique<Server>(TEST_DATA_DIR + "/shard" + std::to_string(i), 0, 1));
+        shards.back()->start();
+        addrs.push_back("127.0.0.1:" + std::to_string(shards.back()->port()));
+    }
+
+    {
+        ShardedClient client(2);
+        bool ok = client.initialize(addrs);
+        assert(ok);
+        (void)ok;
+
+        std::vector<std::pair<std::string, std::string>> pairs;
+        std::vector<std::string> keys;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            keys.push_back("page" + std::to_string(i));
+            pairs.emplace_back(keys.back(), "v" + std::to_string(i));
+        }
+        keys.push_back("never-written");
+
+        auto puts = client.multiPut(pairs);
+        assert(puts.size() == pairs.size());
+        for (const auto& result : puts) {
+            assert(result.ok());
+            (void)result;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto results = client.multiGet(keys);
+        auto scatter = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+        assert(results.size() == keys.size());
+        for (int i = 0; i < NUM_KEYS; i++) {
+            assert(results[i].ok() && results[i].value == "v" + std::to_string(i));
+        }
+        assert(results.back().ok() && !results.back().value);
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < NUM_KEYS; i++) {
+            client.get(keys[i]);
+        }
+        auto serial = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        );
+        std::cout << "  " << NUM_KEYS << " keys over " << NUM_SHARDS << " shards: multiGet "
+                  << scatter.count() << "us, one at a time " << serial.count() << "us\n";
+
+        // A shard going away fails only the keys it owns
+        shards[0]->stop();
+        results = client.multiGet(keys);
+        size_t failed = 0;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            if (client.getShardForKey(keys[i]) == addrs[0]) {
+                assert(!results[i].ok() && !results[i].value);
+                failed++;
+            } else {
+                assert(results[i].ok() && results[i].value == "v" + std::to_string(i));
+            }
+        }
+        assert(failed > 0 && failed < NUM_KEYS);
+        (void)failed;
+
+        auto dels = client.multiDel({keys[0], keys[1], keys[2]});
+        assert(dels.size() == 3);
+    }
+
+    for (auto& shard : shards) {
+        shard->stop();
+    }
+    shards.clear();
+    cleanup_test_dir();
+    std::cout << "[PASS] Sharded Multi-key\n\n";
+}
+
+void test_hash_ring() {
+    std::cout << "[TEST] Hash Ring\n";
+
+    constexpr int NUM_KEYS = 20000;
+    constexpr int VIRTUAL_NODES = 150;
+
+    HashRing ring(VIRTUAL_NODES);
+    assert(ring.empty() && ring.getNode("any").empty());
+
+    std::vector<std::string> nodes = {"10.0.0.1:7000", "10.0.0.2:7000", "10.0.0.3:7000", "10.0.0.4:7000"};
+    for (const auto& node : nodes) {
+        ring.addNode(node);
+    }
+    ring.addNode(nodes[0]);  // Adding twice is a no-op
+    assert(ring.size() == nodes.size());
+
+    // Same answers as a straightforward ordered-map ring
+    std::map<uint32_t, std::string> reference;
+    for (const auto& node : nodes) {
+        for (int i = 0; i < VIRTUAL_NODES; i++) {
+            reference.emplace(ring.hash(node + "#" + std::to_string(i)), node);
+        }
+    }
+    auto snapshot = ring.snapshot();
+    std::map<std::string, int> load;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        std::string key = "user:" + std::to_string(i);
+        auto it = reference.lower_bound(ring.hash(key));
+        const std::string& expected = (it == reference.end() ? reference.begin() : it)->second;
+        assert(snapshot->getNode(key) == expected);
+        assert(ring.getNode(key) == expected);
+        load[expected]++;
+    }
+    for (const auto& node : nodes) {
+        assert(load[node] > NUM_KEYS / static_cast<int>(nodes.size()) / 2);
+    }
+
+    // Removing a node moves only its own keys; old snapshots stay intact
+    ring.removeNode(nodes[1]);
+    assert(ring.size() == nodes.size() - 1);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        std::string key = "user:" + std::to_string(i);
+        const std::string& before = snapshot->getNode(key);
+        std::string after = ring.getNode(key);
+        assert(after != nodes[1]);
+        assert(before == nodes[1] || after == before);
+    }
+
+    // Readers never block on, or see a torn ring during, membership changes
+    std::atomic<bool> done{false};
+    std::atomic<long> lookups{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t]() {
+            long n = 0;
+            while (!done) {
+                const std::string& node = ring.snapshot()->getNode("key" + std::to_string(t * 100000 + n % 1000));
+                assert(!node.empty());
+                (void)node;
+                n++;
+            }
+            lookups += n;
+        });
+    }
+    for (int i = 0; i < 50; i++) {
+        ring.addNode("10.0.1." + std::to_string(i) + ":7000");
+        ring.removeNode("10.0.1." + std::to_string(i) + ":7000");
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(ring.size() == nodes.size() - 1);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t hits = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        hits += ring.snapshot()->getNode("user:" + std::to_string(i)).size();
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    assert(hits > 0);
+    std::cout << "  " << NUM_KEYS << " lookups in " << duration.count() << "us ("
+              << lookups.load() << " concurrent with membership changes)\n";
+
+    std::cout << "[PASS] Hash Ring\n\n";
+}
+
+const std::string RAFT_LOG_TEST_DIR = "./raft_log_test_data";
+
+void test_raft_log() {
+    std::cout << "[TEST] Segmented Raft Log\n";
+    std::filesystem::remove_all(RAFT_LOG_TEST_DIR);
+
+    constexpr int NUM_ENTRIES = 1000;
+    RaftLogOptions options;
+    options.segment_bytes = 4096;
+    options.cache_entries = 16;
+
+    auto makeEntry = [](uint64_t term, int i) {
+        return RaftLogEntry{term, 0, OpCode::OP_PUT, "key" + std::to_string(i), "value" + std::to_string(i)};
+    };
+
+    size_t segments;
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.lastIndex() == 0 && log.lastTerm() == 0 && log.termAt(0) == 0);
+
+        for (int i = 1; i <= NUM_ENTRIES; i += 10) {
+            std::vector<RaftLogEntry> batch;
+            for (int j = i; j < i + 10; j++) {
+                batch.push_back(makeEntry(1 + j / 300, j));
+            }
+            assert(log.append(std::move(batch)) == static_cast<uint64_t>(i + 9));
+            log.sync();
+        }
+        assert(log.lastIndex() == NUM_ENTRIES && log.lastTerm() == 1 + NUM_ENTRIES / 300);
+        segments = log.segmentCount();
+        assert(segments > 1);
+
+        // Old entries come back from disk, new ones from the cache
+        RaftLogEntry first = log.entry(1);
+        assert(first.index == 1 && first.term == 1 && first.key == "key1" && first.value == "value1");
+        assert(log.entry(NUM_ENTRIES).key == "key" + std::to_string(NUM_ENTRIES));
+        auto range = log.entries(295, 305);
+        assert(range.size() == 11 && range.front().index == 295 && range.back().term == 2);
+        assert(log.entries(990, 2000, 5).size() == 5);
+        assert(log.termAt(NUM_ENTRIES + 1) == 0);
+
+        // Runs read from disk span segments and stop at the byte limit
+        auto all = log.entries(1, NUM_ENTRIES);
+        assert(all.size() == NUM_ENTRIES && all[499].index == 500 && all[499].key == "key500");
+        size_t entry_size = all.front().encodedSize();
+        auto limited = log.entries(1, NUM_ENTRIES, NUM_ENTRIES, entry_size * 10);
+        assert(limited.size() >= 10 && limited.size() <= 11);
+        assert(log.entries(1, NUM_ENTRIES, NUM_ENTRIES, 1).size() == 1);
+
+        // Terms only grow, so each one covers a contiguous range
+        assert(log.firstIndexOfTerm(1) == 1 && log.lastIndexOfTerm(1) == 299);
+        assert(log.firstIndexOfTerm(2) == 300 && log.lastIndexOfTerm(2) == 599);
+        assert(log.firstIndexOfTerm(99) == 0 && log.lastIndexOfTerm(99) == 0);
+    }
+
+    // Reopening rebuilds the index from the segments
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.lastIndex() == NUM_ENTRIES && log.segmentCount() == segments);
+        assert(log.entry(500).key == "key500" && log.termAt(600) == 3);
+
+        // A conflicting suffix is cut off, dropping whole segments
+        log.truncateFrom(101);
+        assert(log.lastIndex() == 100 && log.segmentCount() < segments);
+        assert(log.append(makeEntry(9, 101)) == 101);
+        log.sync();
+    }
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.lastIndex() == 101 && log.termAt(101) == 9 && log.termAt(100) == 1);
+        assert(log.entry(100).key == "key100");
+    }
+
+    // A torn tail is cut off, and appends after it survive the next restart
+    std::vector<std::filesystem::path> files;
+    for (const auto& file : std::filesystem::directory_iterator(RAFT_LOG_TEST_DIR)) {
+        files.push_back(file.path());
+    }
+    std::sort(files.begin(), files.end());
+    std::filesystem::resize_file(files.back(), std::filesystem::file_size(files.back()) - 3);
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.lastIndex() == 100);
+        log.append(makeEntry(10, 101));
+        log.sync();
+    }
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.lastIndex() == 101 && log.lastTerm() == 10);
+    }
+
+    // Damage in an early segment discards everything after it
+    {
+        std::fstream file(files.front(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(std::filesystem::file_size(files.front()) / 2);
+        file.put('\xff');
+    }
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.lastIndex() > 0 && log.lastIndex() < 100 && log.segmentCount() == 1);
+        assert(log.entry(log.lastIndex()).index == log.lastIndex());
+    }
+
+    // Compaction drops whole segments below a snapshot point; the entry just
+    // before the log still has a term, and appends carry on after it
+    std::filesystem::remove_all(RAFT_LOG_TEST_DIR);
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        for (int i = 1; i <= NUM_ENTRIES; i++) {
+            log.append(makeEntry(1 + i / 300, i));
+        }
+        log.sync();
+        segments = log.segmentCount();
+
+        log.compact(500, 2);
+        assert(log.firstIndex() == 501 && log.termAt(500) == 2 && log.termAt(499) == 0);
+        assert(log.segmentCount() < segments && log.lastIndex() == NUM_ENTRIES);
+        assert(log.entry(501).key == "key501" && log.entries(400, 510).front().index == 501);
+        log.compact(100, 1);
+        assert(log.firstIndex() == 501);
+    }
+    {
+        // The base term is the owner's to restore, from its snapshot
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.firstIndex() <= 501 && log.lastIndex() == NUM_ENTRIES);
+        log.compact(600, 3);
+        assert(log.firstIndex() == 601 && log.termAt(600) == 3);
+
+        // Compacting past the end empties the log; the next entry follows the snapshot
+        log.compact(2000, 7);
+        assert(log.firstIndex() == 2001 && log.lastIndex() == 2000 && log.lastTerm() == 7);
+        assert(log.append(makeEntry(8, 2001)) == 2001);
+        log.sync();
+    }
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR, options);
+        assert(log.firstIndex() == 2001 && log.lastIndex() == 2001 && log.termAt(2001) == 8);
+    }
+
+    // Appends are batched: one fsync per batch, as a follower does per AppendEntries
+    std::filesystem::remove_all(RAFT_LOG_TEST_DIR);
+    constexpr int NUM_BATCHES = 200;
+    constexpr int BATCH_SIZE = 100;
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        RaftLog log(RAFT_LOG_TEST_DIR);
+        for (int b = 0; b < NUM_BATCHES; b++) {
+            std::vector<RaftLogEntry> batch;
+            for (int i = 0; i < BATCH_SIZE; i++) {
+                batch.push_back(makeEntry(1, b * BATCH_SIZE + i));
+            }
+            log.append(std::move(batch));
+            log.sync();
+        }
+        assert(log.lastIndex() == NUM_BATCHES * BATCH_SIZE);
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    std::cout << "  Appended " << NUM_BATCHES * BATCH_SIZE << " entries in " << NUM_BATCHES
+              << " synced batches in " << duration.count() << "ms\n";
+
+    std::filesystem::remove_all(RAFT_LOG_TEST_DIR);
+    std::cout << "[PASS] Segmented Raft Log\n\n";
+}
+
+const std::string RAFT_CLUSTER_TEST_DIR = "./raft_cluster_test_data";
+const std::vector<uint16_t> RAFT_CLUSTER_PORTS = {19301, 19302, 19303};
+
+std::string raft_node_dir(size_t i) {
+    return RAFT_CLUSTER_TEST_DIR + "/node" + std::to_string(i);
+}
+
+// Member i of a three-node cluster on fixed local ports, started
+std::unique_ptr<RaftNode> start_raft_node(size_t i, RaftOptions options = {}) {
+    std::vector<std::string> peers;
+    for (uint16_t port : RAFT_CLUSTER_PORTS) {
+        peers.push_back("127.0.0.1:" + std::to_string(port));
+    }
+    auto node = std::make_unique<RaftNode>(raft_node_dir(i), RAFT_CLUSTER_PORTS[i], peers, options);
+    node->start();
+    return node;
+}
+
+// Start the first `running` members of the cluster, over whatever data
+// their directories already hold; returns once one of them leads
+std::vector<std::unique_ptr<RaftNode>> start_raft_cluster(size_t& leader,
+                                                          size_t running = RAFT_CLUSTER_PORTS.size(),
+                                                          RaftOptions options = {}) {
+    std::vector<std::unique_ptr<RaftNode>> nodes;
+    for (size_t i = 0; i < running; i++) {
+        nodes.push_back(start_raft_node(i, options));
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i]->getRole() == RaftRole::RAFT_LEADER) {
+                leader = i;
+                return nodes;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    assert(false && "no leader elected");
+    return nodes;
+}
+
+// A numeric field of a node's status, such as log_size
+uint64_t raft_status_field(Client& client, const std::string& field) {
+    std::string status = *client.status();
+    size_t pos = status.find(field + ":") + field.size() + 1;
+    return std::stoull(status.substr(pos, status.find('\n', pos) - pos));
+}
+
+void stop_raft_cluster(std::vector<std::unique_ptr<RaftNode>>& nodes) {
+    for (auto& node : nodes) {
+        node->stop();
+    }
+    nodes.clear();
+    std::filesystem::remove_all(RAFT_CLUSTER_TEST_DIR);
+}
+
+void test_raft_write_path() {
+    std::cout << "[TEST] Raft Commit-Waiting Writes\n";
+    std::filesystem::remove_all(RAFT_CLUSTER_TEST_DIR);
+
+    size_t leader = 0;
+    auto nodes = start_raft_cluster(leader);
+    size_t follower = (leader + 1) % nodes.size();
+
+    Client client;
+    bool connected = client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[leader]);
+    assert(connected);
+    (void)connected;
+
+    // Followers turn writes away
+    {
+        Client follower_client;
+        follower_client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[follower]);
+        assert(!follower_client.put("key", "value"));
+    }
+
+    // An acknowledged write has been committed and applied on the leader
+    for (int i = 0; i < 100; i++) {
+        std::string key = "raft" + std::to_string(i);
+        assert(client.put(key, "value" + std::to_string(i)));
+        auto value = client.get(key);
+        assert(value && *value == "value" + std::to_string(i));
+    }
+    assert(client.del("raft0") && !client.get("raft0"));
+
+    // A batch is a single entry, so it commits and applies as a whole
+    assert(client.multiPut({{"multi1", "a"}, {"multi2", "b"}, {"multi3", "c"}}));
+    assert(client.multiDel({"multi2"}));
+    auto multi = client.multiGet({"multi1", "multi2", "multi3"});
+    assert(multi && (*multi)[0] == std::string("a") && !(*multi)[1]);
+    assert((*multi)[2] == std::string("c"));
+    (void)multi;
+
+    // Pipelined writes are proposed together and share fsyncs and round trips
+    constexpr int NUM_WRITES = 2000;
+    std::vector<Request> puts;
+    for (int i = 0; i < NUM_WRITES; i++) {
+        puts.push_back({OpCode::OP_PUT, "batch" + std::to_string(i), "value" + std::to_string(i)});
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& resp : client.pipeline(puts)) {
+        assert(resp.status == StatusCode::STATUS_OK);
+        (void)resp;
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    std::cout << "  " << NUM_WRITES << " pipelined writes committed in " << duration.count() << "ms\n";
+
+    // Followers apply the same entries once they learn the commit index
+    Client follower_client;
+    follower_client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[follower]);
+    std::string last_key = "batch" + std::to_string(NUM_WRITES - 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!follower_client.get(last_key) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    assert(follower_client.get(last_key) == "value" + std::to_string(NUM_WRITES - 1));
+    assert(follower_client.get("raft50") == std::string("value50"));
+    assert(follower_client.get("multi3") == std::string("c") && !follower_client.get("multi2"));
+
+    client.disconnect();
+    follower_client.disconnect();
+    stop_raft_cluster(nodes);
+    std::cout << "[PASS] Raft Commit-Waiting Writes\n\n";
+}
+
+void test_raft_sharded_multi_key() {
+    std::cout << "[TEST] Sharded Multi-key over Raft\n";
+    std::filesystem::remove_all(RAFT_CLUSTER_TEST_DIR);
+
+    // Each shard is a single-node cluster, as kv_server runs it
+    std::vector<std::unique_ptr<RaftNode>> shards;
+    std::vector<std::string> addrs;
+    for (size_t i = 0; i < 2; i++) {
+        std::string addr = "127.0.0.1:" + std::to_string(RAFT_CLUSTER_PORTS[i]);
+        shards.push_back(std::make_unique<RaftNode>(raft_node_dir(i), RAFT_CLUSTER_PORTS[i],
+                                                    std::vector<std::string>{addr}));
+        shards.back()->start();
+        addrs.push_back(addr);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+    for (auto& shard : shards) {
+        while (shard->getRole() != RaftRole::RAFT_LEADER &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        assert(shard->getRole() == RaftRole::RAFT_LEADER);
+    }
+
+    {
+        ShardedClient client(2);
+        bool ok = client.initialize(addrs);
+        assert(ok);
+        (void)ok;
+
+        std::vector<std::pair<std::string, std::string>> pairs;
+        std::vector<std::string> keys;
+        for (int i = 0; i < 100; i++) {
+            keys.push_back("page" + std::to_string(i));
+            pairs.emplace_back(keys.back(), "v" + std::to_string(i));
+        }
+        for (const auto& result : client.multiPut(pairs)) {
+            assert(result.ok());
+            (void)result;
+        }
+        auto results = client.multiGet(keys);
+        for (int i = 0; i < 100; i++) {
+            assert(results[i].ok() && results[i].value == "v" + std::to_string(i));
+        }
+
+        for (const auto& result : client.multiDel({keys[0], keys[1], keys[2]})) {
+            assert(result.ok());
+            (void)result;
+        }
+        results = client.multiGet({keys[0], keys[3]});
+        assert(results[0].ok() && !results[0].value);
+        assert(results[1].ok() && results[1].value == std::string("v3"));
+    }
+
+    stop_raft_cluster(shards);
+    std::cout << "[PASS] Sharded Multi-key over Raft\n\n";
+}
+
+void test_raft_stalled_follower() {
+    std::cout << "[TEST] Raft Replication Past a Stalled Follower\n";
+    std::filesystem::remove_all(RAFT_CLUSTER_TEST_DIR);
+
+    // The third member accepts connections but never answers, so every RPC
+    // sent to it waits out the full socket timeout
+    int stalled = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(stalled, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(RAFT_CLUSTER_PORTS[2]);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int bound = bind(stalled, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    assert(bound == 0 && listen(stalled, 16) == 0);
+    (void)bound;
+
+    size_t leader = 0;
+    auto nodes = start_raft_cluster(leader, 2);
+
+    Client client;
+    bool connected = client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[leader]);
+    assert(connected);
+    (void)connected;
+
+    // Commit only needs the healthy follower; a single write stuck behind the
+    // stalled one would take a second
+    constexpr int NUM_WRITES = 50;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_WRITES; i++) {
+        assert(client.put("stall" + std::to_string(i), "value"));
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    assert(duration.count() < 1000);
+    std::cout << "  " << NUM_WRITES << " sequential writes with one follower stalled in "
+              << duration.count() << "ms\n";
+
+    client.disconnect();
+    stop_raft_cluster(nodes);
+    close(stalled);
+    std::cout << "[PASS] Raft Replication Past a Stalled Follower\n\n";
+}
+
+void test_raft_follower_catch_up() {
+    std::cout << "[TEST] Raft Follower Catch-up\n";
+    std::filesystem::remove_all(RAFT_CLUSTER_TEST_DIR);
+
+    // Two members start at term 5; the third holds entries from term 1 that
+    // never committed and must be replaced by the leader's
+    for (size_t i = 0; i < 2; i++) {
+        std::filesystem::create_directories(raft_node_dir(i));
+        PersistentState{5, std::nullopt}.save(raft_node_dir(i) + "/raft_state.dat");
+    }
+    constexpr int NUM_STALE = 3000;
+    {
+        RaftLog log(raft_node_dir(2) + "/raft_log");
+        std::vector<RaftLogEntry> stale;
+        for (int i = 0; i < NUM_STALE; i++) {
+            stale.push_back(RaftLogEntry{1, 0, OpCode::OP_PUT, "stale" + std::to_string(i), "value"});
+        }
+        log.append(std::move(stale));
+        log.sync();
+    }
+
+    // Without snapshots, so the late member has to catch up from the log
+    RaftOptions options;
+    options.snapshot_entries = 0;
+    size_t leader = 0;
+    auto nodes = start_raft_cluster(leader, 2, options);
+    assert(nodes[leader]->getCurrentTerm() > 5);
+
+    Client client;
+    bool connected = client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[leader]);
+    assert(connected);
+    (void)connected;
+
+    constexpr int NUM_WRITES = 20000;
+    std::vector<Request> puts;
+    for (int i = 0; i < NUM_WRITES; i++) {
+        puts.push_back({OpCode::OP_PUT, "catchup" + std::to_string(i), std::string(100, 'x')});
+    }
+    for (const auto& resp : client.pipeline(puts)) {
+        assert(resp.status == StatusCode::STATUS_OK);
+        (void)resp;
+    }
+
+    // The late member finds where its log diverges in a few round trips, not
+    // one per entry, then takes the rest in pipelined batches
+    auto start = std::chrono::high_resolution_clock::now();
+    nodes.push_back(start_raft_node(2, options));
+    Client late_client;
+    bool late_connected = late_client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[2]);
+    assert(late_connected);
+    (void)late_connected;
+
+    std::string last_key = "catchup" + std::to_string(NUM_WRITES - 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (!late_client.get(last_key) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    assert(late_client.get(last_key));
+    assert(late_client.get("catchup0") && !late_client.get("stale0"));
+
+    assert(raft_status_field(late_client, "log_size") == raft_status_field(client, "log_size"));
+    std::cout << "  Replaced " << NUM_STALE << " stale entries and caught up on " << NUM_WRITES
+              << " in " << duration.count() << "ms (including startup)\n";
+
+    client.disconnect();
+    late_client.disconnect();
+    stop_raft_cluster(nodes);
+    std::cout << "[PASS] Raft Follower Catch-up\n\n";
+}
+
+void test_raft_snapshot() {
+    std::cout << "[TEST] Raft Snapshots and InstallSnapshot\n";
+    std::filesystem::remove_all(RAFT_CLUSTER_TEST_DIR);
+
+    RaftOptions options;
+    options.snapshot_entries = 500;
+    options.snapshot_trailing_entries = 100;
+    options.snapshot_chunk_bytes = 16 * 1024;   // Several chunks per SSTable
+
+    size_t leader = 0;
+    auto nodes = start_raft_cluster(leader, 2, options);
+
+    Client client;
+    bool connected = client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[leader]);
+    assert(connected);
+    (void)connected;
+
+    std::mutex synced_mutex;
+    std::vector<std::string> synced;
+    setSyncObserver([&](const std::string& path) {
+        std::lock_guard<std::mutex> lock(synced_mutex);
+        synced.push_back(path);
+    });
+
+    constexpr int NUM_WRITES = 3000;
+    std::vector<Request> writes;
+    for (int i = 0; i < NUM_WRITES; i++) {
+        writes.push_back({OpCode::OP_PUT, "snap" + std::to_string(i), std::string(100, 'x')});
+    }
+    writes.push_back({OpCode::OP_DELETE, "snap0", ""});
+    for (const auto& resp : client.pipeline(writes)) {
+        assert(resp.status == StatusCode::STATUS_OK);
+        (void)resp;
+    }
+
+    // The log no longer holds the early entries, so the third member can
+    // only start from the leader's snapshot
+    uint64_t snapshot_index = raft_status_field(client, "snapshot_index");
+    assert(snapshot_index >= NUM_WRITES - options.snapshot_entries);
+
+    // which was synced, META and all, and then named in a synced directory
+    {
+        std::lock_guard<std::mutex> lock(synced_mutex);
+        auto meta = std::find_if(synced.begin(), synced.end(), [](const std::string& path) {
+            return path.size() > 9 && path.compare(path.size() - 9, 9, ".tmp/META") == 0;
+        });
+        assert(meta != synced.end());
+        assert(std::find(meta, synced.end(), raft_node_dir(leader)) != synced.end());
+        (void)meta;
+    }
+    setSyncObserver(nullptr);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    nodes.push_back(start_raft_node(2, options));
+    Client late_client;
+    bool late_connected = late_client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[2]);
+    assert(late_connected);
+    (void)late_connected;
+
+    std::string last_key = "snap" + std::to_string(NUM_WRITES - 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (!late_client.get(last_key) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    assert(late_client.get(last_key) && late_client.get("snap1") && !late_client.get("snap0"));
+    assert(raft_status_field(late_client, "snapshot_index") >= snapshot_index);
+    assert(raft_status_field(late_client, "log_size") == raft_status_field(client, "log_size"));
+    std::cout << "  Installed a snapshot at index " << raft_status_field(late_client, "snapshot_index")
+              << " and caught up in " << duration.count() << "ms (including startup)\n";
+
+    // A restart recovers the store from the snapshot and the log after it
+    late_client.disconnect();
+    nodes[2]->stop();
+    nodes[2] = start_raft_node(2, options);
+    late_connected = late_client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[2]);
+    assert(late_connected);
+    assert(late_client.get(last_key) && !late_client.get("snap0"));
+    assert(raft_status_field(late_client, "snapshot_index") >= snapshot_index);
+
+    // A snapshot received just before a crash is installed on the next start
+    late_client.disconnect();
+    nodes[2]->stop();
+    std::filesystem::path leader_snapshot;
+    for (const auto& entry : std::filesystem::directory_iterator(raft_node_dir(leader))) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("snapshot-", 0) == 0 && name.find('.') == std::string::npos) {
+            leader_snapshot = entry.path();
+        }
+    }
+    uint64_t received_index = 0;
+    uint64_t received_term = 0;
+    std::ifstream(leader_snapshot / "META") >> received_index >> received_term;
+    std::filesystem::remove_all(raft_node_dir(2));
+    std::string incoming = RaftSnapshot::incomingDir(raft_node_dir(2), received_index);
+    std::filesystem::create_directories(incoming);
+    for (const auto& entry : std::filesystem::directory_iterator(leader_snapshot)) {
+        std::filesystem::copy_file(entry.path(), incoming + "/" + entry.path().filename().string());
+    }
+    assert(RaftSnapshot::install(raft_node_dir(2), received_index, received_term)->pendingInstall());
+    {
+        std::vector<std::string> peers;
+        for (uint16_t port : RAFT_CLUSTER_PORTS) {
+            peers.push_back("127.0.0.1:" + std::to_string(port));
+        }
+        RaftNode recovered(raft_node_dir(2), RAFT_CLUSTER_PORTS[2], peers, options);
+    }
+    {
+        LSMTree store(raft_node_dir(2));
+        assert(store.get("snap1") && store.get("snap0"));  // Deleted after the snapshot
+        assert(!RaftSnapshot::loadLatest(raft_node_dir(2))->pendingInstall());
+    }
+
+    client.disconnect();
+    stop_raft_cluster(nodes);
+    std::cout << "[PASS] Raft Snapshots and InstallSnapshot\n\n";
+}
+
+void test_raft_read_index() {
+    std::cout << "[TEST] Raft ReadIndex Reads\n";
+    std::filesystem::remove_all(RAFT_CLUSTER_TEST_DIR);
+
+    size_t leader = 0;
+    auto nodes = start_raft_cluster(leader);
+
+    Client client;
+    bool connected = client.connect("127.0.0.1", RAFT_CLUSTER_PORTS[leader]);
+    assert(connected);
+    (void)connected;
+
+    // A read sees every write acknowledged before it was sent
+    for (int i = 0; i < 100; i++) {
+        std::string key = "read" + std::to_string(i);
+        assert(client.put(key, "value" + std::to_string(i)));
+        assert(client.get(key) == "value" + std::to_string(i));
+    }
+
+    // Reads that arrive together share a confirmation round
+    constexpr int NUM_READS = 2000;
+    std::vector<Request> gets;
+    for (int i = 0; i < NUM_READS; i++) {
+        gets.push_back({OpCode::OP_GET, "read" + std::to_string(i % 100), ""});
+    }
+    uint64_t rounds_before = raft_status_field(client, "read_rounds");
+    auto start = std::chrono::high_resolution_clock::now();
+    auto responses = client.pipeline(gets);
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    );
+    for (int i = 0; i < NUM_READS; i++) {
+        assert(responses[i].status == StatusCode::STATUS_OK);
+        assert(responses[i].value == "value" + std::to_string(i % 100));
+    }
+    uint64_t rounds = raft_status_field(client, "read_rounds") - rounds_before;
+    assert(rounds > 0 && rounds < NUM_READS / 10);
+    std::cout << "  " << NUM_READS << " pipelined reads in " << duration.count() << "us, "
+              << rounds << " confirmation rounds\n";
+
+    // Cut off from both followers, the leader cannot confirm it still leads,
+    // so it fails reads instead of answering from what may be stale state
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (i != leader) nodes[i]->stop();
+    }
+    auto isolated = client.pipeline({{OpCode::OP_GET, "read1", ""}});
+    assert(isolated.size() == 1 && isolated[0].status == StatusCode::STATUS_ERROR);
+
+    client.disconnect();
+    stop_raft_cluster(nodes);
+    std::cout << "[PASS] Raft ReadIndex Reads\n\n";
+}
+
 int main() {
     std::cout << "\n=== Distributed KV Store Tests ===\n\n";
 
@@ -407,11 +2575,40 @@ int main() {
     test_persistence_recovery();
     test_persistence_checkpoint();
     test_persistence_performance();
+    test_wal_checksums();
 
+    test_memtable_skiplist();
     test_lsm_basic();
     test_lsm_flush();
     test_lsm_recovery();
     test_lsm_large_dataset();
+    test_lsm_compaction();
+    test_sstable_bloom_filter();
+    test_sstable_block_format();
+    test_lsm_block_cache();
+    test_lsm_mmap_reads();
+    test_lsm_background_flush();
+    test_lsm_group_commit();
+    test_lsm_durable_flush();
+    test_lsm_write_batch();
+    test_lsm_scan();
+    test_lsm_checkpoint();
+
+    test_protocol_views();
+    test_event_server();
+    test_request_pipelining();
+    test_multi_key_requests();
+    test_hash_ring();
+    test_async_client();
+    test_sharded_multi_key();
+
+    test_raft_log();
+    test_raft_write_path();
+    test_raft_sharded_multi_key();
+    test_raft_stalled_follower();
+    test_raft_follower_catch_up();
+    test_raft_snapshot();
+    test_raft_read_index();
 
     std::cout << "=== All tests passed ===\n\n";
     return 0;
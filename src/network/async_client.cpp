@@ -0,0 +1,480 @@
+#include "network/async_client.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace dkv {
+
+namespace {
+
+constexpr size_t RECV_CHUNK_SIZE = 64 * 1024;
+constexpr size_t MAX_MESSAGE_SIZE = 10 * 1024 * 1024;
+constexpr size_t IDLE_BUFFER_CAPACITY = 64 * 1024;   // Larger buffers are freed once drained
+constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(1);
+constexpr auto RECONNECT_BACKOFF = std::chrono::milliseconds(200);  // After a failed connect
+
+Response errorResponse(const std::string& why) {
+    return {StatusCode::STATUS_ERROR, "", why};
+}
+
+void complete(AsyncClient::Callback& callback, Response resp) {
+    try {
+        callback(std::move(resp));
+    } catch (const std::exception& e) {
+        std::cerr << "[AsyncClient] Callback failed: " << e.what() << std::endl;
+    }
+}
+
+void releaseIfIdle(std::vector<uint8_t>& buffer) {
+    if (buffer.empty() && buffer.capacity() > IDLE_BUFFER_CAPACITY) {
+        std::vector<uint8_t>().swap(buffer);
+    }
+}
+
+} // namespace
+
+struct AsyncClient::Conn {
+    enum class State { DOWN, CONNECTING, UP };
+
+    std::mutex mutex;
+    State state = State::DOWN;
+    int fd = -1;                   // -1 while DOWN, and while CONNECTING until the I/O thread starts
+    std::chrono::steady_clock::time_point deadline;  // CONNECTING: give up then
+    std::chrono::steady_clock::time_point retry_at;  // DOWN: fail requests until then
+    uint32_t next_id = 1;
+    std::vector<uint8_t> out;      // Framed requests not yet written
+    size_t out_offset = 0;
+    std::unordered_map<uint32_t, Callback> pending;  // Queued or sent, not yet answered
+    std::vector<uint8_t> in;       // Partial response; only the I/O thread touches it
+};
+
+AsyncClient::AsyncClient(size_t pool_size) : pool_size_(std::max<size_t>(1, pool_size)) {}
+
+AsyncClient::~AsyncClient() {
+    disconnect();
+}
+
+bool AsyncClient::connect(const std::string& host, uint16_t port) {
+    disconnect();
+
+    host_ = host;
+    port_ = port;
+    conns_.clear();
+    for (size_t i = 0; i < pool_size_; i++) {
+        auto conn = std::make_unique<Conn>();
+        if (!openConnection(*conn)) {
+            for (auto& open : conns_) {
+                ::close(open->fd);
+            }
+            conns_.clear();
+            return false;
+        }
+        conns_.push_back(std::move(conn));
+    }
+
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        for (auto& conn : conns_) {
+            ::close(conn->fd);
+        }
+        conns_.clear();
+        return false;
+    }
+
+    running_ = true;
+    io_thread_ = std::thread(&AsyncClient::ioLoop, this);
+    return true;
+}
+
+void AsyncClient::disconnect() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    wake();
+    io_thread_.join();
+
+    for (auto& conn : conns_) {
+        failConnection(*conn, "Disconnected");
+    }
+    ::close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+bool AsyncClient::openConnection(Conn& conn) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0) {
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    if (::inet_pton(AF_INET, host_.c_str(), &addr.sin_addr) <= 0 ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    conn.fd = fd;
+    connectedLocked(conn);
+    return true;
+}
+
+void AsyncClient::connectedLocked(Conn& conn) {
+    // Requests are already batched in the output buffer; don't let Nagle
+    // hold back the tail of a batch
+    int one = 1;
+    ::setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    conn.state = Conn::State::UP;
+}
+
+bool AsyncClient::startConnectLocked(Conn& conn) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0) {
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    if (::inet_pton(AF_INET, host_.c_str(), &addr.sin_addr) <= 0) {
+        ::close(fd);
+        return false;
+    }
+    conn.fd = fd;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        connectedLocked(conn);
+    } else if (errno == EINPROGRESS) {
+        conn.deadline = std::chrono::steady_clock::now() + CONNECT_TIMEOUT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ==================== Requests ====================
+
+void AsyncClient::submit(Request req, Callback callback) {
+    if (!running_) {
+        complete(callback, errorResponse("Not connected"));
+        return;
+    }
+
+    Conn& conn = *conns_[next_conn_.fetch_add(1, std::memory_order_relaxed) % conns_.size()];
+    bool was_idle;
+    {
+        std::unique_lock<std::mutex> lock(conn.mutex);
+        // A connection that is down is reopened by the I/O thread, without
+        // blocking here; requests queue behind the connect. Right after a
+        // connect failed they fail at once instead.
+        bool reconnecting = conn.state == Conn::State::DOWN &&
+                            std::chrono::steady_clock::now() >= conn.retry_at;
+        if (!running_ || (conn.state == Conn::State::DOWN && !reconnecting)) {
+            lock.unlock();
+            complete(callback, errorResponse("Cannot connect to " + host_ + ":" + std::to_string(port_)));
+            return;
+        }
+        if (reconnecting) {
+            conn.state = Conn::State::CONNECTING;
+        }
+
+        req.id = conn.next_id++;
+        if (conn.next_id == 0) {
+            conn.next_id = 1;  // Leave 0 for peers that don't number their requests
+        }
+        conn.pending.emplace(req.id, std::move(callback));
+
+        was_idle = conn.out_offset == conn.out.size() || reconnecting;
+        appendFrame(conn.out, req);
+    }
+
+    // Anything already queued has woken the I/O thread, which writes the
+    // whole buffer, so only the first request of a batch needs a wakeup
+    if (was_idle) {
+        wake();
+    }
+}
+
+std::future<Response> AsyncClient::submit(Request req) {
+    auto promise = std::make_shared<std::promise<Response>>();
+    auto future = promise->get_future();
+    submit(std::move(req), [promise](Response resp) {
+        if (resp.status != StatusCode::STATUS_PARTIAL) {
+            promise->set_value(std::move(resp));
+        }
+    });
+    return future;
+}
+
+std::future<std::optional<std::string>> AsyncClient::getAsync(const std::string& key) {
+    auto promise = std::make_shared<std::promise<std::optional<std::string>>>();
+    auto future = promise->get_future();
+    submit({OpCode::OP_GET, key, ""}, [promise](Response resp) {
+        if (resp.status == StatusCode::STATUS_OK) {
+            promise->set_value(std::move(resp.value));
+        } else {
+            promise->set_value(std::nullopt);
+        }
+    });
+    return future;
+}
+
+std::future<bool> AsyncClient::putAsync(const std::string& key, const std::string& value) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto future = promise->get_future();
+    submit({OpCode::OP_PUT, key, value}, [promise](Response resp) {
+        promise->set_value(resp.status == StatusCode::STATUS_OK);
+    });
+    return future;
+}
+
+std::future<bool> AsyncClient::delAsync(const std::string& key) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto future = promise->get_future();
+    submit({OpCode::OP_DELETE, key, ""}, [promise](Response resp) {
+        promise->set_value(resp.status == StatusCode::STATUS_OK);
+    });
+    return future;
+}
+
+bool AsyncClient::ping() {
+    return submit({OpCode::OP_PING, "", ""}).get().status == StatusCode::STATUS_OK;
+}
+
+// ==================== I/O thread ====================
+
+void AsyncClient::wake() {
+    uint64_t one = 1;
+    ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+    (void)n;  // A full counter already means a wakeup is pending
+}
+
+bool AsyncClient::flushLocked(Conn& conn) {
+    while (conn.out_offset < conn.out.size()) {
+        ssize_t n = ::send(conn.fd, conn.out.data() + conn.out_offset,
+                           conn.out.size() - conn.out_offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        conn.out_offset += static_cast<size_t>(n);
+    }
+
+    conn.out.clear();
+    conn.out_offset = 0;
+    releaseIfIdle(conn.out);
+    return true;
+}
+
+void AsyncClient::ioLoop() {
+    std::vector<pollfd> fds;
+    std::vector<Conn*> polled;
+    std::vector<Conn*> failed;
+    std::vector<Conn*> unreachable;
+    std::vector<std::pair<Callback, Response>> done;
+
+    while (running_) {
+        // Write what callers queued since the last pass; only connections
+        // the socket couldn't take everything from wait for POLLOUT
+        fds.clear();
+        polled.clear();
+        failed.clear();
+        unreachable.clear();
+        fds.push_back({wake_fd_, POLLIN, 0});
+        auto now = std::chrono::steady_clock::now();
+        int timeout_ms = -1;
+        for (auto& conn : conns_) {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            if (conn->state == Conn::State::DOWN) {
+                continue;
+            }
+            if (conn->state == Conn::State::CONNECTING) {
+                if ((conn->fd < 0 && !startConnectLocked(*conn)) ||
+                    (conn->state == Conn::State::CONNECTING && now >= conn->deadline)) {
+                    unreachable.push_back(conn.get());
+                    continue;
+                }
+            }
+            if (conn->state == Conn::State::CONNECTING) {
+                // Writable once the connect completes, either way
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(conn->deadline - now);
+                int left_ms = static_cast<int>(left.count()) + 1;
+                timeout_ms = timeout_ms < 0 ? left_ms : std::min(timeout_ms, left_ms);
+                fds.push_back({conn->fd, POLLOUT, 0});
+                polled.push_back(conn.get());
+                continue;
+            }
+            if (!flushLocked(*conn)) {
+                failed.push_back(conn.get());
+                continue;
+            }
+            short events = POLLIN;
+            if (conn->out_offset < conn->out.size()) {
+                events |= POLLOUT;
+            }
+            fds.push_back({conn->fd, events, 0});
+            polled.push_back(conn.get());
+        }
+        for (Conn* conn : failed) {
+            failConnection(*conn, "Connection lost");
+        }
+        for (Conn* conn : unreachable) {
+            failConnection(*conn, "Cannot connect to " + host_ + ":" + std::to_string(port_), true);
+        }
+
+        int ready = ::poll(fds.data(), fds.size(), timeout_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[AsyncClient] poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            ssize_t n = ::read(wake_fd_, &count, sizeof(count));
+            (void)n;
+        }
+
+        // Only this thread closes connections, so the polled fds are still
+        // the ones each connection owns
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            Conn& conn = *polled[i - 1];
+            bool ok = true;
+            {
+                std::lock_guard<std::mutex> lock(conn.mutex);
+                if (conn.state == Conn::State::CONNECTING) {
+                    int error = 0;
+                    socklen_t len = sizeof(error);
+                    ok = ::getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+                    if (ok) {
+                        connectedLocked(conn);  // Queued requests go out on the next pass
+                    }
+                }
+            }
+            if (!ok) {
+                failConnection(conn, "Cannot connect to " + host_ + ":" + std::to_string(port_), true);
+                continue;
+            }
+            if (fds[i].revents & POLLOUT) {
+                std::lock_guard<std::mutex> lock(conn.mutex);
+                ok = flushLocked(conn);
+            }
+            if (ok && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                ok = readResponses(conn, done);
+            }
+
+            for (auto& [callback, resp] : done) {
+                complete(callback, std::move(resp));
+            }
+            done.clear();
+
+            if (!ok) {
+                failConnection(conn, "Connection lost");
+            }
+        }
+    }
+}
+
+bool AsyncClient::readResponses(Conn& conn, std::vector<std::pair<Callback, Response>>& done) {
+    std::vector<uint8_t>& in = conn.in;
+    read_buffer_.resize(RECV_CHUNK_SIZE);
+    while (true) {
+        ssize_t n = ::recv(conn.fd, read_buffer_.data(), read_buffer_.size(), 0);
+        if (n > 0) {
+            in.insert(in.end(), read_buffer_.data(), read_buffer_.data() + n);
+            if (static_cast<size_t>(n) < read_buffer_.size()) {
+                break;
+            }
+            continue;
+        }
+
+        if (n == 0) {
+            return false;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+
+    std::vector<Response> responses;
+    size_t offset = 0;
+    while (in.size() - offset >= 4) {
+        const uint8_t* header = in.data() + offset;
+        uint32_t len = header[0] | (header[1] << 8) | (header[2] << 16) |
+                       (static_cast<uint32_t>(header[3]) << 24);
+        if (len > MAX_MESSAGE_SIZE) {
+            return false;
+        }
+        if (in.size() - offset - 4 < len) {
+            break;
+        }
+        try {
+            responses.push_back(Response::deserialize(
+                std::string_view(reinterpret_cast<const char*>(header + 4), len)));
+        } catch (const std::exception&) {
+            return false;
+        }
+        offset += 4 + len;
+    }
+    in.erase(in.begin(), in.begin() + offset);
+    releaseIfIdle(in);
+
+    // Claim every callback under one lock; the caller runs them unlocked
+    std::lock_guard<std::mutex> lock(conn.mutex);
+    for (auto& resp : responses) {
+        auto it = conn.pending.find(resp.id);
+        if (it == conn.pending.end()) {
+            continue;
+        }
+        if (resp.status == StatusCode::STATUS_PARTIAL) {
+            done.emplace_back(it->second, std::move(resp));
+        } else {
+            done.emplace_back(std::move(it->second), std::move(resp));
+            conn.pending.erase(it);
+        }
+    }
+    return true;
+}
+
+void AsyncClient::failConnection(Conn& conn, const std::string& why, bool backoff) {
+    std::unordered_map<uint32_t, Callback> pending;
+    {
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        if (conn.fd >= 0) {
+            ::close(conn.fd);
+            conn.fd = -1;
+        }
+        conn.state = Conn::State::DOWN;
+        conn.retry_at = std::chrono::steady_clock::now();
+        if (backoff) {
+            conn.retry_at += RECONNECT_BACKOFF;
+        }
+        pending.swap(conn.pending);
+        conn.out.clear();
+        conn.out_offset = 0;
+        conn.in.clear();
+    }
+
+    for (auto& [id, callback] : pending) {
+        complete(callback, errorResponse(why));
+    }
+}
+
+} // namespace dkv
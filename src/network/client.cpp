@@ -18,10 +18,15 @@ Client::~Client() {
 #endif
 }
 
+namespace {
+
+constexpr size_t RECV_CHUNK_SIZE = 64 * 1024;
+constexpr size_t MAX_MESSAGE_SIZE = 10 * 1024 * 1024;
+
+} // namespace
+
 bool Client::connect(const std::string& host, uint16_t port) {
-    if (connected_) {
-        disconnect();
-    }
+    disconnect();
 
     sock_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (sock_ == INVALID_SOCK) {
@@ -54,6 +59,11 @@ void Client::disconnect() {
         sock_ = INVALID_SOCK;
     }
     connected_ = false;
+
+    out_.clear();
+    in_.clear();
+    in_offset_ = 0;
+    inflight_.clear();
 }
 
 bool Client::put(const std::string& key, const std::string& value) {
@@ -94,74 +104,192 @@ std::optional<std::string> Client::status() {
     return std::nullopt;
 }
 
+std::optional<std::vector<std::pair<std::string, std::string>>>
+Client::scan(const std::string& start, const std::string& end, uint32_t limit) {
+    auto args = ScanRequest{end, limit}.serialize();
+    uint32_t id = submit({OpCode::OP_SCAN, start, std::string(args.begin(), args.end())});
+    Response resp = wait(id);
+
+    // The server streams the range back; keep reading until the final chunk
+    std::vector<std::pair<std::string, std::string>> result;
+    while (true) {
+        if (resp.status != StatusCode::STATUS_OK && resp.status != StatusCode::STATUS_PARTIAL) {
+            return std::nullopt;
+        }
+
+        ScanChunk chunk = ScanChunk::deserialize(
+            std::vector<uint8_t>(resp.value.begin(), resp.value.end()));
+        for (auto& entry : chunk.entries) {
+            result.push_back(std::move(entry));
+        }
+
+        if (resp.status == StatusCode::STATUS_OK) {
+            return result;
+        }
+
+        resp = wait(id);
+    }
+}
+
+std::optional<std::vector<std::optional<std::string>>>
+Client::multiGet(const std::vector<std::string>& keys) {
+    auto args = MultiRequest{keys, {}}.serialize();
+    Response resp = sendRequest({OpCode::OP_MGET, "", std::string(args.begin(), args.end())});
+    if (resp.status != StatusCode::STATUS_OK) {
+        return std::nullopt;
+    }
+
+    MultiGetResult result = MultiGetResult::deserialize(
+        std::vector<uint8_t>(resp.value.begin(), resp.value.end()));
+    if (result.values.size() != keys.size()) {
+        return std::nullopt;
+    }
+    return std::move(result.values);
+}
+
+bool Client::multiPut(const std::vector<std::pair<std::string, std::string>>& pairs) {
+    MultiRequest batch;
+    batch.keys.reserve(pairs.size());
+    batch.values.reserve(pairs.size());
+    for (const auto& [key, value] : pairs) {
+        batch.keys.push_back(key);
+        batch.values.push_back(value);
+    }
+
+    auto args = batch.serialize();
+    Response resp = sendRequest({OpCode::OP_MPUT, "", std::string(args.begin(), args.end())});
+    return resp.status == StatusCode::STATUS_OK;
+}
+
+bool Client::multiDel(const std::vector<std::string>& keys) {
+    auto args = MultiRequest{keys, {}}.serialize();
+    Response resp = sendRequest({OpCode::OP_MDEL, "", std::string(args.begin(), args.end())});
+    return resp.status == StatusCode::STATUS_OK;
+}
+
 Response Client::sendRequest(const Request& req) {
+    return wait(submit(req));
+}
+
+uint32_t Client::submit(Request req) {
     if (!connected_) {
         throw std::runtime_error("Not connected");
     }
 
-    auto data = req.serialize();
-    if (!sendMessage(data)) {
+    req.id = next_id_++;
+    if (next_id_ == 0) {
+        next_id_ = 1;  // Leave 0 for peers that don't number their requests
+    }
+    inflight_[req.id];
+
+    appendFrame(out_, req);
+
+    return req.id;
+}
+
+Response Client::wait(uint32_t id) {
+    auto it = inflight_.find(id);
+    if (it == inflight_.end()) {
+        throw std::runtime_error("Unknown request id " + std::to_string(id));
+    }
+
+    if (!flushRequests()) {
         connected_ = false;
         throw std::runtime_error("Failed to send request");
     }
 
-    auto resp_data = recvMessage();
-    if (resp_data.empty()) {
-        connected_ = false;
-        throw std::runtime_error("Failed to receive response");
+    while (it->second.empty()) {
+        auto resp_data = recvMessage();
+        if (resp_data.empty()) {
+            connected_ = false;
+            throw std::runtime_error("Failed to receive response");
+        }
+
+        Response resp = Response::deserialize(resp_data);
+        auto target = inflight_.find(resp.id);
+        if (target != inflight_.end()) {
+            target->second.push_back(std::move(resp));
+        }
     }
 
-    return Response::deserialize(resp_data);
+    Response resp = std::move(it->second.front());
+    it->second.pop_front();
+    if (resp.status != StatusCode::STATUS_PARTIAL) {
+        inflight_.erase(it);
+    }
+    return resp;
 }
 
-bool Client::sendMessage(const std::vector<uint8_t>& data) {
-    uint32_t len = static_cast<uint32_t>(data.size());
-    uint8_t header[4] = {
-        static_cast<uint8_t>((len >> 0) & 0xFF),
-        static_cast<uint8_t>((len >> 8) & 0xFF),
-        static_cast<uint8_t>((len >> 16) & 0xFF),
-        static_cast<uint8_t>((len >> 24) & 0xFF)
-    };
+std::vector<Response> Client::pipeline(std::vector<Request> requests) {
+    std::vector<uint32_t> ids;
+    ids.reserve(requests.size());
+    std::vector<Response> responses;
+    responses.reserve(requests.size());
 
-    if (send(sock_, reinterpret_cast<const char*>(header), 4, 0) != 4) {
-        return false;
+    for (auto& req : requests) {
+        if (ids.size() - responses.size() >= PIPELINE_WINDOW) {
+            // Drain half the window so refills go out in batches too
+            while (ids.size() - responses.size() > PIPELINE_WINDOW / 2) {
+                responses.push_back(wait(ids[responses.size()]));
+            }
+        }
+        ids.push_back(submit(std::move(req)));
+    }
+    while (responses.size() < ids.size()) {
+        responses.push_back(wait(ids[responses.size()]));
     }
 
+    return responses;
+}
+
+bool Client::flushRequests() {
     size_t sent = 0;
-    while (sent < data.size()) {
-        int n = send(sock_, reinterpret_cast<const char*>(data.data() + sent),
-                     static_cast<int>(data.size() - sent), 0);
+    while (sent < out_.size()) {
+        int n = send(sock_, reinterpret_cast<const char*>(out_.data() + sent),
+                     static_cast<int>(out_.size() - sent), 0);
         if (n <= 0) return false;
         sent += n;
     }
 
+    out_.clear();
     return true;
 }
 
 std::vector<uint8_t> Client::recvMessage() {
-    uint8_t header[4];
-    int received = 0;
-    while (received < 4) {
-        int n = recv(sock_, reinterpret_cast<char*>(header + received), 4 - received, 0);
-        if (n <= 0) return {};
-        received += n;
-    }
+    while (true) {
+        size_t available = in_.size() - in_offset_;
+        if (available >= 4) {
+            const uint8_t* header = in_.data() + in_offset_;
+            uint32_t len = header[0] | (header[1] << 8) | (header[2] << 16) |
+                           (static_cast<uint32_t>(header[3]) << 24);
+            if (len > MAX_MESSAGE_SIZE) {
+                return {};
+            }
+            if (available - 4 >= len) {
+                std::vector<uint8_t> data(header + 4, header + 4 + len);
+                in_offset_ += 4 + len;
+                if (in_offset_ == in_.size()) {
+                    in_.clear();
+                    in_offset_ = 0;
+                }
+                return data;
+            }
+        }
 
-    uint32_t len = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
-    if (len > 10 * 1024 * 1024) {
-        return {};
+        // Read whatever has arrived, which with pipelining is often several
+        // responses at once
+        in_.erase(in_.begin(), in_.begin() + in_offset_);
+        in_offset_ = 0;
+        size_t used = in_.size();
+        in_.resize(used + RECV_CHUNK_SIZE);
+        int n = recv(sock_, reinterpret_cast<char*>(in_.data() + used),
+                     static_cast<int>(RECV_CHUNK_SIZE), 0);
+        if (n <= 0) {
+            in_.resize(used);
+            return {};
+        }
+        in_.resize(used + n);
     }
-
-    std::vector<uint8_t> data(len);
-    received = 0;
-    while (received < static_cast<int>(len)) {
-        int n = recv(sock_, reinterpret_cast<char*>(data.data() + received),
-                     static_cast<int>(len - received), 0);
-        if (n <= 0) return {};
-        received += n;
-    }
-
-    return data;
 }
 
 } // namespace dkv
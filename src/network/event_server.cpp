@@ -0,0 +1,470 @@
+#include "network/event_server.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace dkv {
+
+namespace {
+
+constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+constexpr size_t MAX_READ_PER_WAKEUP = 1024 * 1024;  // Then let other connections run
+constexpr size_t IDLE_BUFFER_CAPACITY = 64 * 1024;   // Larger buffers are freed once drained
+constexpr int MAX_EVENTS = 128;
+
+// epoll_event::data.ptr for the two non-connection fds every reactor watches
+char LISTEN_TAG;
+char WAKE_TAG;
+
+void encodeLength(uint8_t* out, uint32_t len) {
+    out[0] = (len >> 0) & 0xFF;
+    out[1] = (len >> 8) & 0xFF;
+    out[2] = (len >> 16) & 0xFF;
+    out[3] = (len >> 24) & 0xFF;
+}
+
+uint32_t decodeLength(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+void releaseIfIdle(std::vector<uint8_t>& buffer) {
+    if (buffer.empty() && buffer.capacity() > IDLE_BUFFER_CAPACITY) {
+        std::vector<uint8_t>().swap(buffer);
+    }
+}
+
+} // namespace
+
+struct EventServer::Reactor {
+    int epoll_fd = -1;
+    int wake_fd = -1;  // eventfd used by stop()
+    std::thread thread;
+    std::unordered_map<Connection*, std::shared_ptr<Connection>> connections;
+    std::vector<uint8_t> scratch;  // Read buffer shared by this reactor's connections
+};
+
+// ==================== Connection ====================
+
+Connection::Connection(int fd, int epoll_fd) : fd_(fd), epoll_fd_(epoll_fd) {}
+
+Connection::~Connection() = default;
+
+bool Connection::send(const std::vector<uint8_t>& message) {
+    return send(std::string_view(reinterpret_cast<const char*>(message.data()), message.size()));
+}
+
+bool Connection::send(std::string_view message) {
+    std::lock_guard<std::mutex> lock(out_mutex_);
+    if (closed_) {
+        return false;
+    }
+
+    bool idle = out_offset_ == out_.size();
+    if (!message.empty()) {
+        std::memcpy(appendFrameLocked(message.size()), message.data(), message.size());
+    } else {
+        appendFrameLocked(0);
+    }
+    return finishSendLocked(idle);
+}
+
+uint8_t* Connection::appendFrameLocked(size_t len) {
+    if (out_offset_ == out_.size()) {
+        out_.clear();
+        out_offset_ = 0;
+    } else if (out_offset_ >= out_.size() / 2) {
+        out_.erase(out_.begin(), out_.begin() + out_offset_);
+        out_offset_ = 0;
+    }
+
+    size_t offset = out_.size();
+    out_.resize(offset + 4 + len);
+    encodeLength(out_.data() + offset, static_cast<uint32_t>(len));
+    return out_.data() + offset + 4;
+}
+
+bool Connection::finishSendLocked(bool was_idle) {
+    // Nothing was queued ahead of this frame: write it now, usually in one
+    // syscall. Otherwise the reactor is already draining the queue, though
+    // past the backlog limit whatever the socket takes is written at once.
+    bool backlog = out_.size() - out_offset_ > EventServer::MAX_PENDING_OUTPUT;
+    if (((!corked_ && was_idle) || backlog) && !flushLocked()) {
+        ::shutdown(fd_, SHUT_RDWR);
+        return false;
+    }
+
+    // Never wait for the peer here: callers include reactor threads and the
+    // Raft loop. A peer that stops reading has its requests paused until it
+    // catches up, and one that lets even more pile up is dropped.
+    size_t pending = out_.size() - out_offset_;
+    if (pending > EventServer::MAX_QUEUED_OUTPUT) {
+        ::shutdown(fd_, SHUT_RDWR);
+        return false;
+    }
+    backlog = pending > EventServer::MAX_PENDING_OUTPUT;
+    bool want_write = want_write_ || (pending > 0 && (!corked_ || backlog));
+    bool paused = reading_paused_ || backlog;
+    if (want_write != want_write_ || paused != reading_paused_) {
+        updateInterest(want_write, paused);
+    }
+    return true;
+}
+
+void Connection::cork() {
+    std::lock_guard<std::mutex> lock(out_mutex_);
+    corked_ = true;
+}
+
+bool Connection::uncork() {
+    std::lock_guard<std::mutex> lock(out_mutex_);
+    corked_ = false;
+    if (closed_ || !flushLocked()) {
+        return false;
+    }
+    if (out_offset_ < out_.size() && !want_write_) {
+        updateInterest(true, reading_paused_);
+    }
+    return true;
+}
+
+void Connection::close() {
+    std::lock_guard<std::mutex> lock(out_mutex_);
+    if (!closed_) {
+        // The reactor sees the hangup and closes the fd, so it is never
+        // reused while another thread still holds this connection
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+}
+
+bool Connection::flushLocked() {
+    while (out_offset_ < out_.size()) {
+        ssize_t n = ::send(fd_, out_.data() + out_offset_, out_.size() - out_offset_, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        out_offset_ += static_cast<size_t>(n);
+    }
+
+    out_.clear();
+    out_offset_ = 0;
+    releaseIfIdle(out_);
+    return true;
+}
+
+void Connection::updateInterest(bool want_write, bool pause_reading) {
+    epoll_event ev{};
+    ev.events = (pause_reading ? 0u : static_cast<uint32_t>(EPOLLIN)) |
+                (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.ptr = this;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd_, &ev);
+    want_write_ = want_write;
+    reading_paused_ = pause_reading;
+}
+
+// ==================== EventServer ====================
+
+EventServer::EventServer(uint16_t port, MessageHandler handler, size_t num_reactors)
+    : port_(port), handler_(std::move(handler)), num_reactors_(num_reactors) {
+    if (num_reactors_ == 0) {
+        num_reactors_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+EventServer::~EventServer() {
+    stop();
+}
+
+void EventServer::start() {
+    if (running_) return;
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Failed to create socket");
+    }
+
+    int opt = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port_);
+
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Failed to bind to port " + std::to_string(port_));
+    }
+
+    if (::listen(listen_fd_, SOMAXCONN) < 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Failed to listen");
+    }
+
+    socklen_t len = sizeof(addr);
+    if (::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        port_ = ntohs(addr.sin_port);
+    }
+
+    running_ = true;
+    for (size_t i = 0; i < num_reactors_; i++) {
+        auto reactor = std::make_unique<Reactor>();
+        reactor->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        reactor->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        reactor->scratch.resize(READ_BUFFER_SIZE);
+
+        epoll_event wake{};
+        wake.events = EPOLLIN;
+        wake.data.ptr = &WAKE_TAG;
+
+        // Every reactor accepts; EPOLLEXCLUSIVE wakes only one per connection
+        epoll_event accept{};
+        accept.events = EPOLLIN | EPOLLEXCLUSIVE;
+        accept.data.ptr = &LISTEN_TAG;
+
+        bool ok = reactor->epoll_fd >= 0 && reactor->wake_fd >= 0 &&
+                  ::epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &wake) == 0 &&
+                  ::epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, listen_fd_, &accept) == 0;
+        if (!ok) {
+            if (reactor->epoll_fd >= 0) ::close(reactor->epoll_fd);
+            if (reactor->wake_fd >= 0) ::close(reactor->wake_fd);
+            stop();
+            throw std::runtime_error(std::string("Failed to create reactor: ") + std::strerror(errno));
+        }
+
+        reactors_.push_back(std::move(reactor));
+        Reactor& r = *reactors_.back();
+        r.thread = std::thread([this, &r] { reactorLoop(r); });
+    }
+}
+
+void EventServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    for (auto& reactor : reactors_) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(reactor->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    for (auto& reactor : reactors_) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+
+        std::vector<Connection*> open;
+        for (const auto& [ptr, _] : reactor->connections) {
+            open.push_back(ptr);
+        }
+        for (Connection* conn : open) {
+            destroyConnection(*reactor, conn);
+        }
+
+        ::close(reactor->epoll_fd);
+        ::close(reactor->wake_fd);
+    }
+    reactors_.clear();
+
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+void EventServer::reactorLoop(Reactor& reactor) {
+    epoll_event events[MAX_EVENTS];
+
+    while (running_) {
+        int n = ::epoll_wait(reactor.epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[EventServer] epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < n && running_; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == &WAKE_TAG) {
+                continue;
+            }
+            if (tag == &LISTEN_TAG) {
+                acceptConnections(reactor);
+                continue;
+            }
+
+            auto it = reactor.connections.find(static_cast<Connection*>(tag));
+            if (it == reactor.connections.end()) {
+                continue;  // Closed earlier in this batch
+            }
+            std::shared_ptr<Connection> conn = it->second;
+            uint32_t ev = events[i].events;
+
+            if (ev & EPOLLOUT) {
+                bool ok;
+                {
+                    std::lock_guard<std::mutex> lock(conn->out_mutex_);
+                    ok = conn->flushLocked();
+                    if (ok) {
+                        // Take requests again once most of the backlog is gone
+                        size_t pending = conn->out_.size() - conn->out_offset_;
+                        bool want_write = pending > 0;
+                        bool paused = conn->reading_paused_ && pending > MAX_PENDING_OUTPUT / 2;
+                        if (want_write != conn->want_write_ || paused != conn->reading_paused_) {
+                            conn->updateInterest(want_write, paused);
+                        }
+                    }
+                }
+                if (!ok) {
+                    destroyConnection(reactor, conn.get());
+                    continue;
+                }
+            }
+
+            if ((ev & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !readConnection(reactor, conn)) {
+                destroyConnection(reactor, conn.get());
+            }
+        }
+    }
+}
+
+void EventServer::acceptConnections(Reactor& reactor) {
+    while (running_) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[EventServer] Accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto conn = std::make_shared<Connection>(fd, reactor.epoll_fd);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn.get();
+        if (::epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            ::close(fd);
+            continue;
+        }
+
+        reactor.connections.emplace(conn.get(), std::move(conn));
+        connections_++;
+    }
+}
+
+bool EventServer::readConnection(Reactor& reactor, const std::shared_ptr<Connection>& conn) {
+    size_t total = 0;
+
+    while (total < MAX_READ_PER_WAKEUP) {
+        ssize_t n = ::recv(conn->fd_, reactor.scratch.data(), reactor.scratch.size(), 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        total += static_cast<size_t>(n);
+
+        // Parse straight out of the scratch buffer unless a frame is already
+        // partially buffered, so idle connections hold no read buffer at all
+        std::vector<uint8_t>& in = conn->in_;
+        const uint8_t* data = reactor.scratch.data();
+        size_t len = static_cast<size_t>(n);
+        if (!in.empty()) {
+            in.insert(in.end(), data, data + len);
+            data = in.data();
+            len = in.size();
+        }
+
+        size_t offset = 0;
+        bool corked = false;
+        while (len - offset >= 4) {
+            uint32_t msg_len = decodeLength(data + offset);
+            if (msg_len > MAX_MESSAGE_SIZE) {
+                return false;
+            }
+            if (len - offset - 4 < msg_len) {
+                break;
+            }
+
+            std::string_view message(reinterpret_cast<const char*>(data + offset + 4), msg_len);
+            offset += 4 + msg_len;
+
+            // A pipelining client sent more behind this frame: hold the
+            // responses and write the whole batch with one syscall
+            if (!corked && len - offset >= 4) {
+                conn->cork();
+                corked = true;
+            }
+
+            try {
+                handler_(conn, message);
+            } catch (const std::exception& e) {
+                std::cerr << "[EventServer] Handler failed: " << e.what() << std::endl;
+                return false;
+            }
+        }
+
+        if (corked && !conn->uncork()) {
+            return false;
+        }
+
+        if (data == in.data()) {
+            in.erase(in.begin(), in.begin() + offset);
+        } else {
+            in.assign(data + offset, data + len);
+        }
+
+        if (in.size() >= 4) {
+            // Grow once for the rest of a large frame instead of per read
+            in.reserve(4 + decodeLength(in.data()));
+        }
+        releaseIfIdle(in);
+
+        if (static_cast<size_t>(n) < reactor.scratch.size()) {
+            break;  // Socket drained
+        }
+        if (conn->reading_paused_) {
+            break;  // The peer is not reading its responses
+        }
+    }
+
+    return true;
+}
+
+void EventServer::destroyConnection(Reactor& reactor, Connection* conn) {
+    auto it = reactor.connections.find(conn);
+    if (it == reactor.connections.end()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(conn->out_mutex_);
+        conn->closed_ = true;
+    }
+    ::epoll_ctl(reactor.epoll_fd, EPOLL_CTL_DEL, conn->fd_, nullptr);
+    ::close(conn->fd_);
+
+    reactor.connections.erase(it);
+    connections_--;
+}
+
+} // namespace dkv
@@ -1,130 +1,230 @@
 #include "network/protocol.hpp"
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 
 namespace dkv {
 
-std::vector<uint8_t> Request::serialize() const {
-    std::vector<uint8_t> data;
-    
-    data.push_back(static_cast<uint8_t>(op));
-    
-    uint32_t keyLen = static_cast<uint32_t>(key.size());
-    data.push_back((keyLen >> 0) & 0xFF);
-    data.push_back((keyLen >> 8) & 0xFF);
-    data.push_back((keyLen >> 16) & 0xFF);
-    data.push_back((keyLen >> 24) & 0xFF);
-    data.insert(data.end(), key.begin(), key.end());
-    
-    uint32_t valLen = static_cast<uint32_t>(value.size());
-    data.push_back((valLen >> 0) & 0xFF);
-    data.push_back((valLen >> 8) & 0xFF);
-    data.push_back((valLen >> 16) & 0xFF);
-    data.push_back((valLen >> 24) & 0xFF);
-    data.insert(data.end(), value.begin(), value.end());
-    
-    return data;
+namespace {
+
+std::string_view asView(const std::vector<uint8_t>& data) {
+    return std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
 }
 
-Request Request::deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < 9) {
-        throw std::runtime_error("Invalid request: too short");
+// Bounds-checked little-endian cursor over a frame being parsed. Strings
+// come back as views into the frame.
+class FrameReader {
+public:
+    FrameReader(std::string_view data, const char* what) : data_(data), what_(what) {}
+
+    uint8_t u8() {
+        need(1);
+        return static_cast<uint8_t>(data_[pos_++]);
     }
-    
-    Request req;
-    size_t offset = 0;
-    
-    req.op = static_cast<OpCode>(data[offset++]);
-    
-    uint32_t keyLen = data[offset] | (data[offset+1] << 8) | 
-                      (data[offset+2] << 16) | (data[offset+3] << 24);
-    offset += 4;
-    
-    if (offset + keyLen > data.size()) {
-        throw std::runtime_error("Invalid request: key length mismatch");
+
+    uint32_t u32() {
+        need(4);
+        const auto* p = reinterpret_cast<const uint8_t*>(data_.data() + pos_);
+        pos_ += 4;
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
     }
-    req.key = std::string(data.begin() + offset, data.begin() + offset + keyLen);
-    offset += keyLen;
-    
-    if (offset + 4 > data.size()) {
-        throw std::runtime_error("Invalid request: missing value length");
+
+    uint64_t u64() {
+        need(8);
+        uint64_t val = 0;
+        for (int i = 0; i < 8; ++i) {
+            val |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ + i])) << (i * 8);
+        }
+        pos_ += 8;
+        return val;
     }
-    uint32_t valLen = data[offset] | (data[offset+1] << 8) | 
-                      (data[offset+2] << 16) | (data[offset+3] << 24);
-    offset += 4;
-    
-    if (offset + valLen > data.size()) {
-        throw std::runtime_error("Invalid request: value length mismatch");
+
+    uint32_t varint() {
+        uint32_t v = 0;
+        for (int shift = 0; shift <= 28; shift += 7) {
+            uint32_t byte = u8();
+            v |= (byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                return v;
+            }
+        }
+        fail("bad varint");
+    }
+
+    std::string_view bytes(size_t len) {
+        need(len);
+        std::string_view v = data_.substr(pos_, len);
+        pos_ += len;
+        return v;
+    }
+
+    // 4-byte length, then the bytes
+    std::string_view string() { return bytes(u32()); }
+
+    size_t remaining() const { return data_.size() - pos_; }
+
+private:
+    void need(size_t len) const {
+        if (remaining() < len) {
+            fail("truncated");
+        }
+    }
+
+    [[noreturn]] void fail(const char* why) const {
+        throw std::runtime_error(std::string("Invalid ") + what_ + ": " + why);
+    }
+
+    std::string_view data_;
+    const char* what_;
+    size_t pos_ = 0;
+};
+
+// Little-endian writer into a buffer already sized for the whole encoding,
+// so serializing never reallocates or pushes byte by byte
+class FrameWriter {
+public:
+    explicit FrameWriter(uint8_t* out) : p_(out) {}
+
+    void u8(uint8_t v) { *p_++ = v; }
+
+    void u32(uint32_t v) {
+        p_[0] = (v >> 0) & 0xFF;
+        p_[1] = (v >> 8) & 0xFF;
+        p_[2] = (v >> 16) & 0xFF;
+        p_[3] = (v >> 24) & 0xFF;
+        p_ += 4;
+    }
+
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i) {
+            *p_++ = (v >> (i * 8)) & 0xFF;
+        }
+    }
+
+    void varint(uint32_t v) {
+        while (v >= 0x80) {
+            *p_++ = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        *p_++ = static_cast<uint8_t>(v);
+    }
+
+    void bytes(std::string_view b) {
+        if (!b.empty()) {
+            std::memcpy(p_, b.data(), b.size());
+            p_ += b.size();
+        }
+    }
+
+    // 4-byte length, then the bytes
+    void string(std::string_view s) {
+        u32(static_cast<uint32_t>(s.size()));
+        bytes(s);
+    }
+
+    // Hand the next len bytes to fill(uint8_t*), for nested encodings
+    template <typename Fill>
+    void reserve(size_t len, Fill&& fill) {
+        fill(p_);
+        p_ += len;
+    }
+
+private:
+    uint8_t* p_;
+};
+
+size_t varintLength(uint32_t v) {
+    size_t len = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        len++;
     }
-    req.value = std::string(data.begin() + offset, data.begin() + offset + valLen);
+    return len;
+}
+
+// A vector holding exactly size bytes written by encode(FrameWriter&)
+template <typename Encode>
+std::vector<uint8_t> encodeExact(size_t size, Encode&& encode) {
+    std::vector<uint8_t> data(size);
+    FrameWriter writer(data.data());
+    encode(writer);
+    return data;
+}
+
+} // namespace
+
+size_t Request::encodedSize() const {
+    return 1 + 4 + 4 + key.size() + 4 + value.size();
+}
+
+void Request::encodeTo(uint8_t* out) const {
+    FrameWriter writer(out);
+    writer.u8(static_cast<uint8_t>(op));
+    writer.u32(id);
+    writer.string(key);
+    writer.string(value);
+}
+
+std::vector<uint8_t> Request::serialize() const {
+    std::vector<uint8_t> data(encodedSize());
+    encodeTo(data.data());
+    return data;
+}
+
+Request Request::deserialize(const std::vector<uint8_t>& data) {
+    return RequestView::parse(asView(data)).toRequest();
+}
+
+RequestView RequestView::parse(std::string_view data) {
+    FrameReader reader(data, "request");
+    
+    RequestView req;
+    req.op = static_cast<OpCode>(reader.u8());
+    req.id = reader.u32();
+    req.key = reader.string();
+    req.value = reader.string();
     
     return req;
 }
 
+Request RequestView::toRequest() const {
+    return Request{op, std::string(key), std::string(value), id};
+}
+
+size_t Response::encodedSize() const {
+    return 1 + 4 + 4 + value.size() + 4 + error.size();
+}
+
+void Response::encodeTo(uint8_t* out) const {
+    FrameWriter writer(out);
+    writer.u8(static_cast<uint8_t>(status));
+    writer.u32(id);
+    writer.string(value);
+    writer.string(error);
+}
+
 std::vector<uint8_t> Response::serialize() const {
-    std::vector<uint8_t> data;
-    
-    data.push_back(static_cast<uint8_t>(status));
-    
-    uint32_t valLen = static_cast<uint32_t>(value.size());
-    data.push_back((valLen >> 0) & 0xFF);
-    data.push_back((valLen >> 8) & 0xFF);
-    data.push_back((valLen >> 16) & 0xFF);
-    data.push_back((valLen >> 24) & 0xFF);
-    data.insert(data.end(), value.begin(), value.end());
-    
-    uint32_t errLen = static_cast<uint32_t>(error.size());
-    data.push_back((errLen >> 0) & 0xFF);
-    data.push_back((errLen >> 8) & 0xFF);
-    data.push_back((errLen >> 16) & 0xFF);
-    data.push_back((errLen >> 24) & 0xFF);
-    data.insert(data.end(), error.begin(), error.end());
-    
+    std::vector<uint8_t> data(encodedSize());
+    encodeTo(data.data());
     return data;
 }
 
 Response Response::deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < 9) {
-        throw std::runtime_error("Invalid response: too short");
-    }
+    return deserialize(asView(data));
+}
+
+Response Response::deserialize(std::string_view data) {
+    FrameReader reader(data, "response");
     
     Response resp;
-    size_t offset = 0;
-    
-    resp.status = static_cast<StatusCode>(data[offset++]);
-    
-    uint32_t valLen = data[offset] | (data[offset+1] << 8) | 
-                      (data[offset+2] << 16) | (data[offset+3] << 24);
-    offset += 4;
-    
-    if (offset + valLen > data.size()) {
-        throw std::runtime_error("Invalid response: value length mismatch");
-    }
-    resp.value = std::string(data.begin() + offset, data.begin() + offset + valLen);
-    offset += valLen;
-    
-    if (offset + 4 > data.size()) {
-        throw std::runtime_error("Invalid response: missing error length");
-    }
-    uint32_t errLen = data[offset] | (data[offset+1] << 8) | 
-                      (data[offset+2] << 16) | (data[offset+3] << 24);
-    offset += 4;
-    
-    if (offset + errLen > data.size()) {
-        throw std::runtime_error("Invalid response: error length mismatch");
-    }
-    resp.error = std::string(data.begin() + offset, data.begin() + offset + errLen);
+    resp.status = static_cast<StatusCode>(reader.u8());
+    resp.id = reader.u32();
+    resp.value = std::string(reader.string());
+    resp.error = std::string(reader.string());
     
     return resp;
 }
 
-// Helper to write uint64_t in little-endian
-static void writeU64(std::vector<uint8_t>& data, uint64_t val) {
-    for (int i = 0; i < 8; ++i) {
-        data.push_back((val >> (i * 8)) & 0xFF);
-    }
-}
-
 // Helper to read uint64_t in little-endian
 static uint64_t readU64(const std::vector<uint8_t>& data, size_t offset) {
     uint64_t val = 0;
@@ -135,34 +235,14 @@ static uint64_t readU64(const std::vector<uint8_t>& data, size_t offset) {
 }
 
 std::vector<uint8_t> ReplicationEntry::serialize() const {
-    std::vector<uint8_t> data;
-    
-    // sequence_num (8 bytes)
-    writeU64(data, sequence_num);
-    
-    // op (1 byte)
-    data.push_back(static_cast<uint8_t>(op));
-    
-    // key (4 bytes len + data)
-    uint32_t keyLen = static_cast<uint32_t>(key.size());
-    data.push_back((keyLen >> 0) & 0xFF);
-    data.push_back((keyLen >> 8) & 0xFF);
-    data.push_back((keyLen >> 16) & 0xFF);
-    data.push_back((keyLen >> 24) & 0xFF);
-    data.insert(data.end(), key.begin(), key.end());
-    
-    // value (4 bytes len + data)
-    uint32_t valLen = static_cast<uint32_t>(value.size());
-    data.push_back((valLen >> 0) & 0xFF);
-    data.push_back((valLen >> 8) & 0xFF);
-    data.push_back((valLen >> 16) & 0xFF);
-    data.push_back((valLen >> 24) & 0xFF);
-    data.insert(data.end(), value.begin(), value.end());
-    
-    // timestamp (8 bytes)
-    writeU64(data, timestamp);
-    
-    return data;
+    // sequence_num | op | keyLen | key | valLen | value | timestamp
+    return encodeExact(8 + 1 + 4 + key.size() + 4 + value.size() + 8, [&](FrameWriter& writer) {
+        writer.u64(sequence_num);
+        writer.u8(static_cast<uint8_t>(op));
+        writer.string(key);
+        writer.string(value);
+        writer.u64(timestamp);
+    });
 }
 
 ReplicationEntry ReplicationEntry::deserialize(const std::vector<uint8_t>& data) {
@@ -212,16 +292,6 @@ ReplicationEntry ReplicationEntry::deserialize(const std::vector<uint8_t>& data)
     return entry;
 }
 
-// Helper to write string (4-byte length + data)
-static void writeString(std::vector<uint8_t>& data, const std::string& str) {
-    uint32_t len = static_cast<uint32_t>(str.size());
-    data.push_back((len >> 0) & 0xFF);
-    data.push_back((len >> 8) & 0xFF);
-    data.push_back((len >> 16) & 0xFF);
-    data.push_back((len >> 24) & 0xFF);
-    data.insert(data.end(), str.begin(), str.end());
-}
-
 // Helper to read string
 static std::string readString(const std::vector<uint8_t>& data, size_t& offset) {
     if (offset + 4 > data.size()) {
@@ -238,42 +308,201 @@ static std::string readString(const std::vector<uint8_t>& data, size_t& offset)
     return str;
 }
 
+// ==================== Scan ====================
+
+std::vector<uint8_t> ScanRequest::serialize() const {
+    return encodeExact(4 + end.size() + 4, [&](FrameWriter& writer) {
+        writer.string(end);
+        writer.u32(limit);
+    });
+}
+
+ScanRequest ScanRequest::deserialize(std::string_view data) {
+    FrameReader reader(data, "scan request");
+
+    ScanRequest sr;
+    sr.end = std::string(reader.string());
+    sr.limit = reader.u32();
+
+    return sr;
+}
+
+std::vector<uint8_t> ScanChunk::serialize() const {
+    size_t size = 4;
+    for (const auto& [key, value] : entries) {
+        size += 8 + key.size() + value.size();
+    }
+
+    return encodeExact(size, [&](FrameWriter& writer) {
+        writer.u32(static_cast<uint32_t>(entries.size()));
+        for (const auto& [key, value] : entries) {
+            writer.string(key);
+            writer.string(value);
+        }
+    });
+}
+
+ScanChunk ScanChunk::deserialize(const std::vector<uint8_t>& data) {
+    if (data.size() < 4) {
+        throw std::runtime_error("Invalid scan chunk: too short");
+    }
+
+    ScanChunk chunk;
+    size_t offset = 0;
+
+    uint32_t count = data[offset] | (data[offset+1] << 8) |
+                     (data[offset+2] << 16) | (data[offset+3] << 24);
+    offset += 4;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string key = readString(data, offset);
+        std::string value = readString(data, offset);
+        chunk.entries.emplace_back(std::move(key), std::move(value));
+    }
+
+    return chunk;
+}
+
+// ==================== Multi-key ====================
+
+std::vector<uint8_t> MultiRequest::serialize() const {
+    size_t size = varintLength(static_cast<uint32_t>(keys.size())) +
+                  varintLength(static_cast<uint32_t>(values.size()));
+    for (const auto& key : keys) size += varintLength(static_cast<uint32_t>(key.size())) + key.size();
+    for (const auto& value : values) size += varintLength(static_cast<uint32_t>(value.size())) + value.size();
+
+    return encodeExact(size, [&](FrameWriter& writer) {
+        writer.varint(static_cast<uint32_t>(keys.size()));
+        for (const auto& key : keys) {
+            writer.varint(static_cast<uint32_t>(key.size()));
+            writer.bytes(key);
+        }
+        writer.varint(static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) {
+            writer.varint(static_cast<uint32_t>(value.size()));
+            writer.bytes(value);
+        }
+    });
+}
+
+MultiRequest MultiRequest::deserialize(std::string_view data) {
+    MultiRequestView view = MultiRequestView::parse(data);
+    return MultiRequest{std::vector<std::string>(view.keys.begin(), view.keys.end()),
+                        std::vector<std::string>(view.values.begin(), view.values.end())};
+}
+
+MultiRequestView MultiRequestView::parse(std::string_view data) {
+    FrameReader reader(data, "multi request");
+    MultiRequestView mr;
+
+    // Every entry takes at least one byte, which bounds the reserve
+    uint32_t count = reader.varint();
+    mr.keys.reserve(std::min<size_t>(count, reader.remaining()));
+    for (uint32_t i = 0; i < count; ++i) {
+        mr.keys.push_back(reader.bytes(reader.varint()));
+    }
+
+    count = reader.varint();
+    if (count != 0 && count != mr.keys.size()) {
+        throw std::runtime_error("Invalid multi request: key and value counts differ");
+    }
+    mr.values.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        mr.values.push_back(reader.bytes(reader.varint()));
+    }
+
+    return mr;
+}
+
+std::vector<uint8_t> MultiGetResult::serialize() const {
+    size_t size = varintLength(static_cast<uint32_t>(values.size()));
+    for (const auto& value : values) {
+        size += value ? varintLength(static_cast<uint32_t>(value->size()) + 1) + value->size() : 1;
+    }
+
+    // Each slot is varint(length + 1) then the bytes, or a lone 0 if missing
+    return encodeExact(size, [&](FrameWriter& writer) {
+        writer.varint(static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) {
+            if (!value) {
+                writer.varint(0);
+                continue;
+            }
+            writer.varint(static_cast<uint32_t>(value->size()) + 1);
+            writer.bytes(*value);
+        }
+    });
+}
+
+MultiGetResult MultiGetResult::deserialize(const std::vector<uint8_t>& data) {
+    FrameReader reader(asView(data), "multi-get result");
+    MultiGetResult result;
+
+    uint32_t count = reader.varint();
+    result.values.reserve(std::min<size_t>(count, reader.remaining()));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t len = reader.varint();
+        if (len == 0) {
+            result.values.emplace_back();
+        } else {
+            result.values.emplace_back(reader.bytes(len - 1));
+        }
+    }
+
+    return result;
+}
+
 // ==================== RaftLogEntry ====================
 
+size_t RaftLogEntry::encodedSize() const {
+    return 8 + 8 + 1 + 4 + key.size() + 4 + value.size();
+}
+
+void RaftLogEntry::encodeTo(uint8_t* out) const {
+    FrameWriter writer(out);
+    writer.u64(term);
+    writer.u64(index);
+    writer.u8(static_cast<uint8_t>(op));
+    writer.string(key);
+    writer.string(value);
+}
+
 std::vector<uint8_t> RaftLogEntry::serialize() const {
-    std::vector<uint8_t> data;
-    writeU64(data, term);
-    writeU64(data, index);
-    data.push_back(static_cast<uint8_t>(op));
-    writeString(data, key);
-    writeString(data, value);
+    std::vector<uint8_t> data(encodedSize());
+    encodeTo(data.data());
     return data;
 }
 
 RaftLogEntry RaftLogEntry::deserialize(const std::vector<uint8_t>& data) {
-    RaftLogEntry entry;
-    size_t offset = 0;
+    return RaftLogEntryView::parse(asView(data)).toEntry();
+}
+
+RaftLogEntryView RaftLogEntryView::parse(std::string_view data) {
+    FrameReader reader(data, "log entry");
     
-    entry.term = readU64(data, offset);
-    offset += 8;
-    entry.index = readU64(data, offset);
-    offset += 8;
-    entry.op = static_cast<OpCode>(data[offset++]);
-    entry.key = readString(data, offset);
-    entry.value = readString(data, offset);
+    RaftLogEntryView entry;
+    entry.term = reader.u64();
+    entry.index = reader.u64();
+    entry.op = static_cast<OpCode>(reader.u8());
+    entry.key = reader.string();
+    entry.value = reader.string();
     
     return entry;
 }
 
+RaftLogEntry RaftLogEntryView::toEntry() const {
+    return RaftLogEntry{term, index, op, std::string(key), std::string(value)};
+}
+
 // ==================== RequestVote ====================
 
 std::vector<uint8_t> RequestVote::serialize() const {
-    std::vector<uint8_t> data;
-    writeU64(data, term);
-    writeString(data, candidate_id);
-    writeU64(data, last_log_index);
-    writeU64(data, last_log_term);
-    return data;
+    return encodeExact(8 + 4 + candidate_id.size() + 8 + 8, [&](FrameWriter& writer) {
+        writer.u64(term);
+        writer.string(candidate_id);
+        writer.u64(last_log_index);
+        writer.u64(last_log_term);
+    });
 }
 
 RequestVote RequestVote::deserialize(const std::vector<uint8_t>& data) {
@@ -293,10 +522,10 @@ RequestVote RequestVote::deserialize(const std::vector<uint8_t>& data) {
 // ==================== RequestVoteResponse ====================
 
 std::vector<uint8_t> RequestVoteResponse::serialize() const {
-    std::vector<uint8_t> data;
-    writeU64(data, term);
-    data.push_back(vote_granted ? 1 : 0);
-    return data;
+    return encodeExact(8 + 1, [&](FrameWriter& writer) {
+        writer.u64(term);
+        writer.u8(vote_granted ? 1 : 0);
+    });
 }
 
 RequestVoteResponse RequestVoteResponse::deserialize(const std::vector<uint8_t>& data) {
@@ -313,85 +542,145 @@ RequestVoteResponse RequestVoteResponse::deserialize(const std::vector<uint8_t>&
 // ==================== AppendEntries ====================
 
 std::vector<uint8_t> AppendEntries::serialize() const {
-    std::vector<uint8_t> data;
-    writeU64(data, term);
-    writeString(data, leader_id);
-    writeU64(data, prev_log_index);
-    writeU64(data, prev_log_term);
-    
-    // Entries count
-    uint32_t count = static_cast<uint32_t>(entries.size());
-    data.push_back((count >> 0) & 0xFF);
-    data.push_back((count >> 8) & 0xFF);
-    data.push_back((count >> 16) & 0xFF);
-    data.push_back((count >> 24) & 0xFF);
-    
-    // Each entry (length-prefixed)
+    size_t size = 8 + 4 + leader_id.size() + 8 + 8 + 4 + 8;
     for (const auto& entry : entries) {
-        auto entry_data = entry.serialize();
-        uint32_t entry_len = static_cast<uint32_t>(entry_data.size());
-        data.push_back((entry_len >> 0) & 0xFF);
-        data.push_back((entry_len >> 8) & 0xFF);
-        data.push_back((entry_len >> 16) & 0xFF);
-        data.push_back((entry_len >> 24) & 0xFF);
-        data.insert(data.end(), entry_data.begin(), entry_data.end());
+        size += 4 + entry.encodedSize();
     }
-    
-    writeU64(data, leader_commit);
-    return data;
+
+    return encodeExact(size, [&](FrameWriter& writer) {
+        writer.u64(term);
+        writer.string(leader_id);
+        writer.u64(prev_log_index);
+        writer.u64(prev_log_term);
+
+        // Each entry is length-prefixed and encoded in place
+        writer.u32(static_cast<uint32_t>(entries.size()));
+        for (const auto& entry : entries) {
+            size_t entry_len = entry.encodedSize();
+            writer.u32(static_cast<uint32_t>(entry_len));
+            writer.reserve(entry_len, [&](uint8_t* out) { entry.encodeTo(out); });
+        }
+
+        writer.u64(leader_commit);
+    });
 }
 
 AppendEntries AppendEntries::deserialize(const std::vector<uint8_t>& data) {
-    AppendEntries ae;
-    size_t offset = 0;
-    
-    ae.term = readU64(data, offset);
-    offset += 8;
-    ae.leader_id = readString(data, offset);
-    ae.prev_log_index = readU64(data, offset);
-    offset += 8;
-    ae.prev_log_term = readU64(data, offset);
-    offset += 8;
-    
-    // Entries count
-    uint32_t count = data[offset] | (data[offset+1] << 8) | 
-                     (data[offset+2] << 16) | (data[offset+3] << 24);
-    offset += 4;
+    AppendEntriesView view = AppendEntriesView::parse(asView(data));
     
-    // Each entry
+    AppendEntries ae;
+    ae.term = view.term;
+    ae.leader_id = std::string(view.leader_id);
+    ae.prev_log_index = view.prev_log_index;
+    ae.prev_log_term = view.prev_log_term;
+    ae.entries.reserve(view.entries.size());
+    for (const auto& entry : view.entries) {
+        ae.entries.push_back(entry.toEntry());
+    }
+    ae.leader_commit = view.leader_commit;
+    return ae;
+}
+
+AppendEntriesView AppendEntriesView::parse(std::string_view data) {
+    FrameReader reader(data, "append entries");
+    
+    AppendEntriesView ae;
+    ae.term = reader.u64();
+    ae.leader_id = reader.string();
+    ae.prev_log_index = reader.u64();
+    ae.prev_log_term = reader.u64();
+    
+    // Each entry is length-prefixed; parse it in place
+    uint32_t count = reader.u32();
+    ae.entries.reserve(std::min<size_t>(count, reader.remaining() / 4));
     for (uint32_t i = 0; i < count; ++i) {
-        uint32_t entry_len = data[offset] | (data[offset+1] << 8) | 
-                             (data[offset+2] << 16) | (data[offset+3] << 24);
-        offset += 4;
-        std::vector<uint8_t> entry_data(data.begin() + offset, data.begin() + offset + entry_len);
-        ae.entries.push_back(RaftLogEntry::deserialize(entry_data));
-        offset += entry_len;
+        ae.entries.push_back(RaftLogEntryView::parse(reader.string()));
     }
     
-    ae.leader_commit = readU64(data, offset);
+    ae.leader_commit = reader.u64();
     return ae;
 }
 
 // ==================== AppendEntriesResponse ====================
 
 std::vector<uint8_t> AppendEntriesResponse::serialize() const {
-    std::vector<uint8_t> data;
-    writeU64(data, term);
-    data.push_back(success ? 1 : 0);
-    writeU64(data, match_index);
-    return data;
+    return encodeExact(8 + 1 + 8 + 8 + 8, [&](FrameWriter& writer) {
+        writer.u64(term);
+        writer.u8(success ? 1 : 0);
+        writer.u64(match_index);
+        writer.u64(conflict_term);
+        writer.u64(conflict_index);
+    });
 }
 
 AppendEntriesResponse AppendEntriesResponse::deserialize(const std::vector<uint8_t>& data) {
-    AppendEntriesResponse aer;
-    size_t offset = 0;
+    FrameReader reader(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()),
+                       "append entries response");
     
-    aer.term = readU64(data, offset);
-    offset += 8;
-    aer.success = (data[offset++] != 0);
-    aer.match_index = readU64(data, offset);
+    AppendEntriesResponse aer;
+    aer.term = reader.u64();
+    aer.success = reader.u8() != 0;
+    aer.match_index = reader.u64();
+    
+    // Nodes without conflict hints end the reply here; with no hint the
+    // leader backs up to just after the follower's known match
+    aer.conflict_term = 0;
+    aer.conflict_index = 0;
+    if (reader.remaining() > 0) {
+        aer.conflict_term = reader.u64();
+        aer.conflict_index = reader.u64();
+    }
     
     return aer;
 }
 
+// ==================== InstallSnapshot ====================
+
+std::vector<uint8_t> InstallSnapshot::serialize() const {
+    size_t size = 8 + 4 + leader_id.size() + 8 + 8 + 4 + file.size() + 8 + 4 + data.size() + 1;
+    return encodeExact(size, [&](FrameWriter& writer) {
+        writer.u64(term);
+        writer.string(leader_id);
+        writer.u64(last_included_index);
+        writer.u64(last_included_term);
+        writer.string(file);
+        writer.u64(offset);
+        writer.string(data);
+        writer.u8(done ? 1 : 0);
+    });
+}
+
+InstallSnapshot InstallSnapshot::deserialize(std::string_view data) {
+    FrameReader reader(data, "install snapshot");
+    
+    InstallSnapshot is;
+    is.term = reader.u64();
+    is.leader_id = std::string(reader.string());
+    is.last_included_index = reader.u64();
+    is.last_included_term = reader.u64();
+    is.file = std::string(reader.string());
+    is.offset = reader.u64();
+    is.data = std::string(reader.string());
+    is.done = reader.u8() != 0;
+    return is;
+}
+
+// ==================== InstallSnapshotResponse ====================
+
+std::vector<uint8_t> InstallSnapshotResponse::serialize() const {
+    return encodeExact(8 + 1, [&](FrameWriter& writer) {
+        writer.u64(term);
+        writer.u8(success ? 1 : 0);
+    });
+}
+
+InstallSnapshotResponse InstallSnapshotResponse::deserialize(std::string_view data) {
+    FrameReader reader(data, "install snapshot response");
+    
+    InstallSnapshotResponse resp;
+    resp.term = reader.u64();
+    resp.success = reader.u8() != 0;
+    return resp;
+}
+
 } // namespace dkv
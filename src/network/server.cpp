@@ -4,124 +4,54 @@
 
 namespace dkv {
 
-Server::Server(const std::string& data_dir, uint16_t port) : port_(port) {
-#ifdef _WIN32
-    WSADATA wsa;
-    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-        throw std::runtime_error("WSAStartup failed");
-    }
-#endif
-    store_ = std::make_unique<LSMTree>(data_dir);
-}
+Server::Server(const std::string& data_dir, uint16_t port, size_t num_reactors)
+    : store_(std::make_unique<LSMTree>(data_dir)),
+      events_(port, [this](const std::shared_ptr<Connection>& conn, std::string_view data) {
+          handleMessage(conn, data);
+      }, num_reactors) {}
 
 Server::~Server() {
     stop();
-#ifdef _WIN32
-    WSACleanup();
-#endif
 }
 
 void Server::start() {
-    server_sock_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (server_sock_ == INVALID_SOCK) {
-        throw std::runtime_error("Failed to create socket");
-    }
-
-    int opt = 1;
-    setsockopt(server_sock_, SOL_SOCKET, SO_REUSEADDR, 
-               reinterpret_cast<const char*>(&opt), sizeof(opt));
-
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port_);
-
-    if (bind(server_sock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
-        CLOSE_SOCKET(server_sock_);
-        throw std::runtime_error("Failed to bind to port " + std::to_string(port_));
-    }
-
-    if (listen(server_sock_, 10) < 0) {
-        CLOSE_SOCKET(server_sock_);
-        throw std::runtime_error("Failed to listen");
-    }
-
+    events_.start();
     running_ = true;
-    accept_thread_ = std::thread(&Server::acceptLoop, this);
-    
-    std::cout << "[Server] Listening on port " << port_ << std::endl;
+
+    std::cout << "[Server] Listening on port " << events_.port() << std::endl;
 }
 
 void Server::stop() {
     if (!running_) return;
-    
+
     running_ = false;
-    
-    if (server_sock_ != INVALID_SOCK) {
-        CLOSE_SOCKET(server_sock_);
-        server_sock_ = INVALID_SOCK;
-    }
-    
-    if (accept_thread_.joinable()) {
-        accept_thread_.join();
-    }
-    
-    std::lock_guard<std::mutex> lock(threads_mutex_);
-    for (auto& t : client_threads_) {
-        if (t.joinable()) {
-            t.join();
-        }
-    }
-    client_threads_.clear();
-    
+    events_.stop();
+
     std::cout << "[Server] Stopped" << std::endl;
 }
 
-void Server::acceptLoop() {
-    while (running_) {
-        sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-        
-        SocketType client_sock = accept(server_sock_, 
-            reinterpret_cast<sockaddr*>(&client_addr), &client_len);
-            
-        if (client_sock == INVALID_SOCK) {
-            if (running_) {
-                std::cerr << "[Server] Accept failed" << std::endl;
-            }
-            continue;
+void Server::handleMessage(const std::shared_ptr<Connection>& conn, std::string_view data) {
+    uint32_t id = 0;
+    try {
+        RequestView req = RequestView::parse(data);
+        id = req.id;
+        if (req.op == OpCode::OP_SCAN) {
+            streamScan(*store_, req, [&](const Response& resp) {
+                return conn->send(resp);
+            });
+            return;
         }
-        
-        std::lock_guard<std::mutex> lock(threads_mutex_);
-        client_threads_.emplace_back(&Server::handleClient, this, client_sock);
-    }
-}
 
-void Server::handleClient(SocketType client_sock) {
-    while (running_) {
-        auto data = recvMessage(client_sock);
-        if (data.empty()) {
-            break;
-        }
-        
-        try {
-            Request req = Request::deserialize(data);
-            Response resp = processRequest(req);
-            auto resp_data = resp.serialize();
-            
-            if (!sendMessage(client_sock, resp_data)) {
-                break;
-            }
-        } catch (const std::exception& e) {
-            Response resp{StatusCode::STATUS_ERROR, "", e.what()};
-            sendMessage(client_sock, resp.serialize());
-        }
+        Response resp = processRequest(req);
+        resp.id = req.id;
+        conn->send(resp);
+    } catch (const std::exception& e) {
+        Response resp{StatusCode::STATUS_ERROR, "", e.what(), id};
+        conn->send(resp);
     }
-    
-    CLOSE_SOCKET(client_sock);
 }
 
-Response Server::processRequest(const Request& req) {
+Response Server::processRequest(const RequestView& req) {
     Response resp;
     
     switch (req.op) {
@@ -131,7 +61,7 @@ Response Server::processRequest(const Request& req) {
             break;
             
         case OpCode::OP_GET: {
-            auto value = store_->get(req.key);
+            auto value = store_->get(std::string(req.key));
             if (value) {
                 resp.status = StatusCode::STATUS_OK;
                 resp.value = *value;
@@ -146,10 +76,43 @@ Response Server::processRequest(const Request& req) {
             resp.status = StatusCode::STATUS_OK;
             break;
             
+        case OpCode::OP_MGET:
+            return serveMultiGet(*store_, req);
+
+        case OpCode::OP_MPUT:
+        case OpCode::OP_MDEL: {
+            MultiRequestView batch = MultiRequestView::parse(req.value);
+            bool put = req.op == OpCode::OP_MPUT;
+            if (put && batch.values.size() != batch.keys.size()) {
+                resp.status = StatusCode::STATUS_ERROR;
+                resp.error = "OP_MPUT needs a value for every key";
+                break;
+            }
+
+            WriteBatch writes;
+            for (size_t i = 0; i < batch.keys.size(); i++) {
+                if (put) {
+                    writes.put(batch.keys[i], batch.values[i]);
+                } else {
+                    writes.del(batch.keys[i]);
+                }
+            }
+            store_->write(writes);
+            resp.status = StatusCode::STATUS_OK;
+            break;
+        }
+
         case OpCode::OP_PING:
             resp.status = StatusCode::STATUS_OK;
             resp.value = "PONG";
             break;
+
+        case OpCode::OP_STATUS:
+            resp.status = StatusCode::STATUS_OK;
+            resp.value = "role:standalone\n";
+            resp.value += "connections:" + std::to_string(events_.connectionCount()) + "\n";
+            resp.value += store_->stats().toString();
+            break;
             
         default:
             resp.status = StatusCode::STATUS_ERROR;
@@ -159,54 +122,41 @@ Response Server::processRequest(const Request& req) {
     return resp;
 }
 
-bool Server::sendMessage(SocketType sock, const std::vector<uint8_t>& data) {
-    uint32_t len = static_cast<uint32_t>(data.size());
-    uint8_t header[4] = {
-        static_cast<uint8_t>((len >> 0) & 0xFF),
-        static_cast<uint8_t>((len >> 8) & 0xFF),
-        static_cast<uint8_t>((len >> 16) & 0xFF),
-        static_cast<uint8_t>((len >> 24) & 0xFF)
-    };
-    
-    if (send(sock, reinterpret_cast<const char*>(header), 4, 0) != 4) {
-        return false;
-    }
-    
-    size_t sent = 0;
-    while (sent < data.size()) {
-        int n = send(sock, reinterpret_cast<const char*>(data.data() + sent), 
-                     static_cast<int>(data.size() - sent), 0);
-        if (n <= 0) return false;
-        sent += n;
-    }
-    
-    return true;
+Response serveMultiGet(const LSMTree& store, const RequestView& req) {
+    MultiRequest batch = MultiRequest::deserialize(req.value);
+    auto payload = MultiGetResult{store.multiGet(batch.keys)}.serialize();
+    return {StatusCode::STATUS_OK, std::string(payload.begin(), payload.end()), "", req.id};
 }
 
-std::vector<uint8_t> Server::recvMessage(SocketType sock) {
-    uint8_t header[4];
-    int received = 0;
-    while (received < 4) {
-        int n = recv(sock, reinterpret_cast<char*>(header + received), 4 - received, 0);
-        if (n <= 0) return {};
-        received += n;
-    }
-    
-    uint32_t len = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
-    if (len > 10 * 1024 * 1024) {
-        return {};
-    }
-    
-    std::vector<uint8_t> data(len);
-    received = 0;
-    while (received < static_cast<int>(len)) {
-        int n = recv(sock, reinterpret_cast<char*>(data.data() + received), 
-                     static_cast<int>(len - received), 0);
-        if (n <= 0) return {};
-        received += n;
+bool streamScan(const LSMTree& store, const RequestView& req,
+                const std::function<bool(const Response&)>& send) {
+    ScanRequest args = ScanRequest::deserialize(req.value);
+
+    ScanChunk chunk;
+    size_t chunk_bytes = 0;
+    size_t count = 0;
+
+    for (LSMTree::Iterator it(store, std::string(req.key)); it.valid(); it.next()) {
+        if ((!args.end.empty() && it.key() >= args.end) || (args.limit && count >= args.limit)) {
+            break;
+        }
+
+        chunk.entries.emplace_back(it.key(), it.value());
+        chunk_bytes += it.key().size() + it.value().size();
+        count++;
+
+        if (chunk_bytes >= SCAN_CHUNK_BYTES) {
+            auto payload = chunk.serialize();
+            if (!send({StatusCode::STATUS_PARTIAL, std::string(payload.begin(), payload.end()), "", req.id})) {
+                return false;
+            }
+            chunk.entries.clear();
+            chunk_bytes = 0;
+        }
     }
-    
-    return data;
+
+    auto payload = chunk.serialize();
+    return send({StatusCode::STATUS_OK, std::string(payload.begin(), payload.end()), "", req.id});
 }
 
 } // namespace dkv
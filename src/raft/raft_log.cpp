@@ -0,0 +1,562 @@
+#include "raft/raft_log.hpp"
+#include "storage/crc32c.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dkv {
+
+namespace {
+
+constexpr size_t FRAME_SIZE = 4 + 4;   // crc | length
+constexpr const char* SEGMENT_PREFIX = "log-";
+constexpr const char* SEGMENT_SUFFIX = ".seg";
+
+std::string segmentName(uint64_t first_index) {
+    // Zero-padded so segments sort by name as well as by index
+    char name[48];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", SEGMENT_PREFIX,
+                  static_cast<unsigned long long>(first_index), SEGMENT_SUFFIX);
+    return name;
+}
+
+bool parseSegmentName(const std::string& name, uint64_t& first_index) {
+    const size_t prefix = std::strlen(SEGMENT_PREFIX);
+    const size_t suffix = std::strlen(SEGMENT_SUFFIX);
+    if (name.size() <= prefix + suffix || name.compare(0, prefix, SEGMENT_PREFIX) != 0 ||
+        name.compare(name.size() - suffix, suffix, SEGMENT_SUFFIX) != 0) {
+        return false;
+    }
+    std::string digits = name.substr(prefix, name.size() - prefix - suffix);
+    if (digits.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    first_index = std::stoull(digits);
+    return true;
+}
+
+int openFd(const std::string& path, bool create) {
+#ifdef _WIN32
+    int flags = _O_RDWR | _O_APPEND | _O_BINARY | (create ? (_O_CREAT | _O_TRUNC) : 0);
+    return ::_open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_RDWR | O_APPEND | O_CLOEXEC | (create ? (O_CREAT | O_TRUNC) : 0);
+    return ::open(path.c_str(), flags, 0644);
+#endif
+}
+
+void closeFd(int fd) {
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+uint64_t fileSize(int fd) {
+#ifdef _WIN32
+    struct _stat64 st;
+    return ::_fstat64(fd, &st) == 0 ? st.st_size : 0;
+#else
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? st.st_size : 0;
+#endif
+}
+
+void writeFully(int fd, const uint8_t* data, size_t len, const std::string& path) {
+    while (len > 0) {
+#ifdef _WIN32
+        int n = ::_write(fd, data, static_cast<unsigned>(len));
+#else
+        ssize_t n = ::write(fd, data, len);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to write Raft log: " + path + ": " + std::strerror(errno));
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+void readFully(int fd, char* data, size_t len, uint64_t offset, const std::string& path) {
+    while (len > 0) {
+#ifdef _WIN32
+        ::_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET);
+        int n = ::_read(fd, data, static_cast<unsigned>(len));
+#else
+        ssize_t n = ::pread(fd, data, len, static_cast<off_t>(offset));
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            throw std::runtime_error("Failed to read Raft log: " + path);
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+void syncFd(int fd, const std::string& path) {
+#if defined(_WIN32)
+    int rc = ::_commit(fd);
+#elif defined(__APPLE__)
+    int rc = ::fsync(fd);
+#else
+    int rc = ::fdatasync(fd);
+#endif
+    if (rc != 0) {
+        throw std::runtime_error("Failed to sync Raft log: " + path + ": " + std::strerror(errno));
+    }
+}
+
+// Persist segment creation and removal; a no-op where directories can't be synced
+void syncDir(const std::string& dir) {
+#ifndef _WIN32
+    int fd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)dir;
+#endif
+}
+
+void truncateFd(int fd, uint64_t size, const std::string& path) {
+#ifdef _WIN32
+    int rc = ::_chsize_s(fd, static_cast<__int64>(size));
+#else
+    int rc = ::ftruncate(fd, static_cast<off_t>(size));
+#endif
+    if (rc != 0) {
+        throw std::runtime_error("Failed to truncate Raft log: " + path);
+    }
+}
+
+// Parse one record at data; false if it is torn or fails its checksum
+bool decodeRecord(const char* data, size_t available, RaftLogEntryView& view, size_t& record_size) {
+    if (available < FRAME_SIZE) return false;
+
+    uint32_t crc, len;
+    std::memcpy(&crc, data, sizeof(crc));
+    std::memcpy(&len, data + sizeof(crc), sizeof(len));
+    if (len > available - FRAME_SIZE || crc32c(data + FRAME_SIZE, len) != crc) {
+        return false;
+    }
+
+    try {
+        view = RaftLogEntryView::parse(std::string_view(data + FRAME_SIZE, len));
+    } catch (const std::exception&) {
+        return false;
+    }
+    record_size = FRAME_SIZE + len;
+    return true;
+}
+
+} // namespace
+
+RaftLog::RaftLog(const std::string& dir, RaftLogOptions options) : dir_(dir), options_(options) {
+    std::filesystem::create_directories(dir_);
+    recover();
+}
+
+RaftLog::~RaftLog() {
+    try {
+        sync();
+    } catch (...) {
+    }
+    for (auto& seg : segments_) {
+        closeFd(seg.fd);
+    }
+}
+
+void RaftLog::recover() {
+    std::vector<std::pair<uint64_t, std::string>> files;
+    for (const auto& file : std::filesystem::directory_iterator(dir_)) {
+        uint64_t first_index;
+        if (file.is_regular_file() && parseSegmentName(file.path().filename().string(), first_index)) {
+            files.emplace_back(first_index, file.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::string buffer;
+    size_t kept = 0;
+    for (; kept < files.size(); kept++) {
+        const auto& [first_index, path] = files[kept];
+        if (kept == 0) {
+            first_index_ = first_index;
+        } else if (first_index != lastIndexLocked() + 1) {
+            break;  // A gap: a previous segment lost its tail
+        }
+
+        Segment seg{first_index, path};
+        seg.fd = openFd(path, false);
+        if (seg.fd < 0) {
+            throw std::runtime_error("Failed to open Raft log segment: " + path);
+        }
+
+        // Segments are bounded by segment_bytes, so read each in one go
+        buffer.resize(fileSize(seg.fd));
+        if (!buffer.empty()) {
+            readFully(seg.fd, buffer.data(), buffer.size(), 0, path);
+        }
+
+        size_t pos = 0;
+        RaftLogEntryView view;
+        size_t record_size;
+        while (decodeRecord(buffer.data() + pos, buffer.size() - pos, view, record_size) &&
+               view.index == lastIndexLocked() + 1) {
+            terms_.push_back(view.term);
+            offsets_.push_back(pos);
+            cache_.push_back(view.toEntry());
+            if (cache_.size() > options_.cache_entries) {
+                cache_.pop_front();
+            }
+            pos += record_size;
+        }
+        seg.size = pos;
+        segments_.push_back(std::move(seg));
+
+        if (pos < buffer.size()) {
+            // Everything from the first bad record on is lost, including later segments
+            std::cerr << "[RaftLog] Discarding " << buffer.size() - pos << " bytes of torn log in "
+                      << path << std::endl;
+            truncateFd(segments_.back().fd, pos, path);
+            dirty_ = true;
+            kept++;
+            break;
+        }
+    }
+
+    for (size_t i = kept; i < files.size(); i++) {
+        std::filesystem::remove(files[i].second);
+        dir_dirty_ = true;
+    }
+    sync();
+}
+
+// ==================== Reads ====================
+
+uint64_t RaftLog::firstIndex() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return first_index_;
+}
+
+uint64_t RaftLog::lastIndex() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastIndexLocked();
+}
+
+uint64_t RaftLog::lastTerm() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return terms_.empty() ? base_term_ : terms_.back();
+}
+
+uint64_t RaftLog::termAt(uint64_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index + 1 == first_index_) {
+        return base_term_;
+    }
+    if (index < first_index_ || index > lastIndexLocked()) {
+        return 0;
+    }
+    return terms_[index - first_index_];
+}
+
+RaftLogEntry RaftLog::entry(uint64_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < first_index_ || index > lastIndexLocked()) {
+        throw std::out_of_range("Raft log has no entry " + std::to_string(index));
+    }
+    return entryLocked(index);
+}
+
+std::vector<RaftLogEntry> RaftLog::entries(uint64_t from, uint64_t to, size_t max_entries,
+                                           size_t max_bytes) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    from = std::max(from, first_index_);
+    to = std::min(to, lastIndexLocked());
+
+    std::vector<RaftLogEntry> result;
+    size_t bytes = 0;
+    uint64_t index = from;
+    uint64_t cached_from = cache_.empty() ? lastIndexLocked() + 1 : cache_.front().index;
+    while (index <= to && index < cached_from && result.size() < max_entries && bytes < max_bytes) {
+        readRunLocked(index, std::min(to, cached_from - 1), max_entries - result.size(),
+                      max_bytes - bytes, result, bytes);
+    }
+    for (; index <= to && result.size() < max_entries && bytes < max_bytes; index++) {
+        result.push_back(cache_[index - cached_from]);
+        bytes += result.back().encodedSize();
+    }
+    return result;
+}
+
+void RaftLog::readRunLocked(uint64_t& index, uint64_t to, size_t max_entries, size_t max_bytes,
+                            std::vector<RaftLogEntry>& out, size_t& bytes) const {
+    // Consecutive records of one segment are adjacent in its file, so the
+    // whole run comes back in a single read
+    const Segment& seg = segmentFor(index);
+    uint64_t seg_last = &seg == &segments_.back() ? lastIndexLocked()
+                                                  : (&seg + 1)->first_index - 1;
+    auto recordEnd = [&](uint64_t i) {
+        return i < seg_last ? offsets_[i + 1 - first_index_] : seg.size;
+    };
+
+    uint64_t start = offsets_[index - first_index_];
+    uint64_t last = index;
+    uint64_t limit = std::min(to, seg_last);
+    while (last < limit && last - index + 1 < max_entries &&
+           recordEnd(last) - start - FRAME_SIZE * (last - index + 1) < max_bytes) {
+        last++;
+    }
+
+    std::string buffer(recordEnd(last) - start, '\0');
+    readFully(seg.fd, buffer.data(), buffer.size(), start, seg.path);
+
+    size_t pos = 0;
+    for (; index <= last; index++) {
+        RaftLogEntryView view;
+        size_t record_size;
+        if (!decodeRecord(buffer.data() + pos, buffer.size() - pos, view, record_size) ||
+            view.index != index) {
+            throw std::runtime_error("Corrupt Raft log record " + std::to_string(index) + " in " + seg.path);
+        }
+        out.push_back(view.toEntry());
+        bytes += record_size - FRAME_SIZE;
+        pos += record_size;
+    }
+}
+
+uint64_t RaftLog::firstIndexOfTerm(uint64_t term) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::lower_bound(terms_.begin(), terms_.end(), term);
+    if (it == terms_.end() || *it != term) return 0;
+    return first_index_ + (it - terms_.begin());
+}
+
+uint64_t RaftLog::lastIndexOfTerm(uint64_t term) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::upper_bound(terms_.begin(), terms_.end(), term);
+    if (it == terms_.begin() || *std::prev(it) != term) return 0;
+    return first_index_ + (it - terms_.begin()) - 1;
+}
+
+size_t RaftLog::segmentCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+RaftLogEntry RaftLog::entryLocked(uint64_t index) const {
+    if (!cache_.empty() && index >= cache_.front().index) {
+        return cache_[index - cache_.front().index];
+    }
+
+    const Segment& seg = segmentFor(index);
+    uint64_t offset = offsets_[index - first_index_];
+    char frame[FRAME_SIZE];
+    readFully(seg.fd, frame, FRAME_SIZE, offset, seg.path);
+
+    uint32_t len;
+    std::memcpy(&len, frame + 4, sizeof(len));
+    std::string record(FRAME_SIZE + len, '\0');
+    std::memcpy(record.data(), frame, FRAME_SIZE);
+    readFully(seg.fd, record.data() + FRAME_SIZE, len, offset + FRAME_SIZE, seg.path);
+
+    RaftLogEntryView view;
+    size_t record_size;
+    if (!decodeRecord(record.data(), record.size(), view, record_size) || view.index != index) {
+        throw std::runtime_error("Corrupt Raft log record " + std::to_string(index) + " in " + seg.path);
+    }
+    return view.toEntry();
+}
+
+const RaftLog::Segment& RaftLog::segmentFor(uint64_t index) const {
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), index,
+                               [](uint64_t i, const Segment& seg) { return i < seg.first_index; });
+    return *std::prev(it);
+}
+
+// ==================== Writes ====================
+
+uint64_t RaftLog::append(RaftLogEntry entry) {
+    std::vector<RaftLogEntry> batch;
+    batch.push_back(std::move(entry));
+    return append(std::move(batch));
+}
+
+uint64_t RaftLog::append(std::vector<RaftLogEntry> entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t first_new = lastIndexLocked() + 1;
+    try {
+        for (auto& entry : entries) {
+            appendLocked(entry);
+        }
+        writePending();
+    } catch (...) {
+        // Drop the partial batch so the index matches what is on disk
+        pending_.clear();
+        truncateLocked(first_new);
+        throw;
+    }
+    return lastIndexLocked();
+}
+
+void RaftLog::appendLocked(RaftLogEntry& entry) {
+    entry.index = lastIndexLocked() + 1;
+
+    if (segments_.empty() ||
+        segments_.back().size + pending_.size() >= options_.segment_bytes) {
+        writePending();
+        openNewSegment(entry.index);
+    }
+
+    // Frame the record straight into the pending buffer
+    uint32_t len = static_cast<uint32_t>(entry.encodedSize());
+    size_t start = pending_.size();
+    pending_.resize(start + FRAME_SIZE + len);
+    uint8_t* record = pending_.data() + start;
+    entry.encodeTo(record + FRAME_SIZE);
+    uint32_t crc = crc32c(reinterpret_cast<const char*>(record + FRAME_SIZE), len);
+    std::memcpy(record, &crc, sizeof(crc));
+    std::memcpy(record + sizeof(crc), &len, sizeof(len));
+
+    terms_.push_back(entry.term);
+    offsets_.push_back(segments_.back().size + start);
+    cache_.push_back(std::move(entry));
+    if (cache_.size() > options_.cache_entries) {
+        cache_.pop_front();
+    }
+}
+
+void RaftLog::writePending() {
+    if (pending_.empty()) {
+        return;
+    }
+    Segment& seg = segments_.back();
+    writeFully(seg.fd, pending_.data(), pending_.size(), seg.path);
+    seg.size += pending_.size();
+    pending_.clear();
+    dirty_ = true;
+}
+
+void RaftLog::openNewSegment(uint64_t first_index) {
+    // The finished segment is made durable now, so sync() only ever has the
+    // active segment to flush
+    if (!segments_.empty() && dirty_) {
+        syncFd(segments_.back().fd, segments_.back().path);
+        dirty_ = false;
+    }
+
+    Segment seg{first_index, (std::filesystem::path(dir_) / segmentName(first_index)).string()};
+    seg.fd = openFd(seg.path, true);
+    if (seg.fd < 0) {
+        throw std::runtime_error("Failed to create Raft log segment: " + seg.path);
+    }
+    segments_.push_back(std::move(seg));
+    dir_dirty_ = true;
+}
+
+void RaftLog::truncateFrom(uint64_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    truncateLocked(index);
+}
+
+void RaftLog::truncateLocked(uint64_t index) {
+    index = std::max(index, first_index_);
+    if (index > lastIndexLocked()) {
+        return;
+    }
+
+    // Later segments go whole, as does one that would be left empty
+    while (!segments_.empty() && segments_.back().first_index >= index) {
+        closeFd(segments_.back().fd);
+        std::filesystem::remove(segments_.back().path);
+        segments_.pop_back();
+        dir_dirty_ = true;
+        dirty_ = false;
+    }
+    if (!segments_.empty()) {
+        Segment& seg = segments_.back();
+        seg.size = offsets_[index - first_index_];
+        truncateFd(seg.fd, seg.size, seg.path);
+        dirty_ = true;
+    }
+
+    terms_.resize(index - first_index_);
+    offsets_.resize(index - first_index_);
+    while (!cache_.empty() && cache_.back().index >= index) {
+        cache_.pop_back();
+    }
+}
+
+void RaftLog::compact(uint64_t index, uint64_t term) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index + 1 < first_index_) {
+        return;  // Already gone
+    }
+
+    if (index >= lastIndexLocked()) {
+        // Nothing after the snapshot survives
+        for (auto& seg : segments_) {
+            closeFd(seg.fd);
+            std::filesystem::remove(seg.path);
+        }
+        dir_dirty_ = dir_dirty_ || !segments_.empty();
+        segments_.clear();
+        dirty_ = false;
+        terms_.clear();
+        offsets_.clear();
+        cache_.clear();
+    } else {
+        // Segments with nothing past index go; the one holding index + 1 stays whole
+        size_t drop = 0;
+        while (drop + 1 < segments_.size() && segments_[drop + 1].first_index <= index + 1) {
+            closeFd(segments_[drop].fd);
+            std::filesystem::remove(segments_[drop].path);
+            dir_dirty_ = true;
+            drop++;
+        }
+        segments_.erase(segments_.begin(), segments_.begin() + drop);
+
+        size_t gone = index + 1 - first_index_;
+        terms_.erase(terms_.begin(), terms_.begin() + gone);
+        offsets_.erase(offsets_.begin(), offsets_.begin() + gone);
+        while (!cache_.empty() && cache_.front().index <= index) {
+            cache_.pop_front();
+        }
+    }
+
+    first_index_ = index + 1;
+    base_term_ = term;
+}
+
+void RaftLog::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dirty_ && !segments_.empty()) {
+        syncFd(segments_.back().fd, segments_.back().path);
+    }
+    dirty_ = false;
+    if (dir_dirty_) {
+        syncDir(dir_);
+        dir_dirty_ = false;
+    }
+}
+
+} // namespace dkv
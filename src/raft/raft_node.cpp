@@ -1,25 +1,33 @@
 #include "raft/raft_node.hpp"
+#include "network/server.hpp"
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <filesystem>
+#include <iterator>
 
 namespace dkv {
 
 // Parse peer address "host:port"
-static PeerInfo parsePeerAddress(const std::string& addr) {
-    PeerInfo peer;
-    peer.id = addr;
+static std::unique_ptr<PeerInfo> parsePeerAddress(const std::string& addr) {
+    auto peer = std::make_unique<PeerInfo>();
+    peer->id = addr;
     auto colon = addr.find(':');
     if (colon != std::string::npos) {
-        peer.host = addr.substr(0, colon);
-        peer.port = static_cast<uint16_t>(std::stoi(addr.substr(colon + 1)));
+        peer->host = addr.substr(0, colon);
+        peer->port = static_cast<uint16_t>(std::stoi(addr.substr(colon + 1)));
     }
     return peer;
 }
 
 RaftNode::RaftNode(const std::string& data_dir, uint16_t port,
-                   const std::vector<std::string>& peers)
-    : port_(port), data_dir_(data_dir), state_(data_dir) {
+                   const std::vector<std::string>& peers, RaftOptions options)
+    : port_(port), data_dir_(data_dir), options_(options), state_(data_dir),
+      log_(data_dir + "/raft_log"),
+      events_(port, [this](const std::shared_ptr<Connection>& conn, std::string_view data) {
+          handleMessage(conn, data);
+      }) {
     
 #ifdef _WIN32
     WSADATA wsaData;
@@ -39,13 +47,12 @@ RaftNode::RaftNode(const std::string& data_dir, uint16_t port,
     
     // Initialize storage
     store_ = std::make_unique<LSMTree>(data_dir);
+    recoverSnapshot();
     
-    // Initialize log with dummy entry at index 0
-    RaftLogEntry dummy;
-    dummy.term = 0;
-    dummy.index = 0;
-    dummy.op = OpCode::OP_PING;
-    log_.push_back(dummy);
+    if (log_.lastIndex() >= log_.firstIndex()) {
+        std::cout << "[RAFT] Recovered log entries " << log_.firstIndex() << ".." << log_.lastIndex()
+                  << " (last term " << log_.lastTerm() << ")" << std::endl;
+    }
 }
 
 RaftNode::~RaftNode() {
@@ -60,97 +67,56 @@ void RaftNode::start() {
     if (running_) return;
     running_ = true;
     
-    // Create server socket
-    server_sock_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_sock_ == INVALID_SOCK) {
-        throw std::runtime_error("Failed to create socket");
-    }
-    
-    int opt = 1;
-#ifdef _WIN32
-    setsockopt(server_sock_, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
-#else
-    setsockopt(server_sock_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-#endif
-    
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port_);
-    
-    if (bind(server_sock_, (sockaddr*)&addr, sizeof(addr)) < 0) {
-        CLOSE_SOCKET(server_sock_);
-        throw std::runtime_error("Failed to bind to port " + std::to_string(port_));
-    }
-    
-    if (listen(server_sock_, 10) < 0) {
-        CLOSE_SOCKET(server_sock_);
-        throw std::runtime_error("Failed to listen");
-    }
+    events_.start();
     
     std::cout << "[RAFT] Node " << state_.getNodeId() << " starting as FOLLOWER" << std::endl;
     
     // Start threads
-    accept_thread_ = std::thread(&RaftNode::acceptLoop, this);
     raft_thread_ = std::thread(&RaftNode::raftLoop, this);
     peer_thread_ = std::thread(&RaftNode::peerConnectionLoop, this);
+    for (auto& peer : peers_) {
+        peer->replicator = std::thread(&RaftNode::replicatorLoop, this, std::ref(*peer));
+    }
 }
 
 void RaftNode::stop() {
     if (!running_) return;
     running_ = false;
     
-    // Wake up raft loop
+    // Wake up raft loop and replicators
     raft_cv_.notify_all();
+    wakeReplicators();
     
-    // Close server socket
-    if (server_sock_ != INVALID_SOCK) {
-        CLOSE_SOCKET(server_sock_);
-        server_sock_ = INVALID_SOCK;
+    // Join threads; an RPC in progress ends within the socket timeout
+    if (raft_thread_.joinable()) raft_thread_.join();
+    if (peer_thread_.joinable()) peer_thread_.join();
+    for (auto& peer : peers_) {
+        if (peer->replicator.joinable()) peer->replicator.join();
     }
     
     // Disconnect peers
-    {
-        std::lock_guard<std::mutex> lock(peers_mutex_);
-        for (auto& peer : peers_) {
-            disconnectPeer(peer);
-        }
+    for (auto& peer : peers_) {
+        std::lock_guard<std::mutex> lock(peer->io_mutex);
+        disconnectPeer(*peer);
     }
     
-    // Join threads
-    if (accept_thread_.joinable()) accept_thread_.join();
-    if (raft_thread_.joinable()) raft_thread_.join();
-    if (peer_thread_.joinable()) peer_thread_.join();
-    
+    // Writes still in flight are not answered by this node any more
     {
-        std::lock_guard<std::mutex> lock(threads_mutex_);
-        for (auto& t : client_threads_) {
-            if (t.joinable()) t.join();
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        proposals_.clear();
+        for (auto& batch : confirmed_reads_) {
+            std::move(batch.reads.begin(), batch.reads.end(), std::back_inserter(reads_));
         }
-        client_threads_.clear();
+        confirmed_reads_.clear();
     }
+    failWaiters("Node stopped");
+    failReads("Node stopped");
+    
+    events_.stop();
 }
 
 // ==================== Main Loops ====================
 
-void RaftNode::acceptLoop() {
-    while (running_) {
-        sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
-        
-        SocketType client_sock = accept(server_sock_, (sockaddr*)&client_addr, &addr_len);
-        if (client_sock == INVALID_SOCK) {
-            if (running_) {
-                // Could be a spurious wakeup or error
-            }
-            continue;
-        }
-        
-        std::lock_guard<std::mutex> lock(threads_mutex_);
-        client_threads_.emplace_back(&RaftNode::handleClient, this, client_sock);
-    }
-}
-
 void RaftNode::raftLoop() {
     // Wait for peer connections to establish before starting elections
     // This gives time for the cluster to form
@@ -158,32 +124,35 @@ void RaftNode::raftLoop() {
     state_.resetElectionTimeout();
     
     while (running_) {
-        // Sleep for a short interval
+        // Sleep for a short interval, or until a client proposes a write
         {
             std::unique_lock<std::mutex> lock(raft_mutex_);
-            raft_cv_.wait_for(lock, std::chrono::milliseconds(10));
+            raft_cv_.wait_for(lock, std::chrono::milliseconds(10), [this] {
+                return !running_ || !proposals_.empty() || read_work_ || pending_install_ ||
+                       state_.volatile_state().commit_index > state_.volatile_state().last_applied;
+            });
+            read_work_ = false;
         }
         
         if (!running_) break;
         
+        // Everything proposed since the last round is appended together
+        bool appended = appendProposals();
+        
         RaftRole role = state_.getRole();
         
         if (role == RaftRole::RAFT_LEADER) {
-            // Send heartbeats periodically
-            if (state_.shouldSendHeartbeat()) {
-                sendHeartbeats();
-                state_.resetHeartbeatTimer();
+            // Replicators send heartbeats on their own; new entries go out at once
+            if (appended) {
+                wakeReplicators();
             }
         } else {
             // Check for election timeout
             if (state_.isElectionTimedOut()) {
                 // Only start election if we have peer connections
                 int connected_peers = 0;
-                {
-                    std::lock_guard<std::mutex> lock(peers_mutex_);
-                    for (const auto& peer : peers_) {
-                        if (peer.connected) connected_peers++;
-                    }
+                for (const auto& peer : peers_) {
+                    if (peer->connected) connected_peers++;
                 }
                 
                 // Need at least one peer connected to have a chance at majority
@@ -196,8 +165,12 @@ void RaftNode::raftLoop() {
             }
         }
         
-        // Apply committed entries
+        // Apply committed entries, then answer the reads waiting for them
+        installPendingSnapshot();
         applyCommittedEntries();
+        startReadRound();
+        serveReads();
+        maybeSnapshot();
     }
 }
 
@@ -205,10 +178,10 @@ void RaftNode::peerConnectionLoop() {
     while (running_) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         
-        std::lock_guard<std::mutex> lock(peers_mutex_);
         for (auto& peer : peers_) {
-            if (!peer.connected) {
-                connectToPeer(peer);
+            if (!peer->connected) {
+                std::lock_guard<std::mutex> lock(peer->io_mutex);
+                connectToPeer(*peer);
             }
         }
     }
@@ -216,91 +189,95 @@ void RaftNode::peerConnectionLoop() {
 
 // ==================== Client Handling ====================
 
-void RaftNode::handleClient(SocketType client_sock) {
-    while (running_) {
-        auto msg = recvRawMessage(client_sock);
-        if (msg.empty()) break;
+void RaftNode::handleMessage(const std::shared_ptr<Connection>& conn, std::string_view data) {
+    uint32_t id = 0;
+    try {
+        RequestView req = RequestView::parse(data);
+        id = req.id;
         
-        try {
-            Request req = Request::deserialize(msg);
-            
-            // Handle Raft RPCs
-            if (req.op == OpCode::OP_REQUEST_VOTE) {
-                RequestVote rv = RequestVote::deserialize(
-                    std::vector<uint8_t>(req.value.begin(), req.value.end())
-                );
-                auto resp = handleRequestVote(rv);
-                auto resp_data = resp.serialize();
-                
-                Request reply;
-                reply.op = OpCode::OP_REQUEST_VOTE_RESP;
-                reply.value = std::string(resp_data.begin(), resp_data.end());
-                sendRawMessage(client_sock, reply.serialize());
-                continue;
-            }
+        // Handle Raft RPCs
+        if (req.op == OpCode::OP_REQUEST_VOTE) {
+            RequestVote rv = RequestVote::deserialize(
+                std::vector<uint8_t>(req.value.begin(), req.value.end())
+            );
+            auto resp = handleRequestVote(rv);
+            auto resp_data = resp.serialize();
             
-            if (req.op == OpCode::OP_APPEND_ENTRIES) {
-                AppendEntries ae = AppendEntries::deserialize(
-                    std::vector<uint8_t>(req.value.begin(), req.value.end())
-                );
-                auto resp = handleAppendEntries(ae);
-                auto resp_data = resp.serialize();
-                
-                Request reply;
-                reply.op = OpCode::OP_APPEND_ENTRIES_RESP;
-                reply.value = std::string(resp_data.begin(), resp_data.end());
-                sendRawMessage(client_sock, reply.serialize());
-                continue;
-            }
+            Request reply;
+            reply.id = req.id;
+            reply.op = OpCode::OP_REQUEST_VOTE_RESP;
+            reply.value = std::string(resp_data.begin(), resp_data.end());
+            conn->send(reply);
+            return;
+        }
+        
+        if (req.op == OpCode::OP_APPEND_ENTRIES) {
+            // Parsed in place; entries are copied only when they are appended
+            AppendEntriesView ae = AppendEntriesView::parse(req.value);
+            auto resp = handleAppendEntries(ae);
+            auto resp_data = resp.serialize();
             
-            // Handle client request
-            Response resp = processClientRequest(req);
-            sendRawMessage(client_sock, resp.serialize());
+            Request reply;
+            reply.id = req.id;
+            reply.op = OpCode::OP_APPEND_ENTRIES_RESP;
+            reply.value = std::string(resp_data.begin(), resp_data.end());
+            conn->send(reply);
+            return;
+        }
+        
+        if (req.op == OpCode::OP_INSTALL_SNAPSHOT) {
+            auto resp = handleInstallSnapshot(InstallSnapshot::deserialize(req.value));
+            auto resp_data = resp.serialize();
             
-        } catch (const std::exception& e) {
-            Response resp{StatusCode::STATUS_ERROR, "", e.what()};
-            sendRawMessage(client_sock, resp.serialize());
+            Request reply;
+            reply.id = req.id;
+            reply.op = OpCode::OP_INSTALL_SNAPSHOT_RESP;
+            reply.value = std::string(resp_data.begin(), resp_data.end());
+            conn->send(reply);
+            return;
+        }
+        
+        if (req.op == OpCode::OP_SCAN) {
+            // Reads can be served by any node (stale reads possible)
+            streamScan(*store_, req, [&](const Response& resp) {
+                return conn->send(resp);
+            });
+            return;
+        }
+        
+        if ((req.op == OpCode::OP_GET || req.op == OpCode::OP_MGET) &&
+            state_.getRole() == RaftRole::RAFT_LEADER) {
+            // Answered once leadership is confirmed and the read index applied
+            proposeRead(conn, data);
+            return;
         }
+        
+        if (req.op == OpCode::OP_PUT || req.op == OpCode::OP_DELETE ||
+            req.op == OpCode::OP_MPUT || req.op == OpCode::OP_MDEL) {
+            // Answered once the entry is committed and applied
+            proposeWrite(conn, req);
+            return;
+        }
+        
+        // Handle client request
+        Response resp = processClientRequest(req);
+        resp.id = req.id;
+        conn->send(resp);
+        
+    } catch (const std::exception& e) {
+        Response resp{StatusCode::STATUS_ERROR, "", e.what(), id};
+        conn->send(resp);
     }
-    
-    CLOSE_SOCKET(client_sock);
 }
 
-Response RaftNode::processClientRequest(const Request& req) {
+Response RaftNode::processClientRequest(const RequestView& req) {
     Response resp;
     resp.status = StatusCode::STATUS_OK;
     
     switch (req.op) {
-        case OpCode::OP_PUT:
-        case OpCode::OP_DELETE: {
-            // Write operations must go through leader
-            if (state_.getRole() != RaftRole::RAFT_LEADER) {
-                resp.status = StatusCode::STATUS_ERROR;
-                resp.error = "Not leader. Leader: " + state_.getLeaderId();
-                return resp;
-            }
-            
-            // Append to log
-            uint64_t index = appendLog(req.op, req.key, req.value);
-            
-            // Replicate to followers (simplified: just send immediately)
-            sendHeartbeats();
-            
-            // Wait for commit (simplified: immediate for now)
-            // In real implementation, we'd wait for majority and then respond
-            
-            // Apply to state machine
-            if (req.op == OpCode::OP_PUT) {
-                store_->put(req.key, req.value);
-            } else {
-                store_->del(req.key);
-            }
-            break;
-        }
-        
         case OpCode::OP_GET: {
-            // Reads can be served by any node (stale reads possible)
-            auto value = store_->get(req.key);
+            // The leader gets here through ReadIndex; a follower's answer may be stale
+            auto value = store_->get(std::string(req.key));
             if (value) {
                 resp.value = *value;
             } else {
@@ -309,6 +286,10 @@ Response RaftNode::processClientRequest(const Request& req) {
             break;
         }
         
+        case OpCode::OP_MGET:
+            // As for GET
+            return serveMultiGet(*store_, req);
+        
         case OpCode::OP_PING:
             resp.value = "PONG";
             break;
@@ -324,6 +305,40 @@ Response RaftNode::processClientRequest(const Request& req) {
     return resp;
 }
 
+void RaftNode::proposeWrite(const std::shared_ptr<Connection>& conn, const RequestView& req) {
+    // Write operations must go through leader
+    if (state_.getRole() != RaftRole::RAFT_LEADER) {
+        conn->send(Response{StatusCode::STATUS_ERROR, "", "Not leader. Leader: " + state_.getLeaderId(), req.id});
+        return;
+    }
+    
+    // A batch is one log entry carrying its MultiRequest, so it commits and
+    // applies atomically; reject a bad one now rather than at apply time
+    if (req.op == OpCode::OP_MPUT || req.op == OpCode::OP_MDEL) {
+        MultiRequestView batch = MultiRequestView::parse(req.value);
+        if (req.op == OpCode::OP_MPUT && batch.values.size() != batch.keys.size()) {
+            conn->send(Response{StatusCode::STATUS_ERROR, "", "OP_MPUT needs a value for every key", req.id});
+            return;
+        }
+    }
+    
+    RaftLogEntry entry{0, 0, req.op, std::string(req.key), std::string(req.value)};
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        proposals_.push_back(Proposal{conn, req.id, std::move(entry)});
+    }
+    raft_cv_.notify_one();
+}
+
+void RaftNode::proposeRead(const std::shared_ptr<Connection>& conn, std::string_view data) {
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        reads_.push_back(ReadRequest{conn, std::string(data)});
+        read_work_ = true;
+    }
+    raft_cv_.notify_one();
+}
+
 Response RaftNode::buildStatusResponse() const {
     Response resp;
     resp.status = StatusCode::STATUS_OK;
@@ -341,15 +356,17 @@ Response RaftNode::buildStatusResponse() const {
     ss << "leader:" << state_.getLeaderId() << "\n";
     ss << "log_size:" << getLastLogIndex() << "\n";
     ss << "commit_index:" << state_.volatile_state().commit_index << "\n";
+    auto snapshot = currentSnapshot();
+    ss << "snapshot_index:" << (snapshot ? snapshot->lastIndex() : 0) << "\n";
+    ss << "read_rounds:" << read_round_ << "\n";
+    ss << "connections:" << events_.connectionCount() << "\n";
     
     int connected = 0;
-    {
-        std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(peers_mutex_));
-        for (const auto& p : peers_) {
-            if (p.connected) connected++;
-        }
+    for (const auto& p : peers_) {
+        if (p->connected) connected++;
     }
     ss << "peers:" << peers_.size() << " (connected:" << connected << ")\n";
+    ss << store_->stats().toString();
     
     resp.value = ss.str();
     return resp;
@@ -370,16 +387,17 @@ void RaftNode::startElection() {
     state_.setVotedFor(state_.getNodeId());
     
     // Request votes from peers
-    std::lock_guard<std::mutex> peers_lock(peers_mutex_);
     for (auto& peer : peers_) {
-        if (peer.connected) {
-            requestVoteFromPeer(peer);
+        if (peer->connected) {
+            std::lock_guard<std::mutex> io_lock(peer->io_mutex);
+            requestVoteFromPeer(*peer);
         }
     }
     
-    // Check if we won
+    // Check if we won, unless a newer term made us a follower while we asked
     int majority = (static_cast<int>(peers_.size()) + 1) / 2 + 1;
-    if (votes_received_ >= majority) {
+    if (votes_received_ >= majority && state_.getRole() == RaftRole::RAFT_CANDIDATE &&
+        state_.getCurrentTerm() == term) {
         becomeLeader();
     }
 }
@@ -397,14 +415,15 @@ void RaftNode::requestVoteFromPeer(PeerInfo& peer) {
     req.op = OpCode::OP_REQUEST_VOTE;
     req.value = std::string(rv_data.begin(), rv_data.end());
     
-    if (!sendRawMessage(peer.socket, req.serialize())) {
-        peer.connected = false;
+    if (!peer.connected) return;
+    if (!sendFrame(peer.socket, encodeFrame(req))) {
+        disconnectPeer(peer);
         return;
     }
     
     auto resp_data = recvRawMessage(peer.socket);
     if (resp_data.empty()) {
-        peer.connected = false;
+        disconnectPeer(peer);
         return;
     }
     
@@ -464,93 +483,203 @@ RequestVoteResponse RaftNode::handleRequestVote(const RequestVote& rv) {
 
 // ==================== Heartbeats & AppendEntries ====================
 
-void RaftNode::sendHeartbeats() {
-    std::lock_guard<std::mutex> lock(peers_mutex_);
-    
+void RaftNode::wakeReplicators() {
     for (auto& peer : peers_) {
-        if (peer.connected) {
-            sendAppendEntriesToPeer(peer);
+        {
+            std::lock_guard<std::mutex> lock(peer->wake_mutex);
+            peer->wake = true;
+        }
+        peer->wake_cv.notify_one();
+    }
+}
+
+void RaftNode::replicatorLoop(PeerInfo& peer) {
+    auto heartbeat_interval = std::chrono::milliseconds(state_.getHeartbeatIntervalMs());
+    
+    while (running_) {
+        // Sleep until there is something new to send or a heartbeat is due
+        {
+            std::unique_lock<std::mutex> lock(peer.wake_mutex);
+            peer.wake_cv.wait_for(lock, heartbeat_interval, [&] { return !running_ || peer.wake; });
+            peer.wake = false;
+        }
+        
+        if (!running_) break;
+        if (state_.getRole() != RaftRole::RAFT_LEADER || !peer.connected) continue;
+        
+        std::lock_guard<std::mutex> io_lock(peer.io_mutex);
+        replicateToPeer(peer);
+    }
+}
+
+void RaftNode::replicateToPeer(PeerInfo& peer) {
+    // Fill the window, then read the oldest answer, until the peer has every
+    // entry. Only returns once each RPC sent has been answered, so whoever
+    // uses the socket next finds nothing left over on it.
+    std::deque<InflightAppend> inflight;
+    size_t inflight_bytes = 0;
+    uint32_t next_id = 1;
+    bool heartbeat = true;   // The first RPC goes out even with nothing new
+    
+    while (peer.connected) {
+        while (running_ && peer.connected &&
+               (inflight.empty() ||
+                (!peer.probing && inflight.size() < options_.max_inflight_appends &&
+                 inflight_bytes < options_.max_inflight_bytes))) {
+            InflightAppend rpc{next_id++, 0, 0, 0};
+            if (!sendAppendEntriesToPeer(peer, heartbeat, rpc)) break;
+            heartbeat = false;
+            inflight_bytes += rpc.bytes;
+            inflight.push_back(rpc);
+        }
+        if (inflight.empty()) {
+            // Either caught up, or behind the start of the log
+            if (!needsSnapshot(peer)) return;
+            try {
+                if (!sendSnapshotToPeer(peer)) return;
+            } catch (const std::exception& e) {
+                // A malformed reply, or the snapshot's files unreadable
+                std::cerr << "[RAFT] Sending snapshot to " << peer.id << " failed: "
+                          << e.what() << std::endl;
+                disconnectPeer(peer);
+                return;
+            }
+            continue;
+        }
+        
+        auto resp_data = recvRawMessage(peer.socket);
+        if (resp_data.empty()) {
+            disconnectPeer(peer);
+            return;
+        }
+        
+        InflightAppend rpc = inflight.front();
+        inflight.pop_front();
+        inflight_bytes -= rpc.bytes;
+        try {
+            if (handleAppendEntriesReply(peer, rpc, resp_data)) {
+                // Everything still in flight was built on the rejected guess
+                for (auto& later : inflight) {
+                    later.stale = true;
+                }
+            }
+        } catch (...) {
+            disconnectPeer(peer);
+            return;
         }
     }
 }
 
-void RaftNode::sendAppendEntriesToPeer(PeerInfo& peer) {
+bool RaftNode::sendAppendEntriesToPeer(PeerInfo& peer, bool heartbeat, InflightAppend& rpc) {
     AppendEntries ae;
-    ae.term = state_.getCurrentTerm();
-    ae.leader_id = state_.getNodeId();
-    ae.leader_commit = state_.volatile_state().commit_index;
+    uint64_t next_idx;
+    {
+        std::lock_guard<std::mutex> lock(leader_mutex_);
+        if (state_.getRole() != RaftRole::RAFT_LEADER) return false;
+        next_idx = state_.leader_state().next_index[peer.id];
+        if (!heartbeat && next_idx > log_.lastIndex()) return false;  // Caught up
+        if (next_idx < log_.firstIndex()) return false;                // Needs a snapshot
+        ae.term = leader_term_;
+        ae.leader_id = state_.getNodeId();
+        ae.leader_commit = state_.volatile_state().commit_index;
+        rpc.read_round = read_round_;
+    }
     
     // Get entries to send
-    uint64_t next_idx = state_.leader_state().next_index[peer.id];
     ae.prev_log_index = next_idx - 1;
-    ae.prev_log_term = (ae.prev_log_index > 0) ? getLogEntry(ae.prev_log_index).term : 0;
+    ae.prev_log_term = log_.termAt(ae.prev_log_index);
+    
+    // Add entries from next_index onwards; older ones are read back from disk
+    ae.entries = log_.entries(next_idx, log_.lastIndex(), options_.max_append_entries,
+                              options_.max_append_bytes);
+    if (!ae.entries.empty() && ae.entries.front().index != next_idx) {
+        return false;  // Compacted away since the check above
+    }
     
-    // Add entries from next_index onwards
-    std::lock_guard<std::mutex> log_lock(log_mutex_);
-    for (uint64_t i = next_idx; i <= getLastLogIndex() && ae.entries.size() < 100; ++i) {
-        ae.entries.push_back(log_[i]);
+    rpc.term = ae.term;
+    rpc.last_index = ae.prev_log_index + ae.entries.size();
+    for (const auto& entry : ae.entries) {
+        rpc.bytes += entry.encodedSize();
     }
     
     auto ae_data = ae.serialize();
     
     Request req;
+    req.id = rpc.id;
     req.op = OpCode::OP_APPEND_ENTRIES;
     req.value = std::string(ae_data.begin(), ae_data.end());
     
-    if (!sendRawMessage(peer.socket, req.serialize())) {
-        peer.connected = false;
-        return;
+    if (!sendFrame(peer.socket, encodeFrame(req))) {
+        disconnectPeer(peer);
+        return false;
     }
     
-    auto resp_data = recvRawMessage(peer.socket);
-    if (resp_data.empty()) {
-        peer.connected = false;
-        return;
+    // Assume the peer takes them, so the next RPC carries what follows
+    if (!ae.entries.empty()) {
+        std::lock_guard<std::mutex> lock(leader_mutex_);
+        if (leader_term_ == ae.term) {
+            state_.leader_state().next_index[peer.id] = rpc.last_index + 1;
+        }
     }
+    return true;
+}
+
+bool RaftNode::handleAppendEntriesReply(PeerInfo& peer, const InflightAppend& rpc,
+                                        const std::vector<uint8_t>& data) {
+    Request reply = Request::deserialize(data);
+    if (reply.op != OpCode::OP_APPEND_ENTRIES_RESP || reply.id != rpc.id) {
+        throw std::runtime_error("Unexpected reply to AppendEntries from " + peer.id);
+    }
+    auto aer = AppendEntriesResponse::deserialize(
+        std::vector<uint8_t>(reply.value.begin(), reply.value.end())
+    );
     
-    try {
-        Request reply = Request::deserialize(resp_data);
-        if (reply.op == OpCode::OP_APPEND_ENTRIES_RESP) {
-            auto aer = AppendEntriesResponse::deserialize(
-                std::vector<uint8_t>(reply.value.begin(), reply.value.end())
-            );
-            
-            if (aer.term > state_.getCurrentTerm()) {
-                becomeFollower(aer.term);
-                return;
-            }
-            
-            if (aer.success) {
-                state_.leader_state().next_index[peer.id] = aer.match_index + 1;
-                state_.leader_state().match_index[peer.id] = aer.match_index;
-                
-                // Update commit index
-                // Find the highest index replicated on majority
-                std::vector<uint64_t> match_indices;
-                match_indices.push_back(getLastLogIndex()); // Leader's own
-                for (const auto& [_, idx] : state_.leader_state().match_index) {
-                    match_indices.push_back(idx);
-                }
-                std::sort(match_indices.begin(), match_indices.end());
-                
-                size_t majority_idx = match_indices.size() / 2;
-                uint64_t new_commit = match_indices[majority_idx];
-                
-                if (new_commit > state_.volatile_state().commit_index &&
-                    getLogEntry(new_commit).term == state_.getCurrentTerm()) {
-                    state_.volatile_state().commit_index = new_commit;
-                }
-            } else {
-                // Decrement next_index and retry
-                if (state_.leader_state().next_index[peer.id] > 1) {
-                    state_.leader_state().next_index[peer.id]--;
-                }
-            }
+    if (aer.term > state_.getCurrentTerm()) {
+        becomeFollower(aer.term);
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(leader_mutex_);
+    // A reply to a previous term's leader says nothing about this one
+    if (state_.getRole() != RaftRole::RAFT_LEADER || leader_term_ != rpc.term) {
+        return false;
+    }
+    
+    // Any answer in this term, even a rejection, means the peer still follows us
+    if (rpc.read_round > peer.read_ack) {
+        peer.read_ack = rpc.read_round;
+        confirmReads();
+    }
+    
+    auto& leader = state_.leader_state();
+    if (aer.success) {
+        if (aer.match_index > leader.match_index[peer.id]) {
+            leader.match_index[peer.id] = aer.match_index;
+            advanceCommitIndex();
         }
-    } catch (...) {}
+        leader.next_index[peer.id] = std::max(leader.next_index[peer.id], aer.match_index + 1);
+        peer.probing = false;
+        return false;
+    }
+    if (rpc.stale) {
+        return false;
+    }
+    
+    // Back up past the follower's whole conflicting term: to just after our
+    // own last entry of that term, or to where the follower's term starts
+    uint64_t next = aer.conflict_index;
+    if (aer.conflict_term != 0) {
+        uint64_t last = log_.lastIndexOfTerm(aer.conflict_term);
+        if (last != 0) {
+            next = last + 1;
+        }
+    }
+    leader.next_index[peer.id] = std::clamp(next, leader.match_index[peer.id] + 1, log_.lastIndex() + 1);
+    peer.probing = true;
+    return true;
 }
 
-AppendEntriesResponse RaftNode::handleAppendEntries(const AppendEntries& ae) {
+AppendEntriesResponse RaftNode::handleAppendEntries(const AppendEntriesView& ae) {
     AppendEntriesResponse resp;
     resp.term = state_.getCurrentTerm();
     resp.success = false;
@@ -571,108 +700,629 @@ AppendEntriesResponse RaftNode::handleAppendEntries(const AppendEntries& ae) {
         } else if (ae.term > state_.getCurrentTerm()) {
             state_.setCurrentTerm(ae.term);
         }
-        state_.setLeaderId(ae.leader_id);
+        state_.setLeaderId(std::string(ae.leader_id));
     }
     
     // Check if log contains entry at prev_log_index with prev_log_term
     std::lock_guard<std::mutex> lock(log_mutex_);
     
     if (ae.prev_log_index > 0) {
-        if (ae.prev_log_index >= log_.size()) {
-            return resp; // We don't have the entry
+        if (ae.prev_log_index + 1 < log_.firstIndex()) {
+            // Covered by our snapshot, so it matches; resume after it
+            resp.conflict_index = log_.firstIndex();
+            return resp;
+        }
+        if (ae.prev_log_index > log_.lastIndex()) {
+            // We don't have the entry; the leader can resume after our last one
+            resp.conflict_index = log_.lastIndex() + 1;
+            return resp;
         }
-        if (log_[ae.prev_log_index].term != ae.prev_log_term) {
-            return resp; // Term mismatch
+        uint64_t term = log_.termAt(ae.prev_log_index);
+        if (term != ae.prev_log_term) {
+            // Term mismatch; point the leader at the start of our term
+            resp.conflict_term = term;
+            resp.conflict_index = log_.firstIndexOfTerm(term);
+            return resp;
         }
     }
     
-    // Append entries
+    // Skip entries we already have, cut the log at the first conflict and
+    // append the rest with a single write
     uint64_t idx = ae.prev_log_index + 1;
+    std::vector<RaftLogEntry> new_entries;
     for (const auto& entry : ae.entries) {
-        if (idx < log_.size()) {
-            if (log_[idx].term != entry.term) {
+        if (new_entries.empty() && idx <= log_.lastIndex()) {
+            if (log_.termAt(idx) != entry.term) {
                 // Conflict - delete this and all following
-                log_.resize(idx);
-                log_.push_back(entry);
+                log_.truncateFrom(idx);
+                new_entries.push_back(entry.toEntry());
             }
             // else: entry already exists and matches
         } else {
-            log_.push_back(entry);
+            new_entries.push_back(entry.toEntry());
         }
         idx++;
     }
+    if (!new_entries.empty()) {
+        log_.append(std::move(new_entries));
+    }
     
-    // Update commit index
+    // The leader counts this reply toward commitment, so the entries must be
+    // on stable storage first; one fsync covers the whole batch
+    log_.sync();
+    
+    // Update commit index (only up to what this leader has confirmed)
+    uint64_t last_new_index = ae.prev_log_index + ae.entries.size();
     if (ae.leader_commit > state_.volatile_state().commit_index) {
-        state_.volatile_state().commit_index = 
-            std::min(ae.leader_commit, static_cast<uint64_t>(log_.size() - 1));
+        state_.volatile_state().commit_index = std::min(ae.leader_commit, last_new_index);
     }
     
     resp.success = true;
-    resp.match_index = log_.size() - 1;
+    resp.match_index = last_new_index;
     resp.term = state_.getCurrentTerm();
     return resp;
 }
 
 // ==================== Log Management ====================
 
-uint64_t RaftNode::appendLog(OpCode op, const std::string& key, const std::string& value) {
+bool RaftNode::appendProposals() {
+    std::deque<Proposal> proposals;
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        proposals.swap(proposals_);
+    }
+    if (proposals.empty()) return false;
+    
     std::lock_guard<std::mutex> lock(log_mutex_);
+    if (state_.getRole() != RaftRole::RAFT_LEADER) {
+        for (const auto& proposal : proposals) {
+            proposal.conn->send(Response{StatusCode::STATUS_ERROR, "",
+                                         "Not leader. Leader: " + state_.getLeaderId(),
+                                         proposal.request_id});
+        }
+        return false;
+    }
     
-    RaftLogEntry entry;
-    entry.term = state_.getCurrentTerm();
-    entry.index = log_.size();
-    entry.op = op;
-    entry.key = key;
-    entry.value = value;
+    uint64_t term = leader_term_;
+    std::vector<RaftLogEntry> entries;
+    entries.reserve(proposals.size());
+    for (auto& proposal : proposals) {
+        proposal.entry.term = term;
+        entries.push_back(std::move(proposal.entry));
+    }
+    
+    // The leader counts itself toward a majority, so persist before replicating;
+    // one write and one fsync cover the whole batch
+    uint64_t index = log_.append(std::move(entries)) - proposals.size() + 1;
+    log_.sync();
+    
+    {
+        std::lock_guard<std::mutex> waiters_lock(waiters_mutex_);
+        for (auto& proposal : proposals) {
+            if (proposal.conn) {
+                waiters_.emplace(index, Waiter{std::move(proposal.conn), proposal.request_id, term});
+            }
+            index++;
+        }
+    }
+    
+    // Without peers the leader's own copy is a majority
+    std::lock_guard<std::mutex> leader_lock(leader_mutex_);
+    advanceCommitIndex();
+    return true;
+}
+
+void RaftNode::advanceCommitIndex() {
+    // Called with leader_mutex_ held.
+    // Find the highest index replicated on a majority, counting the leader
+    std::vector<uint64_t> match_indices;
+    match_indices.push_back(getLastLogIndex());
+    for (const auto& [_, idx] : state_.leader_state().match_index) {
+        match_indices.push_back(idx);
+    }
+    std::sort(match_indices.begin(), match_indices.end(), std::greater<uint64_t>());
+    uint64_t new_commit = match_indices[match_indices.size() / 2];
     
-    log_.push_back(entry);
-    return entry.index;
+    // Entries from earlier terms are only committed indirectly, by a later one
+    if (new_commit > state_.volatile_state().commit_index &&
+        log_.termAt(new_commit) == leader_term_) {
+        state_.volatile_state().commit_index = new_commit;
+        
+        // Apply and answer the waiting clients now rather than on the next tick
+        { std::lock_guard<std::mutex> lock(raft_mutex_); }
+        raft_cv_.notify_one();
+    }
 }
 
 RaftLogEntry RaftNode::getLogEntry(uint64_t index) const {
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    if (index < log_.size()) {
-        return log_[index];
+    if (index == 0 || index > log_.lastIndex()) {
+        return RaftLogEntry{};
     }
-    return RaftLogEntry{};
+    return log_.entry(index);
 }
 
 uint64_t RaftNode::getLastLogIndex() const {
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    return log_.size() - 1;
+    return log_.lastIndex();
 }
 
 uint64_t RaftNode::getLastLogTerm() const {
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    return log_.empty() ? 0 : log_.back().term;
+    return log_.lastTerm();
 }
 
 void RaftNode::applyCommittedEntries() {
-    std::lock_guard<std::mutex> lock(log_mutex_);
+    // Everything newly committed goes to the store as one atomic batch
+    std::lock_guard<std::mutex> apply_lock(apply_mutex_);
+    uint64_t last_applied = state_.volatile_state().last_applied;
+    uint64_t commit_index = state_.volatile_state().commit_index;
+    if (commit_index <= last_applied) return;
+    
+    WriteBatch batch;
+    for (const auto& entry : log_.entries(last_applied + 1, commit_index)) {
+        if (entry.op == OpCode::OP_PUT) {
+            batch.put(entry.key, entry.value);
+        } else if (entry.op == OpCode::OP_DELETE) {
+            batch.del(entry.key);
+        } else if (entry.op == OpCode::OP_MPUT || entry.op == OpCode::OP_MDEL) {
+            // Checked by the leader before it was proposed
+            MultiRequestView multi = MultiRequestView::parse(entry.value);
+            for (size_t i = 0; i < multi.keys.size(); i++) {
+                if (entry.op == OpCode::OP_MPUT) {
+                    batch.put(multi.keys[i], multi.values[i]);
+                } else {
+                    batch.del(multi.keys[i]);
+                }
+            }
+        }
+    }
+    
+    store_->write(batch);
+    state_.volatile_state().last_applied = commit_index;
+    
+    // Answer the clients whose writes just took effect. An index that now
+    // holds an entry from another term was overwritten by a newer leader.
+    std::vector<std::pair<Waiter, bool>> done;
+    {
+        std::lock_guard<std::mutex> lock(waiters_mutex_);
+        auto end = waiters_.upper_bound(commit_index);
+        for (auto it = waiters_.begin(); it != end; ++it) {
+            bool applied = log_.termAt(it->first) == it->second.term;
+            done.emplace_back(std::move(it->second), applied);
+        }
+        waiters_.erase(waiters_.begin(), end);
+    }
+    for (const auto& [waiter, applied] : done) {
+        if (applied) {
+            waiter.conn->send(Response{StatusCode::STATUS_OK, "", "", waiter.request_id});
+        } else {
+            waiter.conn->send(Response{StatusCode::STATUS_ERROR, "", "Write lost to a leader change",
+                                       waiter.request_id});
+        }
+    }
+}
+
+void RaftNode::failWaiters(const std::string& error) {
+    std::map<uint64_t, Waiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(waiters_mutex_);
+        waiters.swap(waiters_);
+    }
+    for (const auto& [_, waiter] : waiters) {
+        waiter.conn->send(Response{StatusCode::STATUS_ERROR, "", error, waiter.request_id});
+    }
+}
+
+// ==================== Linearizable Reads ====================
+
+void RaftNode::startReadRound() {
+    std::vector<ReadRequest> failed;
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        if (read_batch_) {
+            // A majority that has not answered in an election timeout may
+            // well have chosen another leader
+            auto timeout = std::chrono::milliseconds(state_.getElectionTimeoutMs());
+            if (std::chrono::steady_clock::now() - read_batch_->started < timeout) return;
+            failed = std::move(read_batch_->reads);
+            read_batch_.reset();
+            error = "Leadership not confirmed";
+        } else if (reads_.empty()) {
+            return;
+        } else if (state_.getRole() != RaftRole::RAFT_LEADER) {
+            failed.swap(reads_);
+            error = "Not leader. Leader: " + state_.getLeaderId();
+        } else {
+            // Until an entry of this term commits, the commit index may be
+            // behind what an earlier leader committed
+            uint64_t commit_index = state_.volatile_state().commit_index;
+            if (log_.termAt(commit_index) != leader_term_) return;
+            
+            read_batch_ = ReadBatch{read_round_ + 1, commit_index, std::chrono::steady_clock::now(),
+                                    std::move(reads_)};
+            reads_.clear();
+            read_round_++;
+        }
+    }
     
-    while (state_.volatile_state().last_applied < state_.volatile_state().commit_index) {
-        state_.volatile_state().last_applied++;
-        uint64_t idx = state_.volatile_state().last_applied;
+    if (!failed.empty()) {
+        for (const auto& read : failed) {
+            read.conn->send(Response{StatusCode::STATUS_ERROR, "", error, RequestView::parse(read.data).id});
+        }
+        return;
+    }
+    
+    // Every replicator sends an AppendEntries, even with nothing new; without
+    // peers this node is the majority
+    if (peers_.empty()) {
+        std::lock_guard<std::mutex> lock(leader_mutex_);
+        confirmReads();
+    }
+    wakeReplicators();
+}
+
+void RaftNode::confirmReads() {
+    // Called with leader_mutex_ held.
+    std::lock_guard<std::mutex> lock(raft_mutex_);
+    if (!read_batch_) return;
+    
+    size_t acks = 1;  // This node
+    for (const auto& peer : peers_) {
+        if (peer->read_ack >= read_batch_->round) acks++;
+    }
+    if (acks < (peers_.size() + 1) / 2 + 1) return;
+    
+    confirmed_reads_.push_back(std::move(*read_batch_));
+    read_batch_.reset();
+    read_work_ = true;
+    raft_cv_.notify_one();
+}
+
+void RaftNode::serveReads() {
+    std::vector<ReadRequest> ready;
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        uint64_t last_applied = state_.volatile_state().last_applied;
+        while (!confirmed_reads_.empty() && confirmed_reads_.front().read_index <= last_applied) {
+            auto& reads = confirmed_reads_.front().reads;
+            std::move(reads.begin(), reads.end(), std::back_inserter(ready));
+            confirmed_reads_.pop_front();
+        }
+    }
+    
+    // The store only moves forward, so it is at least this far along
+    for (const auto& read : ready) {
+        RequestView req = RequestView::parse(read.data);
+        Response resp = processClientRequest(req);
+        resp.id = req.id;
+        read.conn->send(resp);
+    }
+}
+
+void RaftNode::failReads(const std::string& error) {
+    std::vector<ReadRequest> reads;
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        reads.swap(reads_);
+        if (read_batch_) {
+            std::move(read_batch_->reads.begin(), read_batch_->reads.end(), std::back_inserter(reads));
+            read_batch_.reset();
+        }
+    }
+    for (const auto& read : reads) {
+        read.conn->send(Response{StatusCode::STATUS_ERROR, "", error, RequestView::parse(read.data).id});
+    }
+}
+
+// ==================== Snapshots ====================
+
+std::shared_ptr<RaftSnapshot> RaftNode::currentSnapshot() const {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    return snapshot_;
+}
+
+void RaftNode::recoverSnapshot() {
+    // Called from the constructor, before any thread runs
+    snapshot_ = RaftSnapshot::loadLatest(data_dir_);
+    if (!snapshot_) return;
+    
+    // Received before a restart, but the store was never restored from it
+    if (snapshot_->pendingInstall()) {
+        store_->restore(snapshot_->dir());
+        snapshot_->markInstalled();
+    }
+    
+    uint64_t index = snapshot_->lastIndex();
+    uint64_t term = snapshot_->lastTerm();
+    uint64_t first = log_.firstIndex();
+    if (first > index) {
+        log_.compact(index, term);
+    } else if (log_.termAt(index) != term) {
+        // An install stopped before the log was made to agree with it
+        log_.truncateFrom(first);
+        log_.compact(index, term);
+    } else if (first > 1) {
+        // The term before the first entry on disk is not recorded; give up
+        // that entry so the one before the log is known again
+        log_.compact(first, log_.termAt(first));
+    }
+    
+    // The store is the snapshot plus whatever was applied after it
+    auto& volatile_state = state_.volatile_state();
+    volatile_state.commit_index = index;
+    volatile_state.last_applied = index;
+    std::cout << "[RAFT] Recovered snapshot at index " << index << " (term " << term << ")" << std::endl;
+}
+
+void RaftNode::maybeSnapshot() {
+    if (options_.snapshot_entries == 0) return;
+    
+    std::lock_guard<std::mutex> apply_lock(apply_mutex_);
+    uint64_t applied = state_.volatile_state().last_applied;
+    auto previous = currentSnapshot();
+    if (applied - (previous ? previous->lastIndex() : 0) < options_.snapshot_entries) return;
+    
+    std::shared_ptr<RaftSnapshot> snapshot;
+    try {
+        snapshot = RaftSnapshot::create(data_dir_, *store_, applied, log_.termAt(applied));
+    } catch (const std::exception& e) {
+        std::cerr << "[RAFT] Snapshot at index " << applied << " failed: " << e.what() << std::endl;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        snapshot_ = snapshot;
+    }
+    if (previous) {
+        previous->markObsolete();
+    }
+    
+    // Keep a tail, so a follower only a little behind still catches up from the log
+    if (applied > options_.snapshot_trailing_entries) {
+        uint64_t index = applied - options_.snapshot_trailing_entries;
+        std::lock_guard<std::mutex> log_lock(log_mutex_);
+        log_.compact(index, log_.termAt(index));
+    }
+    std::cout << "[RAFT] Snapshot at index " << applied << ", log starts at "
+              << log_.firstIndex() << std::endl;
+}
+
+bool RaftNode::needsSnapshot(PeerInfo& peer) {
+    std::lock_guard<std::mutex> lock(leader_mutex_);
+    return state_.getRole() == RaftRole::RAFT_LEADER &&
+           state_.leader_state().next_index[peer.id] < log_.firstIndex();
+}
+
+bool RaftNode::sendSnapshotToPeer(PeerInfo& peer) {
+    // Chunks go one at a time: a follower takes them only in order, and a
+    // failure anywhere starts the transfer over
+    auto snapshot = currentSnapshot();
+    if (!snapshot) return false;
+    
+    uint64_t term = leader_term_;
+    std::cout << "[RAFT] Sending snapshot at index " << snapshot->lastIndex() << " to " << peer.id << std::endl;
+    
+    auto files = snapshot->files();
+    std::vector<char> buffer(options_.snapshot_chunk_bytes);
+    uint32_t next_id = 1;
+    for (size_t f = 0; f < files.size(); f++) {
+        std::string path = snapshot->dir() + "/" + files[f];
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        uint64_t size = std::filesystem::file_size(path);
         
-        if (idx < log_.size()) {
-            const auto& entry = log_[idx];
-            if (entry.op == OpCode::OP_PUT) {
-                store_->put(entry.key, entry.value);
-            } else if (entry.op == OpCode::OP_DELETE) {
-                store_->del(entry.key);
+        uint64_t offset = 0;
+        do {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(buffer.size(), size - offset));
+            if (!in.read(buffer.data(), n)) return false;
+            
+            InstallSnapshot is;
+            is.term = term;
+            is.leader_id = state_.getNodeId();
+            is.last_included_index = snapshot->lastIndex();
+            is.last_included_term = snapshot->lastTerm();
+            is.file = files[f];
+            is.offset = offset;
+            is.data.assign(buffer.data(), n);
+            is.done = f + 1 == files.size() && offset + n == size;
+            auto is_data = is.serialize();
+            
+            Request req;
+            req.id = next_id++;
+            req.op = OpCode::OP_INSTALL_SNAPSHOT;
+            req.value = std::string(is_data.begin(), is_data.end());
+            if (!sendFrame(peer.socket, encodeFrame(req))) {
+                disconnectPeer(peer);
+                return false;
+            }
+            
+            auto resp_data = recvRawMessage(peer.socket);
+            if (resp_data.empty()) {
+                disconnectPeer(peer);
+                return false;
+            }
+            Request reply = Request::deserialize(resp_data);
+            if (reply.op != OpCode::OP_INSTALL_SNAPSHOT_RESP || reply.id != req.id) {
+                disconnectPeer(peer);
+                return false;
+            }
+            auto isr = InstallSnapshotResponse::deserialize(reply.value);
+            if (isr.term > state_.getCurrentTerm()) {
+                becomeFollower(isr.term);
+                return false;
+            }
+            if (!isr.success || state_.getRole() != RaftRole::RAFT_LEADER || leader_term_ != term) {
+                return false;
             }
+            offset += n;
+        } while (offset < size);
+    }
+    
+    // The follower now holds everything up to the snapshot
+    std::lock_guard<std::mutex> lock(leader_mutex_);
+    if (state_.getRole() != RaftRole::RAFT_LEADER || leader_term_ != term) return false;
+    auto& leader = state_.leader_state();
+    if (snapshot->lastIndex() > leader.match_index[peer.id]) {
+        leader.match_index[peer.id] = snapshot->lastIndex();
+        advanceCommitIndex();
+    }
+    leader.next_index[peer.id] = std::max(leader.next_index[peer.id], snapshot->lastIndex() + 1);
+    peer.probing = true;
+    return true;
+}
+
+InstallSnapshotResponse RaftNode::handleInstallSnapshot(const InstallSnapshot& is) {
+    InstallSnapshotResponse resp;
+    resp.term = state_.getCurrentTerm();
+    resp.success = false;
+    
+    if (is.term < state_.getCurrentTerm()) {
+        return resp;
+    }
+    
+    // Same leader recognition as AppendEntries
+    state_.resetElectionTimeout();
+    if (state_.getRole() != RaftRole::RAFT_FOLLOWER) {
+        becomeFollower(is.term);
+    } else if (is.term > state_.getCurrentTerm()) {
+        state_.setCurrentTerm(is.term);
+    }
+    state_.setLeaderId(is.leader_id);
+    resp.term = state_.getCurrentTerm();
+    
+    std::lock_guard<std::mutex> lock(incoming_mutex_);
+    
+    // Already applied or received this far; nothing to install
+    uint64_t pending_index = 0;
+    {
+        std::lock_guard<std::mutex> raft_lock(raft_mutex_);
+        if (pending_install_) pending_index = pending_install_->lastIndex();
+    }
+    if (is.last_included_index <= std::max<uint64_t>(state_.volatile_state().commit_index, pending_index)) {
+        resp.success = true;
+        return resp;
+    }
+    
+    // File names come from the leader; keep them inside the snapshot directory
+    if (is.file.empty() || is.file == "." || is.file == ".." ||
+        is.file.find_first_of("/\\") != std::string::npos) {
+        return resp;
+    }
+    
+    std::string dir = RaftSnapshot::incomingDir(data_dir_, is.last_included_index);
+    if (incoming_snapshot_ != is.last_included_index) {
+        if (is.offset != 0) {
+            return resp;  // Not the start of a transfer
         }
+        if (incoming_snapshot_ != 0) {
+            std::filesystem::remove_all(RaftSnapshot::incomingDir(data_dir_, incoming_snapshot_));
+        }
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        incoming_snapshot_ = is.last_included_index;
+    }
+    
+    // Chunks of a file arrive in order; a transfer that starts over rewrites it
+    std::string path = dir + "/" + is.file;
+    if (is.offset != 0) {
+        std::error_code ec;
+        if (std::filesystem::file_size(path, ec) != is.offset || ec) {
+            return resp;
+        }
+    }
+    {
+        std::ofstream out(path, std::ios::binary | (is.offset == 0 ? std::ios::trunc : std::ios::app));
+        out.write(is.data.data(), static_cast<std::streamsize>(is.data.size()));
+        if (!out) {
+            return resp;
+        }
+    }
+    
+    if (is.done) {
+        // Durable once install() returns; restoring the store can wait on
+        // flushes and compactions, so the raft thread does that, not this reactor
+        incoming_snapshot_ = 0;
+        auto snapshot = RaftSnapshot::install(data_dir_, is.last_included_index, is.last_included_term);
+        {
+            std::lock_guard<std::mutex> raft_lock(raft_mutex_);
+            pending_install_ = std::move(snapshot);
+        }
+        raft_cv_.notify_one();
+    }
+    resp.success = true;
+    return resp;
+}
+
+void RaftNode::installPendingSnapshot() {
+    // Left in place until done, so the same snapshot is not taken again meanwhile
+    std::shared_ptr<RaftSnapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        snapshot = pending_install_;
+    }
+    if (!snapshot) return;
+    
+    try {
+        installSnapshot(snapshot);
+    } catch (const std::exception& e) {
+        // Still marked, so the next restart tries again
+        std::cerr << "[RAFT] Installing snapshot at index " << snapshot->lastIndex()
+                  << " failed: " << e.what() << std::endl;
+    }
+    
+    std::lock_guard<std::mutex> lock(raft_mutex_);
+    if (pending_install_ == snapshot) {
+        pending_install_.reset();
     }
 }
 
+void RaftNode::installSnapshot(const std::shared_ptr<RaftSnapshot>& snapshot) {
+    uint64_t index = snapshot->lastIndex();
+    uint64_t term = snapshot->lastTerm();
+    {
+        std::lock_guard<std::mutex> apply_lock(apply_mutex_);
+        store_->restore(snapshot->dir());
+        {
+            // Entries after the snapshot stay only if the log agrees with it
+            std::lock_guard<std::mutex> log_lock(log_mutex_);
+            if (log_.termAt(index) != term) {
+                log_.truncateFrom(log_.firstIndex());
+            }
+            log_.compact(index, term);
+            if (state_.volatile_state().commit_index < index) {
+                state_.volatile_state().commit_index = index;
+            }
+        }
+        state_.volatile_state().last_applied = index;
+        snapshot->markInstalled();
+    }
+    
+    std::shared_ptr<RaftSnapshot> previous;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        previous = std::move(snapshot_);
+        snapshot_ = snapshot;
+    }
+    if (previous) {
+        previous->markObsolete();
+    }
+    std::cout << "[RAFT] Installed snapshot at index " << index << " (term " << term << ")" << std::endl;
+}
+
 // ==================== State Transitions ====================
 
 void RaftNode::becomeFollower(uint64_t term) {
     std::cout << "[RAFT] Becoming FOLLOWER for term " << term << std::endl;
+    bool was_leader = state_.getRole() == RaftRole::RAFT_LEADER;
     state_.setCurrentTerm(term);
     state_.setRole(RaftRole::RAFT_FOLLOWER);
     state_.resetElectionTimeout();
+    
+    // Pending writes may still commit under the next leader, or be
+    // overwritten; this node can no longer tell which
+    if (was_leader) {
+        failWaiters("Leadership lost; write may or may not have been applied");
+        failReads("Leadership lost");
+    }
 }
 
 void RaftNode::becomeCandidate() {
@@ -683,19 +1333,32 @@ void RaftNode::becomeCandidate() {
 
 void RaftNode::becomeLeader() {
     std::cout << "[RAFT] Becoming LEADER for term " << state_.getCurrentTerm() << std::endl;
-    state_.setRole(RaftRole::RAFT_LEADER);
-    state_.setLeaderId(state_.getNodeId());
     
-    // Initialize leader state
+    // Initialize leader state before the replicators can see the new role
     std::vector<std::string> peer_ids;
     for (const auto& p : peers_) {
-        peer_ids.push_back(p.id);
+        peer_ids.push_back(p->id);
+    }
+    {
+        std::lock_guard<std::mutex> lock(leader_mutex_);
+        leader_term_ = state_.getCurrentTerm();
+        state_.leader_state().reinitialize(peer_ids, getLastLogIndex());
+        for (auto& peer : peers_) {
+            peer->probing = true;
+        }
+    }
+    state_.setRole(RaftRole::RAFT_LEADER);
+    state_.setLeaderId(state_.getNodeId());
+    
+    // Entries of earlier terms only commit behind one of this term, and reads
+    // wait until they have; a no-op gets there without waiting for a write
+    {
+        std::lock_guard<std::mutex> lock(raft_mutex_);
+        proposals_.push_back(Proposal{nullptr, 0, RaftLogEntry{0, 0, OpCode::OP_PING, "", ""}});
     }
-    state_.leader_state().reinitialize(peer_ids, getLastLogIndex());
     
-    // Send initial heartbeats
-    sendHeartbeats();
-    state_.resetHeartbeatTimer();
+    // Replicators send the initial heartbeats
+    wakeReplicators();
 }
 
 // ==================== Network Helpers ====================
@@ -742,13 +1405,8 @@ void RaftNode::disconnectPeer(PeerInfo& peer) {
     peer.connected = false;
 }
 
-bool RaftNode::sendRawMessage(SocketType sock, const std::vector<uint8_t>& data) {
-    uint32_t len = static_cast<uint32_t>(data.size());
-    
-    if (send(sock, reinterpret_cast<const char*>(&len), 4, 0) != 4) {
-        return false;
-    }
-    
+bool RaftNode::sendFrame(SocketType sock, const std::vector<uint8_t>& data) {
+    // Header and body are one buffer, so this is usually a single send
     size_t sent = 0;
     while (sent < data.size()) {
         int n = send(sock, reinterpret_cast<const char*>(data.data() + sent),
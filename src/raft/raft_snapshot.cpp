@@ -0,0 +1,132 @@
+#include "raft/raft_snapshot.hpp"
+#include "storage/file_sync.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace dkv {
+
+namespace {
+
+const char* const SNAPSHOT_PREFIX = "snapshot-";
+const char* const INSTALL_MARKER = "INSTALL";
+
+std::string snapshotDir(const std::string& data_dir, uint64_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu", static_cast<unsigned long long>(index));
+    return data_dir + "/" + SNAPSHOT_PREFIX + name;
+}
+
+} // namespace
+
+RaftSnapshot::RaftSnapshot(std::string dir, uint64_t last_index, uint64_t last_term, bool pending_install)
+    : dir_(std::move(dir)), last_index_(last_index), last_term_(last_term),
+      pending_install_(pending_install) {}
+
+RaftSnapshot::~RaftSnapshot() {
+    if (obsolete_) {
+        std::error_code ec;
+        std::filesystem::remove_all(dir_, ec);
+    }
+}
+
+std::shared_ptr<RaftSnapshot> RaftSnapshot::create(const std::string& data_dir, LSMTree& store,
+                                                   uint64_t index, uint64_t term) {
+    std::string tmp = snapshotDir(data_dir, index) + ".tmp";
+    std::filesystem::remove_all(tmp);
+    store.checkpoint(tmp);
+    return finish(data_dir, tmp, index, term, false);
+}
+
+std::string RaftSnapshot::incomingDir(const std::string& data_dir, uint64_t index) {
+    return snapshotDir(data_dir, index) + ".incoming";
+}
+
+std::shared_ptr<RaftSnapshot> RaftSnapshot::install(const std::string& data_dir,
+                                                    uint64_t index, uint64_t term) {
+    return finish(data_dir, incomingDir(data_dir, index), index, term, true);
+}
+
+std::shared_ptr<RaftSnapshot> RaftSnapshot::finish(const std::string& data_dir, const std::string& from,
+                                                   uint64_t index, uint64_t term, bool received) {
+    {
+        std::ofstream meta(from + "/META", std::ios::trunc);
+        meta << index << " " << term << "\n";
+        if (!meta) {
+            throw std::runtime_error("Failed to write snapshot META in " + from);
+        }
+    }
+
+    // A snapshot has to survive power loss before anything relies on it: the
+    // log below it is compacted away, and the leader counts a received one
+    // as stored once we answer, before the store is restored from it
+    if (received) {
+        std::ofstream(from + "/" + INSTALL_MARKER, std::ios::trunc);
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(from)) {
+        syncPath(entry.path().string());
+    }
+    syncPath(from);
+
+    std::string dir = snapshotDir(data_dir, index);
+    std::filesystem::remove_all(dir);
+    std::filesystem::rename(from, dir);
+    syncPath(data_dir);
+    return std::make_shared<RaftSnapshot>(dir, index, term, received);
+}
+
+std::shared_ptr<RaftSnapshot> RaftSnapshot::loadLatest(const std::string& data_dir) {
+    std::vector<std::string> candidates;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(data_dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_directory() && name.rfind(SNAPSHOT_PREFIX, 0) == 0) {
+            candidates.push_back(entry.path().string());
+        }
+    }
+    // Zero-padded indexes sort numerically, so the newest is last
+    std::sort(candidates.begin(), candidates.end());
+
+    std::shared_ptr<RaftSnapshot> latest;
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+        uint64_t index = 0;
+        uint64_t term = 0;
+        // .tmp and .incoming directories were never finished
+        bool complete = std::filesystem::path(*it).filename().string().find('.') == std::string::npos;
+        if (complete) {
+            std::ifstream meta(*it + "/META");
+            complete = static_cast<bool>(meta >> index >> term);
+        }
+        if (!latest && complete) {
+            bool pending = std::filesystem::exists(*it + "/" + INSTALL_MARKER);
+            latest = std::make_shared<RaftSnapshot>(*it, index, term, pending);
+        } else {
+            std::filesystem::remove_all(*it, ec);
+        }
+    }
+    return latest;
+}
+
+void RaftSnapshot::markInstalled() {
+    std::filesystem::remove(dir_ + "/" + INSTALL_MARKER);
+    pending_install_ = false;
+}
+
+std::vector<std::string> RaftSnapshot::files() const {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+        std::string name = entry.path().filename().string();
+        if (name != "META" && name != "MANIFEST" && name != INSTALL_MARKER) {
+            files.push_back(name);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    // MANIFEST names the others, so it goes last
+    files.push_back("MANIFEST");
+    return files;
+}
+
+} // namespace dkv
@@ -1,11 +1,25 @@
 #include "replication/replica_node.hpp"
+#include "network/server.hpp"
 #include <iostream>
 #include <cstring>
 #include <sstream>
 #include <random>
 
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
 namespace dkv {
 
+// True if sock has data that can be read without blocking
+static bool hasPendingData(SocketType sock) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    timeval timeout{0, 0};
+    return select(static_cast<int>(sock) + 1, &fds, nullptr, nullptr, &timeout) > 0;
+}
+
 // Generate a random node ID
 static std::string generateNodeId() {
     static std::random_device rd;
@@ -21,7 +35,10 @@ static std::string generateNodeId() {
 }
 
 ReplicaNode::ReplicaNode(const std::string& data_dir, uint16_t port, NodeRole role)
-    : port_(port), data_dir_(data_dir), role_(role) {
+    : port_(port), data_dir_(data_dir), role_(role),
+      events_(port, [this](const std::shared_ptr<Connection>& conn, std::string_view data) {
+          handleMessage(conn, data);
+      }) {
     
 #ifdef _WIN32
     WSADATA wsaData;
@@ -55,44 +72,12 @@ void ReplicaNode::start() {
     if (running_) return;
     running_ = true;
     
-    // Create server socket
-    server_sock_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_sock_ == INVALID_SOCK) {
-        throw std::runtime_error("Failed to create socket");
-    }
-    
-    // Allow port reuse
-    int opt = 1;
-#ifdef _WIN32
-    setsockopt(server_sock_, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
-#else
-    setsockopt(server_sock_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-#endif
-    
-    // Bind
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port_);
-    
-    if (bind(server_sock_, (sockaddr*)&addr, sizeof(addr)) < 0) {
-        CLOSE_SOCKET(server_sock_);
-        throw std::runtime_error("Failed to bind to port " + std::to_string(port_));
-    }
-    
-    // Listen
-    if (listen(server_sock_, 10) < 0) {
-        CLOSE_SOCKET(server_sock_);
-        throw std::runtime_error("Failed to listen");
-    }
+    events_.start();
     
     std::string role_str = (role_ == NodeRole::LEADER) ? "LEADER" : 
                            (role_ == NodeRole::FOLLOWER) ? "FOLLOWER" : "STANDALONE";
     std::cout << "[" << role_str << "] Listening on port " << port_ << std::endl;
     
-    // Start accept thread
-    accept_thread_ = std::thread(&ReplicaNode::acceptLoop, this);
-    
     // Start role-specific threads
     if (role_ == NodeRole::FOLLOWER) {
         follower_thread_ = std::thread(&ReplicaNode::followerLoop, this);
@@ -105,12 +90,6 @@ void ReplicaNode::stop() {
     if (!running_) return;
     running_ = false;
     
-    // Close server socket to unblock accept
-    if (server_sock_ != INVALID_SOCK) {
-        CLOSE_SOCKET(server_sock_);
-        server_sock_ = INVALID_SOCK;
-    }
-    
     // Close leader connection (if follower)
     if (leader_sock_ != INVALID_SOCK) {
         CLOSE_SOCKET(leader_sock_);
@@ -121,25 +100,16 @@ void ReplicaNode::stop() {
     {
         std::lock_guard<std::mutex> lock(followers_mutex_);
         for (auto& [id, follower] : followers_) {
-            if (follower.socket != INVALID_SOCK) {
-                CLOSE_SOCKET(follower.socket);
-            }
+            follower.conn->close();
         }
         followers_.clear();
     }
     
     // Join threads
-    if (accept_thread_.joinable()) accept_thread_.join();
     if (follower_thread_.joinable()) follower_thread_.join();
     if (heartbeat_thread_.joinable()) heartbeat_thread_.join();
     
-    {
-        std::lock_guard<std::mutex> lock(threads_mutex_);
-        for (auto& t : client_threads_) {
-            if (t.joinable()) t.join();
-        }
-        client_threads_.clear();
-    }
+    events_.stop();
 }
 
 uint64_t ReplicaNode::getLastSequence() const {
@@ -165,55 +135,35 @@ std::vector<std::string> ReplicaNode::getFollowerIds() const {
 
 // ==================== Server Functionality ====================
 
-void ReplicaNode::acceptLoop() {
-    while (running_) {
-        sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
+void ReplicaNode::handleMessage(const std::shared_ptr<Connection>& conn, std::string_view data) {
+    uint32_t id = 0;
+    try {
+        RequestView req = RequestView::parse(data);
+        id = req.id;
         
-        SocketType client_sock = accept(server_sock_, (sockaddr*)&client_addr, &addr_len);
-        if (client_sock == INVALID_SOCK) {
-            if (running_) {
-                std::cerr << "Accept failed" << std::endl;
-            }
-            continue;
+        // Handle special replication requests
+        if (req.op == OpCode::OP_JOIN_CLUSTER && role_ == NodeRole::LEADER) {
+            handleFollowerJoin(conn, req);
+            return;
         }
         
-        // Spawn thread to handle client
-        std::lock_guard<std::mutex> lock(threads_mutex_);
-        client_threads_.emplace_back(&ReplicaNode::handleClient, this, client_sock);
-    }
-}
-
-void ReplicaNode::handleClient(SocketType client_sock) {
-    while (running_) {
-        std::vector<uint8_t> data = recvMessage(client_sock);
-        if (data.empty()) break;
-        
-        try {
-            Request req = Request::deserialize(data);
-            
-            // Handle special replication requests
-            if (req.op == OpCode::OP_JOIN_CLUSTER && role_ == NodeRole::LEADER) {
-                handleFollowerJoin(client_sock, req);
-                continue;
-            }
-            
-            Response resp = processRequest(req);
-            std::vector<uint8_t> resp_data = resp.serialize();
-            
-            if (!sendMessage(client_sock, resp_data)) {
-                break;
-            }
-        } catch (const std::exception& e) {
-            Response resp{StatusCode::STATUS_ERROR, "", e.what()};
-            sendMessage(client_sock, resp.serialize());
+        if (req.op == OpCode::OP_SCAN) {
+            streamScan(*store_, req, [&](const Response& resp) {
+                return conn->send(resp);
+            });
+            return;
         }
+        
+        Response resp = processRequest(req);
+        resp.id = req.id;
+        conn->send(resp);
+    } catch (const std::exception& e) {
+        Response resp{StatusCode::STATUS_ERROR, "", e.what(), id};
+        conn->send(resp);
     }
-    
-    CLOSE_SOCKET(client_sock);
 }
 
-Response ReplicaNode::processRequest(const Request& req, bool from_replication) {
+Response ReplicaNode::processRequest(const RequestView& req, bool from_replication) {
     Response resp;
     resp.status = StatusCode::STATUS_OK;
     
@@ -227,8 +177,8 @@ Response ReplicaNode::processRequest(const Request& req, bool from_replication)
                 ReplicationEntry entry;
                 entry.sequence_num = seq;
                 entry.op = OpCode::OP_PUT;
-                entry.key = req.key;
-                entry.value = req.value;
+                entry.key = std::string(req.key);
+                entry.value = std::string(req.value);
                 entry.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::system_clock::now().time_since_epoch()
                 ).count();
@@ -241,7 +191,7 @@ Response ReplicaNode::processRequest(const Request& req, bool from_replication)
         }
         
         case OpCode::OP_GET: {
-            auto value = store_->get(req.key);
+            auto value = store_->get(std::string(req.key));
             if (value) {
                 resp.value = *value;
             } else {
@@ -258,7 +208,7 @@ Response ReplicaNode::processRequest(const Request& req, bool from_replication)
                 ReplicationEntry entry;
                 entry.sequence_num = seq;
                 entry.op = OpCode::OP_DELETE;
-                entry.key = req.key;
+                entry.key = std::string(req.key);
                 entry.value = "";
                 entry.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::system_clock::now().time_since_epoch()
@@ -271,6 +221,9 @@ Response ReplicaNode::processRequest(const Request& req, bool from_replication)
             break;
         }
         
+        case OpCode::OP_MGET:
+            return serveMultiGet(*store_, req);
+        
         case OpCode::OP_PING:
             resp.value = "PONG";
             break;
@@ -299,6 +252,7 @@ Response ReplicaNode::buildStatusResponse() const {
     }
     ss << "\n";
     ss << "sequence:" << getLastSequence() << "\n";
+    ss << "connections:" << events_.connectionCount() << "\n";
     
     if (role_ == NodeRole::LEADER) {
         ss << "followers:" << getFollowerCount() << "\n";
@@ -310,6 +264,7 @@ Response ReplicaNode::buildStatusResponse() const {
         ss << "leader:" << leader_host_ << ":" << leader_port_ << "\n";
         ss << "connected:" << (leader_sock_ != INVALID_SOCK ? "yes" : "no") << "\n";
     }
+    ss << store_->stats().toString();
     
     resp.value = ss.str();
     return resp;
@@ -339,29 +294,30 @@ void ReplicaNode::replicateToFollowers(const ReplicationEntry& entry) {
     }
 }
 
-void ReplicaNode::handleFollowerJoin(SocketType sock, const Request& req) {
-    std::string node_id = req.key.empty() ? generateNodeId() : req.key;
+void ReplicaNode::handleFollowerJoin(const std::shared_ptr<Connection>& conn, const RequestView& req) {
+    std::string node_id = req.key.empty() ? generateNodeId() : std::string(req.key);
     
     std::cout << "[LEADER] Follower joining: " << node_id << std::endl;
     
     // Parse requested sequence number from value
     uint64_t requested_seq = 0;
     if (!req.value.empty()) {
-        requested_seq = std::stoull(req.value);
+        requested_seq = std::stoull(std::string(req.value));
     }
     
     // Send acknowledgment
     Response resp;
     resp.status = StatusCode::STATUS_OK;
     resp.value = node_id;
-    sendMessage(sock, resp.serialize());
+    resp.id = req.id;
+    conn->send(resp);
     
     // Add to followers
     {
         std::lock_guard<std::mutex> lock(followers_mutex_);
         FollowerInfo info;
         info.node_id = node_id;
-        info.socket = sock;
+        info.conn = conn;
         info.last_acked_seq = requested_seq;
         info.last_heartbeat = std::chrono::steady_clock::now();
         info.connected = true;
@@ -385,8 +341,8 @@ void ReplicaNode::handleFollowerJoin(SocketType sock, const Request& req) {
         }
     }
     
-    // Keep connection open for ongoing replication (handled in separate messages)
-    // The socket stays open in the followers_ map
+    // The connection stays open for ongoing replication; acks and heartbeat
+    // replies arrive through handleMessage like any other request
 }
 
 void ReplicaNode::heartbeatLoop() {
@@ -401,7 +357,7 @@ void ReplicaNode::heartbeatLoop() {
         
         for (auto& [id, follower] : followers_) {
             if (follower.connected) {
-                if (!sendMessage(follower.socket, data)) {
+                if (!follower.conn->send(data)) {
                     std::cout << "[LEADER] Follower disconnected: " << id << std::endl;
                     follower.connected = false;
                 }
@@ -411,7 +367,7 @@ void ReplicaNode::heartbeatLoop() {
 }
 
 void ReplicaNode::sendToFollower(FollowerInfo& follower, const std::vector<uint8_t>& data) {
-    if (!sendMessage(follower.socket, data)) {
+    if (!follower.conn->send(data)) {
         follower.connected = false;
         std::cout << "[LEADER] Failed to send to follower: " << follower.node_id << std::endl;
     }
@@ -420,6 +376,8 @@ void ReplicaNode::sendToFollower(FollowerInfo& follower, const std::vector<uint8
 // ==================== Follower Functionality ====================
 
 void ReplicaNode::followerLoop() {
+    std::vector<uint8_t> next;  // Read ahead while batching, not yet handled
+    
     while (running_) {
         if (leader_sock_ == INVALID_SOCK) {
             connectToLeader();
@@ -431,7 +389,8 @@ void ReplicaNode::followerLoop() {
         }
         
         // Receive messages from leader
-        std::vector<uint8_t> data = recvMessage(leader_sock_);
+        std::vector<uint8_t> data = next.empty() ? recvMessage(leader_sock_) : std::move(next);
+        next.clear();
         if (data.empty()) {
             std::cout << "[FOLLOWER] Lost connection to leader" << std::endl;
             CLOSE_SOCKET(leader_sock_);
@@ -443,21 +402,37 @@ void ReplicaNode::followerLoop() {
             Request req = Request::deserialize(data);
             
             if (req.op == OpCode::OP_REPLICATE) {
-                // Deserialize replication entry from req.value
-                std::vector<uint8_t> entry_data(req.value.begin(), req.value.end());
-                ReplicationEntry entry = ReplicationEntry::deserialize(entry_data);
-                handleReplication(entry);
+                // Deserialize replication entry from req.value, along with
+                // any others already waiting, so they are applied in one write
+                std::vector<ReplicationEntry> entries;
+                entries.push_back(ReplicationEntry::deserialize(
+                    std::vector<uint8_t>(req.value.begin(), req.value.end())));
+                
+                while (entries.size() < MAX_APPLY_BATCH && hasPendingData(leader_sock_)) {
+                    data = recvMessage(leader_sock_);
+                    if (data.empty()) {
+                        break;  // The next receive notices the lost connection
+                    }
+                    Request more = Request::deserialize(data);
+                    if (more.op != OpCode::OP_REPLICATE) {
+                        next = std::move(data);
+                        break;
+                    }
+                    entries.push_back(ReplicationEntry::deserialize(
+                        std::vector<uint8_t>(more.value.begin(), more.value.end())));
+                }
+                handleReplication(entries);
                 
-                // Send ack
+                // Send ack for the newest entry applied
                 Request ack;
                 ack.op = OpCode::OP_REPLICATE_ACK;
-                ack.value = std::to_string(entry.sequence_num);
-                sendMessage(leader_sock_, ack.serialize());
+                ack.value = std::to_string(entries.back().sequence_num);
+                sendFrame(leader_sock_, encodeFrame(ack));
                 
             } else if (req.op == OpCode::OP_HEARTBEAT) {
                 // Respond to heartbeat
                 Response resp{StatusCode::STATUS_OK, "OK", ""};
-                sendMessage(leader_sock_, resp.serialize());
+                sendFrame(leader_sock_, encodeFrame(resp));
             }
         } catch (const std::exception& e) {
             std::cerr << "[FOLLOWER] Error processing message: " << e.what() << std::endl;
@@ -494,30 +469,48 @@ void ReplicaNode::connectToLeader() {
               << leader_host_ << ":" << leader_port_ << std::endl;
 }
 
-void ReplicaNode::handleReplication(const ReplicationEntry& entry) {
+void ReplicaNode::handleReplication(const std::vector<ReplicationEntry>& entries) {
     std::lock_guard<std::mutex> lock(follower_mutex_);
     
-    // Skip if already applied
-    if (entry.sequence_num <= last_applied_seq_) {
-        return;
+    // Skip entries already applied
+    WriteBatch batch;
+    uint64_t first_seq = 0;
+    uint64_t last_seq = last_applied_seq_;
+    for (const auto& entry : entries) {
+        if (entry.sequence_num <= last_seq) {
+            continue;
+        }
+        
+        switch (entry.op) {
+            case OpCode::OP_PUT:
+                batch.put(entry.key, entry.value);
+                break;
+            case OpCode::OP_DELETE:
+                batch.del(entry.key);
+                break;
+            default:
+                break;
+        }
+        if (first_seq == 0) {
+            first_seq = entry.sequence_num;
+        }
+        last_seq = entry.sequence_num;
     }
     
-    // Apply the operation
-    switch (entry.op) {
-        case OpCode::OP_PUT:
-            store_->put(entry.key, entry.value);
-            break;
-        case OpCode::OP_DELETE:
-            store_->del(entry.key);
-            break;
-        default:
-            break;
+    if (last_seq == last_applied_seq_) {
+        return;
     }
     
-    last_applied_seq_ = entry.sequence_num;
-    std::cout << "[FOLLOWER] Applied seq " << entry.sequence_num 
-              << ": " << (entry.op == OpCode::OP_PUT ? "PUT" : "DEL") 
-              << " " << entry.key << std::endl;
+    // Apply the operations
+    store_->write(batch);
+    
+    last_applied_seq_ = last_seq;
+    if (first_seq == last_seq) {
+        std::cout << "[FOLLOWER] Applied seq " << last_seq << std::endl;
+    } else {
+        std::cout << "[FOLLOWER] Applied seq " << first_seq << "-" << last_seq
+                  << " (" << batch.count() << " writes)" << std::endl;
+    }
 }
 
 void ReplicaNode::sendJoinRequest() {
@@ -526,7 +519,7 @@ void ReplicaNode::sendJoinRequest() {
     req.key = generateNodeId();  // Our node ID
     req.value = std::to_string(last_applied_seq_);  // Request entries after this
     
-    sendMessage(leader_sock_, req.serialize());
+    sendFrame(leader_sock_, encodeFrame(req));
     
     // Wait for ack
     auto data = recvMessage(leader_sock_);
@@ -540,15 +533,8 @@ void ReplicaNode::sendJoinRequest() {
 
 // ==================== Network Helpers ====================
 
-bool ReplicaNode::sendMessage(SocketType sock, const std::vector<uint8_t>& data) {
-    uint32_t len = static_cast<uint32_t>(data.size());
-    
-    // Send length
-    if (send(sock, reinterpret_cast<const char*>(&len), 4, 0) != 4) {
-        return false;
-    }
-    
-    // Send data
+bool ReplicaNode::sendFrame(SocketType sock, const std::vector<uint8_t>& data) {
+    // Header and body are one buffer, so this is usually a single send
     size_t sent = 0;
     while (sent < data.size()) {
         int n = send(sock, reinterpret_cast<const char*>(data.data() + sent), 
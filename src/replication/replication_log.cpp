@@ -31,22 +31,23 @@ ReplicationLog::~ReplicationLog() {
     }
 }
 
-uint64_t ReplicationLog::append(OpCode op, const std::string& key, const std::string& value) {
+uint64_t ReplicationLog::append(OpCode op, std::string_view key, std::string_view value) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     ReplicationEntry entry;
     entry.sequence_num = next_seq_++;
     entry.op = op;
-    entry.key = key;
-    entry.value = value;
+    entry.key = std::string(key);
+    entry.value = std::string(value);
     entry.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::system_clock::now().time_since_epoch()
     ).count();
     
-    entries_.push_back(entry);
+    uint64_t seq = entry.sequence_num;
     appendToDisk(entry);
+    entries_.push_back(std::move(entry));
     
-    return entry.sequence_num;
+    return seq;
 }
 
 std::vector<ReplicationEntry> ReplicationLog::getEntriesSince(uint64_t seq_num) const {
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <algorithm>
 #include "raft/raft_node.hpp"
+#include "storage/block_cache.hpp"
 
 dkv::RaftNode* g_node = nullptr;
 
@@ -20,6 +21,7 @@ void printUsage() {
     std::cout << "  -d dir        Data directory (default: ./server_data)\n";
     std::cout << "  --peers LIST  Comma-separated list of all cluster nodes (including self)\n";
     std::cout << "                e.g., 127.0.0.1:9000,127.0.0.1:9001,127.0.0.1:9002\n";
+    std::cout << "  --block-cache MB  SSTable block cache for the process, 0 disables (default: 8)\n";
     std::cout << "  -h, --help    Show this help\n";
     std::cout << "\nExamples:\n";
     std::cout << "  # Start a 3-node Raft cluster:\n";
@@ -53,6 +55,8 @@ int main(int argc, char* argv[]) {
             data_dir = argv[++i];
         } else if (arg == "--peers" && i + 1 < argc) {
             peers = parsePeers(argv[++i]);
+        } else if (arg == "--block-cache" && i + 1 < argc) {
+            dkv::BlockCache::global().setCapacity(std::stoull(argv[++i]) * 1024 * 1024);
         } else if (arg == "-h" || arg == "--help") {
             printUsage();
             return 0;
@@ -1,10 +1,14 @@
 #include "shard/hash_ring.hpp"
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 
 namespace dkv {
 
 // MurmurHash3 finalizer for 32-bit hash
-static uint32_t murmur3_32(const std::string& key, uint32_t seed = 0) {
+static uint32_t murmur3_32(std::string_view key, uint32_t seed = 0) {
     const uint8_t* data = reinterpret_cast<const uint8_t*>(key.data());
     const int len = static_cast<int>(key.size());
     const int nblocks = len / 4;
@@ -14,9 +18,9 @@ static uint32_t murmur3_32(const std::string& key, uint32_t seed = 0) {
     const uint32_t c2 = 0x1b873593;
     
     // Body
-    const uint32_t* blocks = reinterpret_cast<const uint32_t*>(data);
     for (int i = 0; i < nblocks; i++) {
-        uint32_t k1 = blocks[i];
+        uint32_t k1;
+        std::memcpy(&k1, data + i * 4, sizeof(k1));  // Keys need not be aligned
         
         k1 *= c1;
         k1 = (k1 << 15) | (k1 >> 17);
@@ -52,85 +56,114 @@ static uint32_t murmur3_32(const std::string& key, uint32_t seed = 0) {
     return h1;
 }
 
+// ==================== Snapshot ====================
+
+size_t HashRing::Snapshot::ownerIndex(uint32_t pos) const {
+    // Branch-free lower_bound: the loop has a fixed trip count for a given
+    // size and the comparison compiles to a conditional move
+    const uint32_t* base = positions.data();
+    size_t n = positions.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        base = (base[half] < pos) ? base + half : base;
+        n -= half;
+    }
+    size_t idx = static_cast<size_t>(base - positions.data()) + (*base < pos);
+    
+    // Past the last position: wrap around to the first node
+    return owners[idx == positions.size() ? 0 : idx];
+}
+
+const std::string& HashRing::Snapshot::getNode(std::string_view key) const {
+    static const std::string none;
+    if (positions.empty()) {
+        return none;
+    }
+    return nodes[ownerIndex(murmur3_32(key))];
+}
+
+// ==================== HashRing ====================
+
 HashRing::HashRing(int virtual_nodes) 
-    : virtual_nodes_(virtual_nodes) {}
+    : virtual_nodes_(virtual_nodes), snapshot_(std::make_shared<const Snapshot>()) {}
 
 void HashRing::addNode(const std::string& node_id) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    if (physical_nodes_.count(node_id) > 0) {
+    if (!physical_nodes_.insert(node_id).second) {
         return;  // Already exists
     }
-    
-    physical_nodes_.insert(node_id);
-    
-    // Add virtual nodes
-    for (int i = 0; i < virtual_nodes_; ++i) {
-        std::string vnode_key = virtualNodeKey(node_id, i);
-        uint32_t pos = murmur3_32(vnode_key);
-        ring_[pos] = node_id;
-    }
+    publish();
 }
 
 void HashRing::removeNode(const std::string& node_id) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    if (physical_nodes_.count(node_id) == 0) {
+    if (physical_nodes_.erase(node_id) == 0) {
         return;  // Not found
     }
-    
-    physical_nodes_.erase(node_id);
-    
-    // Remove virtual nodes
-    for (int i = 0; i < virtual_nodes_; ++i) {
-        std::string vnode_key = virtualNodeKey(node_id, i);
-        uint32_t pos = murmur3_32(vnode_key);
-        ring_.erase(pos);
-    }
+    publish();
 }
 
-std::string HashRing::getNode(const std::string& key) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (ring_.empty()) {
-        return "";
+void HashRing::publish() {
+    if (physical_nodes_.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("HashRing: too many nodes");
+    }
+
+    auto next = std::make_shared<Snapshot>();
+    next->nodes.assign(physical_nodes_.begin(), physical_nodes_.end());
+    
+    std::vector<std::pair<uint32_t, uint16_t>> vnodes;
+    vnodes.reserve(next->nodes.size() * static_cast<size_t>(std::max(virtual_nodes_, 0)));
+    for (size_t n = 0; n < next->nodes.size(); ++n) {
+        for (int i = 0; i < virtual_nodes_; ++i) {
+            vnodes.emplace_back(murmur3_32(virtualNodeKey(next->nodes[n], i)), static_cast<uint16_t>(n));
+        }
     }
     
-    uint32_t pos = murmur3_32(key);
-    
-    // Find first node with position >= key's hash
-    auto it = ring_.lower_bound(pos);
-    
-    // If we went past the end, wrap around to the first node
-    if (it == ring_.end()) {
-        it = ring_.begin();
+    // Two virtual nodes on one position go to the lower node, so routing
+    // doesn't depend on the order nodes were added in
+    std::sort(vnodes.begin(), vnodes.end());
+    next->positions.reserve(vnodes.size());
+    next->owners.reserve(vnodes.size());
+    for (const auto& [pos, owner] : vnodes) {
+        if (!next->positions.empty() && next->positions.back() == pos) {
+            continue;
+        }
+        next->positions.push_back(pos);
+        next->owners.push_back(owner);
     }
     
-    return it->second;
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(next)));
+}
+
+std::shared_ptr<const HashRing::Snapshot> HashRing::snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+std::string HashRing::getNode(const std::string& key) const {
+    return snapshot()->getNode(key);
 }
 
 std::vector<std::string> HashRing::getNodes() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return std::vector<std::string>(physical_nodes_.begin(), physical_nodes_.end());
+    return snapshot()->nodes;
 }
 
 size_t HashRing::size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return physical_nodes_.size();
+    return snapshot()->nodes.size();
 }
 
 bool HashRing::empty() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return physical_nodes_.empty();
+    return snapshot()->nodes.empty();
 }
 
 void HashRing::clear() {
     std::lock_guard<std::mutex> lock(mutex_);
-    ring_.clear();
     physical_nodes_.clear();
+    publish();
 }
 
-uint32_t HashRing::hash(const std::string& key) const {
+uint32_t HashRing::hash(std::string_view key) const {
     return murmur3_32(key);
 }
 
@@ -1,12 +1,94 @@
 #include "shard/sharded_client.hpp"
 #include <iostream>
+#include <stdexcept>
 
 namespace dkv {
 
-ShardedClient::ShardedClient() {}
+namespace {
+
+// Keys of a multi-key request owned by one shard, as indices into the request
+struct ShardBatch {
+    std::string shard;
+    std::shared_ptr<AsyncClient> client;
+    std::vector<size_t> indices;
+};
+
+// Group count keys (key_at(i) for each i) into batches of at most
+// MAX_BATCH_KEYS per shard. Keys with no shard are failed in results.
+template <typename KeyAt>
+std::vector<ShardBatch> groupByShard(const HashRing::Snapshot& ring,
+                                     const std::map<std::string, std::shared_ptr<AsyncClient>>& connections,
+                                     size_t count, KeyAt key_at,
+                                     std::vector<ShardedClient::KeyResult>& results) {
+    std::vector<ShardBatch> batches;
+    std::map<std::string, size_t> open;  // Shard -> batch still taking keys
+
+    for (size_t i = 0; i < count; i++) {
+        const std::string& shard = ring.getNode(key_at(i));
+        auto conn = connections.find(shard);
+        if (conn == connections.end()) {
+            results[i].error = "No shard available";
+            continue;
+        }
+
+        auto it = open.find(shard);
+        if (it == open.end() || batches[it->second].indices.size() >= ShardedClient::MAX_BATCH_KEYS) {
+            open[shard] = batches.size();
+            batches.push_back({shard, conn->second, {}});
+            it = open.find(shard);
+        }
+        batches[it->second].indices.push_back(i);
+    }
+    return batches;
+}
+
+// Send every batch's request before waiting on any reply, then hand each
+// successful reply to finish(batch, resp). A failed reply, or one finish()
+// rejects by throwing, fails all keys of that batch.
+template <typename MakeRequest, typename Finish>
+void scatterGather(const std::vector<ShardBatch>& batches, std::vector<ShardedClient::KeyResult>& results,
+                   MakeRequest make_request, Finish finish) {
+    std::vector<std::future<Response>> replies;
+    replies.reserve(batches.size());
+    for (const auto& batch : batches) {
+        replies.push_back(batch.client->submit(make_request(batch)));
+    }
+
+    for (size_t b = 0; b < batches.size(); b++) {
+        const ShardBatch& batch = batches[b];
+        Response resp = replies[b].get();
+        std::string error;
+        if (resp.status != StatusCode::STATUS_OK) {
+            error = resp.error.empty() ? "Request failed" : resp.error;
+        } else {
+            try {
+                finish(batch, resp);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+        }
+
+        if (!error.empty()) {
+            for (size_t i : batch.indices) {
+                results[i].value.reset();
+                results[i].error = batch.shard + ": " + error;
+            }
+        }
+    }
+}
+
+Request multiRequest(OpCode op, MultiRequest args) {
+    auto payload = args.serialize();
+    return {op, "", std::string(payload.begin(), payload.end())};
+}
+
+} // namespace
+
+ShardedClient::ShardedClient(size_t connections_per_shard)
+    : connections_per_shard_(connections_per_shard) {}
 
 ShardedClient::~ShardedClient() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
     connections_.clear();
 }
 
@@ -33,29 +115,33 @@ bool ShardedClient::addShard(const std::string& shard_addr) {
         return false;
     }
     
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Add to hash ring
-    ring_.addNode(shard_addr);
-    
-    // Create connection
-    auto client = std::make_unique<Client>();
+    // Connect before taking the lock so requests to other shards keep flowing
+    auto client = std::make_shared<AsyncClient>(connections_per_shard_);
     if (!client->connect(host, port)) {
         std::cerr << "[ShardedClient] Failed to connect to shard: " << shard_addr << std::endl;
-        ring_.removeNode(shard_addr);
         return false;
     }
     
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    ring_.addNode(shard_addr);
     connections_[shard_addr] = std::move(client);
     std::cout << "[ShardedClient] Added shard: " << shard_addr << std::endl;
     return true;
 }
 
 void ShardedClient::removeShard(const std::string& shard_addr) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    ring_.removeNode(shard_addr);
-    connections_.erase(shard_addr);
+    std::shared_ptr<AsyncClient> removed;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        ring_.removeNode(shard_addr);
+        auto it = connections_.find(shard_addr);
+        if (it != connections_.end()) {
+            removed = std::move(it->second);
+            connections_.erase(it);
+        }
+    }
+    // The pool closes here, outside the lock, once no request holds it;
+    // anything still outstanding on it completes with an error
 }
 
 bool ShardedClient::initialize(const std::vector<std::string>& shards) {
@@ -67,99 +153,155 @@ bool ShardedClient::initialize(const std::vector<std::string>& shards) {
     return !shards.empty();
 }
 
-Client* ShardedClient::getConnection(const std::string& shard_addr) {
-    // Note: caller must hold mutex_
+std::shared_ptr<AsyncClient> ShardedClient::getConnection(const std::string& shard_addr) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
     auto it = connections_.find(shard_addr);
-    if (it == connections_.end()) {
-        return nullptr;
-    }
-    
-    Client* client = it->second.get();
-    
-    // Check if still connected, reconnect if needed
-    if (!client->isConnected()) {
-        std::string host;
-        uint16_t port;
-        if (parseAddress(shard_addr, host, port)) {
-            client->connect(host, port);
-        }
-    }
-    
-    return client->isConnected() ? client : nullptr;
+    return it == connections_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<AsyncClient> ShardedClient::connectionForKey(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto ring = ring_.snapshot();
+    auto it = connections_.find(ring->getNode(key));
+    return it == connections_.end() ? nullptr : it->second;
 }
 
 bool ShardedClient::put(const std::string& key, const std::string& value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string shard = ring_.getNode(key);
-    if (shard.empty()) {
+    return putAsync(key, value).get();
+}
+
+std::optional<std::string> ShardedClient::get(const std::string& key) {
+    return getAsync(key).get();
+}
+
+bool ShardedClient::del(const std::string& key) {
+    return delAsync(key).get();
+}
+
+std::future<bool> ShardedClient::putAsync(const std::string& key, const std::string& value) {
+    auto client = connectionForKey(key);
+    if (!client) {
         std::cerr << "[ShardedClient] No shards available" << std::endl;
-        return false;
+        std::promise<bool> failed;
+        failed.set_value(false);
+        return failed.get_future();
     }
-    
-    Client* client = getConnection(shard);
+    return client->putAsync(key, value);
+}
+
+std::future<std::optional<std::string>> ShardedClient::getAsync(const std::string& key) {
+    auto client = connectionForKey(key);
     if (!client) {
-        std::cerr << "[ShardedClient] Cannot connect to shard: " << shard << std::endl;
-        return false;
+        std::promise<std::optional<std::string>> failed;
+        failed.set_value(std::nullopt);
+        return failed.get_future();
     }
-    
-    return client->put(key, value);
+    return client->getAsync(key);
 }
 
-std::optional<std::string> ShardedClient::get(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string shard = ring_.getNode(key);
-    if (shard.empty()) {
-        return std::nullopt;
-    }
-    
-    Client* client = getConnection(shard);
+std::future<bool> ShardedClient::delAsync(const std::string& key) {
+    auto client = connectionForKey(key);
     if (!client) {
-        return std::nullopt;
+        std::promise<bool> failed;
+        failed.set_value(false);
+        return failed.get_future();
     }
-    
-    return client->get(key);
+    return client->delAsync(key);
 }
 
-bool ShardedClient::del(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string shard = ring_.getNode(key);
-    if (shard.empty()) {
-        return false;
+std::vector<ShardedClient::KeyResult> ShardedClient::multiGet(const std::vector<std::string>& keys) {
+    std::vector<KeyResult> results(keys.size());
+    std::vector<ShardBatch> batches;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        batches = groupByShard(*ring_.snapshot(), connections_, keys.size(),
+                               [&](size_t i) -> const std::string& { return keys[i]; }, results);
     }
-    
-    Client* client = getConnection(shard);
-    if (!client) {
-        return false;
+
+    scatterGather(batches, results,
+        [&](const ShardBatch& batch) {
+            MultiRequest args;
+            args.keys.reserve(batch.indices.size());
+            for (size_t i : batch.indices) {
+                args.keys.push_back(keys[i]);
+            }
+            return multiRequest(OpCode::OP_MGET, std::move(args));
+        },
+        [&](const ShardBatch& batch, const Response& resp) {
+            auto found = MultiGetResult::deserialize(
+                std::vector<uint8_t>(resp.value.begin(), resp.value.end()));
+            if (found.values.size() != batch.indices.size()) {
+                throw std::runtime_error("Wrong number of values in reply");
+            }
+            for (size_t j = 0; j < batch.indices.size(); j++) {
+                results[batch.indices[j]].value = std::move(found.values[j]);
+            }
+        });
+    return results;
+}
+
+std::vector<ShardedClient::KeyResult> ShardedClient::multiPut(
+    const std::vector<std::pair<std::string, std::string>>& pairs) {
+    std::vector<KeyResult> results(pairs.size());
+    std::vector<ShardBatch> batches;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        batches = groupByShard(*ring_.snapshot(), connections_, pairs.size(),
+                               [&](size_t i) -> const std::string& { return pairs[i].first; }, results);
     }
-    
-    return client->del(key);
+
+    scatterGather(batches, results,
+        [&](const ShardBatch& batch) {
+            MultiRequest args;
+            args.keys.reserve(batch.indices.size());
+            args.values.reserve(batch.indices.size());
+            for (size_t i : batch.indices) {
+                args.keys.push_back(pairs[i].first);
+                args.values.push_back(pairs[i].second);
+            }
+            return multiRequest(OpCode::OP_MPUT, std::move(args));
+        },
+        [](const ShardBatch&, const Response&) {});
+    return results;
 }
 
-bool ShardedClient::ping(const std::string& shard_addr) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    Client* client = getConnection(shard_addr);
-    if (!client) {
-        return false;
+std::vector<ShardedClient::KeyResult> ShardedClient::multiDel(const std::vector<std::string>& keys) {
+    std::vector<KeyResult> results(keys.size());
+    std::vector<ShardBatch> batches;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        batches = groupByShard(*ring_.snapshot(), connections_, keys.size(),
+                               [&](size_t i) -> const std::string& { return keys[i]; }, results);
     }
-    
-    return client->ping();
+
+    scatterGather(batches, results,
+        [&](const ShardBatch& batch) {
+            MultiRequest args;
+            args.keys.reserve(batch.indices.size());
+            for (size_t i : batch.indices) {
+                args.keys.push_back(keys[i]);
+            }
+            return multiRequest(OpCode::OP_MDEL, std::move(args));
+        },
+        [](const ShardBatch&, const Response&) {});
+    return results;
+}
+
+bool ShardedClient::ping(const std::string& shard_addr) {
+    auto client = getConnection(shard_addr);
+    return client && client->ping();
 }
 
 bool ShardedClient::pingAll() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    for (auto& [addr, client] : connections_) {
-        if (!client->isConnected()) {
-            std::string host;
-            uint16_t port;
-            if (parseAddress(addr, host, port)) {
-                client->connect(host, port);
-            }
+    std::vector<std::shared_ptr<AsyncClient>> clients;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& [addr, client] : connections_) {
+            clients.push_back(client);
         }
+    }
+    
+    for (const auto& client : clients) {
         if (!client->ping()) {
             return false;
         }
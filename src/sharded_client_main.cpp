@@ -8,6 +8,8 @@ void printHelp() {
     std::cout << "  put <key> <value>  - Store a key-value pair\n";
     std::cout << "  get <key>          - Retrieve a value\n";
     std::cout << "  del <key>          - Delete a key\n";
+    std::cout << "  mget <key>...      - Retrieve several values, one batch per shard\n";
+    std::cout << "  mput <key> <value>... - Store several pairs, one batch per shard\n";
     std::cout << "  shard <key>        - Show which shard owns a key\n";
     std::cout << "  shards             - List all shards\n";
     std::cout << "  ping               - Ping all shards\n";
@@ -125,6 +127,47 @@ int main(int argc, char* argv[]) {
                     std::cout << "ERROR\n";
                 }
             }
+            else if (cmd == "mget") {
+                std::vector<std::string> keys;
+                for (std::string key; iss >> key;) {
+                    keys.push_back(key);
+                }
+
+                if (keys.empty()) {
+                    std::cout << "Usage: mget <key>...\n";
+                    continue;
+                }
+
+                auto results = client.multiGet(keys);
+                for (size_t i = 0; i < keys.size(); i++) {
+                    if (!results[i].ok()) {
+                        std::cout << keys[i] << " ERROR (" << results[i].error << ")\n";
+                    } else {
+                        std::cout << keys[i] << " = " << (results[i].value ? *results[i].value : "(nil)") << "\n";
+                    }
+                }
+            }
+            else if (cmd == "mput") {
+                std::vector<std::pair<std::string, std::string>> pairs;
+                for (std::string key, value; iss >> key >> value;) {
+                    pairs.emplace_back(key, value);
+                }
+
+                if (pairs.empty()) {
+                    std::cout << "Usage: mput <key> <value>...\n";
+                    continue;
+                }
+
+                auto results = client.multiPut(pairs);
+                size_t failed = 0;
+                for (size_t i = 0; i < pairs.size(); i++) {
+                    if (!results[i].ok()) {
+                        std::cout << pairs[i].first << " ERROR (" << results[i].error << ")\n";
+                        failed++;
+                    }
+                }
+                std::cout << "OK (" << pairs.size() - failed << " of " << pairs.size() << " keys)\n";
+            }
             else if (cmd == "shard") {
                 std::string key;
                 iss >> key;
@@ -0,0 +1,55 @@
+#include "storage/arena.hpp"
+#include <cstdint>
+
+namespace dkv {
+
+char* Arena::allocate(size_t bytes) {
+    usage_.fetch_add(bytes, std::memory_order_relaxed);
+    if (bytes <= remaining_) {
+        char* result = ptr_;
+        ptr_ += bytes;
+        remaining_ -= bytes;
+        return result;
+    }
+    return allocateFallback(bytes);
+}
+
+char* Arena::allocateAligned(size_t bytes) {
+    constexpr size_t align = alignof(std::max_align_t);
+    size_t slop = reinterpret_cast<uintptr_t>(ptr_) % align;
+    size_t padding = slop == 0 ? 0 : align - slop;
+
+    if (bytes + padding <= remaining_) {
+        usage_.fetch_add(bytes + padding, std::memory_order_relaxed);
+        char* result = ptr_ + padding;
+        ptr_ += bytes + padding;
+        remaining_ -= bytes + padding;
+        return result;
+    }
+    // Fresh blocks come from new[] and are already aligned
+    usage_.fetch_add(bytes, std::memory_order_relaxed);
+    return allocateFallback(bytes);
+}
+
+char* Arena::allocateFallback(size_t bytes) {
+    if (bytes > BLOCK_SIZE / 4) {
+        // Large values get their own block so the current one isn't wasted
+        return allocateBlock(bytes);
+    }
+
+    ptr_ = allocateBlock(BLOCK_SIZE);
+    remaining_ = BLOCK_SIZE;
+
+    char* result = ptr_;
+    ptr_ += bytes;
+    remaining_ -= bytes;
+    return result;
+}
+
+char* Arena::allocateBlock(size_t bytes) {
+    // Plain new[]: make_unique would zero memory that is about to be overwritten
+    blocks_.emplace_back(new char[bytes]);
+    return blocks_.back().get();
+}
+
+} // namespace dkv
@@ -0,0 +1,91 @@
+#include "storage/block_cache.hpp"
+
+namespace dkv {
+
+BlockCache& BlockCache::global() {
+    static BlockCache cache(8 * 1024 * 1024);
+    return cache;
+}
+
+BlockCache::BlockCache(size_t capacity) : capacity_(capacity) {}
+
+uint64_t BlockCache::newTableId() {
+    static std::atomic<uint64_t> next_id{1};
+    return next_id++;
+}
+
+BlockCache::Shard& BlockCache::shardFor(const Key& key) {
+    return shards_[KeyHash()(key) % NUM_SHARDS];
+}
+
+BlockCache::Block BlockCache::lookup(uint64_t table_id, uint64_t offset) {
+    Key key{table_id, offset};
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+        misses_++;
+        return nullptr;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    hits_++;
+    return it->second->second;
+}
+
+void BlockCache::insert(uint64_t table_id, uint64_t offset, Block block) {
+    size_t limit = capacity_ / NUM_SHARDS;
+    if (!block || block->size() > limit) {
+        return;
+    }
+
+    Key key{table_id, offset};
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        // Another reader loaded the same block first
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.emplace_front(key, std::move(block));
+    shard.map[key] = shard.lru.begin();
+    shard.usage += shard.lru.front().second->size();
+
+    evict(shard, limit);
+}
+
+void BlockCache::evict(Shard& shard, size_t limit) {
+    while (shard.usage > limit && !shard.lru.empty()) {
+        auto& victim = shard.lru.back();
+        shard.usage -= victim.second->size();
+        shard.map.erase(victim.first);
+        shard.lru.pop_back();
+    }
+}
+
+void BlockCache::setCapacity(size_t capacity) {
+    capacity_ = capacity;
+    size_t limit = capacity / NUM_SHARDS;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        evict(shard, limit);
+    }
+}
+
+BlockCacheStats BlockCache::stats() const {
+    BlockCacheStats s;
+    s.hits = hits_;
+    s.misses = misses_;
+    s.capacity = capacity_;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        s.usage += shard.usage;
+    }
+    return s;
+}
+
+} // namespace dkv
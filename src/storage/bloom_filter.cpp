@@ -0,0 +1,92 @@
+#include "storage/bloom_filter.hpp"
+#include <algorithm>
+
+namespace dkv {
+
+// 32-bit MurmurHash2 variant
+uint32_t BloomFilter::hash(std::string_view key) {
+    const uint32_t m = 0x5bd1e995;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(key.data());
+    size_t len = key.size();
+    uint32_t h = 0xbc9f1d34 ^ static_cast<uint32_t>(len);
+
+    while (len >= 4) {
+        uint32_t k = data[0] | (data[1] << 8) | (data[2] << 16) |
+                     (static_cast<uint32_t>(data[3]) << 24);
+        k *= m;
+        k ^= k >> 24;
+        k *= m;
+        h *= m;
+        h ^= k;
+        data += 4;
+        len -= 4;
+    }
+
+    switch (len) {
+        case 3: h ^= data[2] << 16; [[fallthrough]];
+        case 2: h ^= data[1] << 8;  [[fallthrough]];
+        case 1: h ^= data[0];
+                h *= m;
+    }
+
+    h ^= h >> 13;
+    h *= m;
+    h ^= h >> 15;
+    return h;
+}
+
+BloomFilter BloomFilter::build(const std::vector<uint32_t>& key_hashes, size_t bits_per_key) {
+    if (bits_per_key == 0 || key_hashes.empty()) {
+        return BloomFilter();
+    }
+
+    // k = bits_per_key * ln(2) minimizes the false positive rate
+    size_t probes = static_cast<size_t>(bits_per_key * 0.69);
+    probes = std::clamp<size_t>(probes, 1, 30);
+
+    // Small filters have a high false positive rate, so enforce a minimum size
+    size_t bits = std::max<size_t>(key_hashes.size() * bits_per_key, 64);
+    size_t bytes = (bits + 7) / 8;
+    bits = bytes * 8;
+
+    std::string data(bytes + 1, '\0');
+    data[bytes] = static_cast<char>(probes);
+
+    for (uint32_t h : key_hashes) {
+        // Double hashing: derive every probe from one hash
+        uint32_t delta = (h >> 17) | (h << 15);
+        for (size_t i = 0; i < probes; i++) {
+            uint32_t bit = h % bits;
+            data[bit / 8] |= static_cast<char>(1 << (bit % 8));
+            h += delta;
+        }
+    }
+
+    return BloomFilter(std::move(data));
+}
+
+bool BloomFilter::mightContain(const std::string& key) const {
+    if (data_.size() < 2) {
+        return true;
+    }
+
+    size_t bytes = data_.size() - 1;
+    size_t bits = bytes * 8;
+    size_t probes = static_cast<uint8_t>(data_[bytes]);
+    if (probes > 30) {
+        return true;  // Reserved for future encodings
+    }
+
+    uint32_t h = hash(key);
+    uint32_t delta = (h >> 17) | (h << 15);
+    for (size_t i = 0; i < probes; i++) {
+        uint32_t bit = h % bits;
+        if ((data_[bit / 8] & (1 << (bit % 8))) == 0) {
+            return false;
+        }
+        h += delta;
+    }
+    return true;
+}
+
+} // namespace dkv
@@ -0,0 +1,94 @@
+#include "storage/crc32c.hpp"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define DKV_CRC32C_SSE42 1
+#endif
+
+namespace dkv {
+
+namespace {
+
+constexpr uint32_t POLY = 0x82f63b78;  // Reflected Castagnoli polynomial
+
+struct Tables {
+    uint32_t t[8][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (crc & 1 ? POLY : 0);
+            }
+            t[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+uint32_t extendPortable(uint32_t crc, const uint8_t* p, size_t len) {
+    static const Tables tables;
+    const auto& t = tables.t;
+
+    // Slicing-by-8: fold eight bytes per step (assumes a little-endian host)
+    while (len >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef DKV_CRC32C_SSE42
+__attribute__((target("sse4.2")))
+uint32_t extendHardware(uint32_t crc, const uint8_t* p, size_t len) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+bool hasHardwareCrc() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#endif
+
+} // namespace
+
+uint32_t crc32c(const char* data, size_t len, uint32_t crc) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    crc = ~crc;
+#ifdef DKV_CRC32C_SSE42
+    if (hasHardwareCrc()) {
+        return ~extendHardware(crc, p, len);
+    }
+#endif
+    return ~extendPortable(crc, p, len);
+}
+
+} // namespace dkv
@@ -0,0 +1,45 @@
+#include "storage/file_sync.hpp"
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace dkv {
+
+namespace {
+
+std::mutex observer_mutex;
+std::function<void(const std::string&)> observer;
+
+} // namespace
+
+void syncPath(const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    bool ok = fd >= 0 && ::fsync(fd) == 0;
+    int error = errno;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!ok) {
+        throw std::runtime_error("Failed to sync " + path + ": " + std::strerror(error));
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(observer_mutex);
+    if (observer) {
+        observer(path);
+    }
+}
+
+void setSyncObserver(std::function<void(const std::string&)> fn) {
+    std::lock_guard<std::mutex> lock(observer_mutex);
+    observer = std::move(fn);
+}
+
+} // namespace dkv
@@ -1,31 +1,73 @@
 #include "storage/lsm_tree.hpp"
+#include "storage/file_sync.hpp"
 #include <filesystem>
 #include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <queue>
 #include <regex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 
 namespace dkv {
 
+namespace {
+
+void applyToMemTable(MemTable& memtable, const LogEntry& entry) {
+    if (entry.op == OpType::PUT) {
+        memtable.put(entry.key, entry.value);
+    } else if (entry.op == OpType::DELETE) {
+        memtable.del(entry.key);
+    }
+}
+
+} // namespace
+
 LSMTree::LSMTree(const std::string& data_dir, LSMConfig config)
     : data_dir_(data_dir), config_(config) {
-    
+
     std::filesystem::create_directories(data_dir_);
-    
-    memtable_ = std::make_unique<MemTable>();
-    wal_ = std::make_unique<WAL>(data_dir_ + "/wal.log");
-    
+
+    compact_pointer_.resize(std::max<size_t>(config_.num_levels, 2));
+
+    memtable_ = std::make_shared<MemTable>();
+
     loadSSTables();
     recover();
+
+    flush_thread_ = std::thread(&LSMTree::flushLoop, this);
+    compaction_thread_ = std::thread(&LSMTree::compactionLoop, this);
 }
 
 LSMTree::~LSMTree() {
-    if (!memtable_->empty()) {
+    try {
         flush();
+    } catch (const std::exception& e) {
+        // Unflushed writes are still in the WAL and get replayed on reopen
+        std::cerr << "[LSM] Flush on close failed: " << e.what() << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    flush_cv_.notify_all();
+    compaction_cv_.notify_all();
+    background_done_cv_.notify_all();
+
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+    if (compaction_thread_.joinable()) {
+        compaction_thread_.join();
     }
 }
 
 void LSMTree::loadSSTables() {
-    std::vector<std::pair<uint64_t, std::string>> sst_files;
-    
+    std::map<uint64_t, std::string> sst_files;  // id -> filename
+
     for (const auto& entry : std::filesystem::directory_iterator(data_dir_)) {
         std::string filename = entry.path().filename().string();
         if (filename.find("sstable_") == 0 && filename.find(".sst") != std::string::npos) {
@@ -33,63 +75,250 @@ void LSMTree::loadSSTables() {
             std::smatch match;
             if (std::regex_match(filename, match, re)) {
                 uint64_t id = std::stoull(match[1].str());
-                sst_files.push_back({id, entry.path().string()});
+                sst_files[id] = filename;
                 if (id >= sstable_id_) {
                     sstable_id_ = id + 1;
                 }
             }
         }
     }
-    
-    std::sort(sst_files.begin(), sst_files.end(),
-        [](const auto& a, const auto& b) { return a.first > b.first; });
-    
-    for (const auto& [id, path] : sst_files) {
-        sstables_.push_back(std::make_unique<SSTable>(path));
+
+    Levels levels(compact_pointer_.size());
+    std::string manifest_path = data_dir_ + "/MANIFEST";
+
+    if (!std::filesystem::exists(manifest_path)) {
+        // No manifest yet: every table is an L0 table, newest first
+        for (auto it = sst_files.rbegin(); it != sst_files.rend(); ++it) {
+            levels[0].push_back(openSSTable(data_dir_ + "/" + it->second));
+        }
+        levels_ = std::make_shared<const Levels>(std::move(levels));
+        return;
+    }
+
+    std::ifstream manifest(manifest_path);
+    std::set<std::string> live;
+    size_t level;
+    std::string filename;
+
+    while (manifest >> level >> filename) {
+        std::string path = data_dir_ + "/" + filename;
+        if (!std::filesystem::exists(path)) {
+            continue;
+        }
+        if (level >= levels.size()) {
+            levels.resize(level + 1);
+            compact_pointer_.resize(level + 1);
+        }
+        levels[level].push_back(openSSTable(path));
+        live.insert(filename);
+    }
+
+    for (size_t i = 1; i < levels.size(); i++) {
+        std::sort(levels[i].begin(), levels[i].end(),
+            [](const SSTablePtr& a, const SSTablePtr& b) { return a->minKey() < b->minKey(); });
+    }
+    levels_ = std::make_shared<const Levels>(std::move(levels));
+
+    // Tables missing from the manifest are leftovers of an interrupted flush or compaction
+    for (const auto& [id, name] : sst_files) {
+        if (live.count(name) == 0) {
+            std::error_code ec;
+            std::filesystem::remove(data_dir_ + "/" + name, ec);
+        }
     }
 }
 
+LSMTree::SSTablePtr LSMTree::openSSTable(const std::string& path) const {
+    return std::make_shared<SSTable>(path, config_.use_mmap_reads);
+}
+
+void LSMTree::writeManifest(const Levels& levels, const std::string& dir) {
+    std::string manifest_path = dir + "/MANIFEST";
+    std::string tmp_path = manifest_path + ".tmp";
+
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        for (size_t level = 0; level < levels.size(); level++) {
+            for (const auto& sst : levels[level]) {
+                out << level << " "
+                    << std::filesystem::path(sst->path()).filename().string() << "\n";
+            }
+        }
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed to write manifest: " + tmp_path);
+        }
+    }
+
+    // The new files must be durable before anything they replace is deleted
+    if (syncFiles()) {
+        syncPath(tmp_path);
+    }
+    std::filesystem::rename(tmp_path, manifest_path);
+    if (syncFiles()) {
+        syncPath(dir);
+    }
+}
+
+std::string LSMTree::walPath(uint64_t segment) const {
+    return data_dir_ + "/wal_" + std::to_string(segment) + ".log";
+}
+
 void LSMTree::recover() {
-    auto entries = wal_->recover();
-    
-    for (const auto& entry : entries) {
-        switch (entry.op) {
-            case OpType::PUT:
-                memtable_->put(entry.key, entry.value);
-                break;
-            case OpType::DELETE:
-                memtable_->del(entry.key);
-                break;
+    std::map<uint64_t, std::string> segments;  // segment -> path
+
+    for (const auto& entry : std::filesystem::directory_iterator(data_dir_)) {
+        std::string filename = entry.path().filename().string();
+        std::regex re("wal_(\\d+)\\.log");
+        std::smatch match;
+        if (std::regex_match(filename, match, re)) {
+            segments[std::stoull(match[1].str())] = entry.path().string();
         }
     }
+
+    // Trees created before WAL segments logged everything to wal.log
+    std::string legacy_path = data_dir_ + "/wal.log";
+    if (segments.empty() && std::filesystem::exists(legacy_path)) {
+        std::filesystem::rename(legacy_path, walPath(0));
+        segments[0] = walPath(0);
+    }
+
+    // Unflushed memtables each left a segment behind; replay them oldest first
+    for (const auto& [segment, path] : segments) {
+        WAL wal(path);
+        wal.replay([this](const LogEntry& entry) {
+            applyToMemTable(*memtable_, entry);
+        });
+        wal_segments_.push_back(segment);
+        next_wal_segment_ = segment + 1;
+    }
+
+    if (memtable_->empty()) {
+        for (const auto& [segment, path] : segments) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+        wal_segments_.clear();
+    }
+
+    wal_segments_.push_back(next_wal_segment_);
+    wal_ = std::make_unique<WAL>(walPath(next_wal_segment_++),
+                                 WALOptions{config_.wal_sync_mode, config_.wal_sync_interval_ms});
 }
 
-bool LSMTree::put(const std::string& key, const std::string& value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    wal_->append(OpType::PUT, key, value);
-    memtable_->put(key, value);
-    
-    maybeFlush();
+bool LSMTree::put(std::string_view key, std::string_view value) {
+    LogEntry entry{OpType::PUT, std::string(key), std::string(value)};
+    commit(entry);
+    return true;
+}
+
+bool LSMTree::write(const WriteBatch& batch) {
+    if (batch.empty()) {
+        return true;
+    }
+
+    LogEntry entry{OpType::BATCH, "", batch.data()};
+    commit(entry, &batch);
     return true;
 }
 
+void LSMTree::commit(LogEntry& entry, const WriteBatch* write_batch) {
+    Writer w(&entry, write_batch);
+    std::unique_lock<std::mutex> lock(mutex_);
+    writers_.push_back(&w);
+    w.cv.wait(lock, [&] { return w.done || writers_.front() == &w; });
+
+    if (w.done) {
+        // A leader already committed this write as part of its group
+        if (w.error) std::rethrow_exception(w.error);
+        return;
+    }
+
+    // This writer leads: commit everything queued behind it in one batch.
+    // Only the leader touches wal_ and memtable_, so both are used unlocked.
+    std::vector<LogEntry> batch;
+    std::vector<const WriteBatch*> unpacked;  // Per batch entry, for BATCH records
+    size_t batch_bytes = 0;
+    std::exception_ptr error;
+
+    try {
+        makeRoomForWrite(lock);
+
+        for (Writer* writer : writers_) {
+            if (!writer->entry || batch_bytes >= MAX_GROUP_BYTES) break;
+            batch_bytes += writer->entry->key.size() + writer->entry->value.size();
+            batch.push_back(std::move(*writer->entry));
+            unpacked.push_back(writer->batch);
+        }
+
+        WAL* wal = wal_.get();
+        MemTable* memtable = memtable_.get();
+        lock.unlock();
+
+        wal->appendBatch(batch);
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (unpacked[i]) {
+                // The caller is still waiting on us, so its batch is alive
+                memtable->apply(*unpacked[i]);
+            } else {
+                applyToMemTable(*memtable, batch[i]);
+            }
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    if (!lock.owns_lock()) {
+        lock.lock();
+    }
+    size_t group = std::max<size_t>(batch.size(), 1);
+    for (size_t i = 0; i < group; i++) {
+        Writer* writer = writers_.front();
+        writers_.pop_front();
+        if (writer != &w) {
+            writer->error = error;
+            writer->done = true;
+            writer->cv.notify_one();
+        }
+    }
+    if (!writers_.empty()) {
+        writers_.front()->cv.notify_one();
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
 std::optional<std::string> LSMTree::get(const std::string& key) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    auto memResult = memtable_->get(key);
+    std::shared_ptr<MemTable> memtable;
+    std::vector<std::shared_ptr<MemTable>> immutables;
+    std::shared_ptr<const Levels> levels;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        memtable = memtable_;
+        immutables.reserve(immutables_.size());
+        for (const auto& imm : immutables_) {
+            immutables.push_back(imm.memtable);
+        }
+        levels = levels_;
+    }
+
+    auto memResult = memtable->get(key);
+    for (size_t i = 0; !memResult && i < immutables.size(); i++) {
+        memResult = immutables[i]->get(key);
+    }
     if (memResult) {
         if (memResult->deleted) {
             return std::nullopt;
         }
         return memResult->value;
     }
-    
-    for (const auto& sst : sstables_) {
+
+    // L0 tables may overlap, so check all of them from newest to oldest
+    for (const auto& sst : (*levels)[0]) {
         if (!sst->mightContain(key)) {
             continue;
         }
-        
+
         auto result = sst->get(key);
         if (result) {
             if (result->deleted) {
@@ -98,17 +327,117 @@ std::optional<std::string> LSMTree::get(const std::string& key) const {
             return result->value;
         }
     }
-    
+
+    // Deeper levels are sorted and non-overlapping: at most one candidate each
+    for (size_t level = 1; level < levels->size(); level++) {
+        const auto& files = (*levels)[level];
+        auto it = std::lower_bound(files.begin(), files.end(), key,
+            [](const SSTablePtr& sst, const std::string& k) { return sst->maxKey() < k; });
+
+        if (it == files.end() || !(*it)->mightContain(key)) {
+            continue;
+        }
+
+        auto result = (*it)->get(key);
+        if (result) {
+            if (result->deleted) {
+                return std::nullopt;
+            }
+            return result->value;
+        }
+    }
+
     return std::nullopt;
 }
 
-bool LSMTree::del(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    wal_->append(OpType::DELETE, key);
-    memtable_->del(key);
-    
-    maybeFlush();
+std::vector<std::optional<std::string>> LSMTree::multiGet(const std::vector<std::string>& keys) const {
+    std::shared_ptr<MemTable> memtable;
+    std::vector<std::shared_ptr<MemTable>> immutables;
+    std::shared_ptr<const Levels> levels;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        memtable = memtable_;
+        immutables.reserve(immutables_.size());
+        for (const auto& imm : immutables_) {
+            immutables.push_back(imm.memtable);
+        }
+        levels = levels_;
+    }
+
+    std::vector<size_t> pending(keys.size());  // Indexes of unresolved keys, in key order
+    for (size_t i = 0; i < keys.size(); i++) {
+        pending[i] = i;
+    }
+    std::sort(pending.begin(), pending.end(),
+              [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    std::vector<std::optional<std::string>> results(keys.size());
+    std::vector<size_t> unresolved;
+    unresolved.reserve(pending.size());
+
+    for (size_t i : pending) {
+        auto memResult = memtable->get(keys[i]);
+        for (size_t j = 0; !memResult && j < immutables.size(); j++) {
+            memResult = immutables[j]->get(keys[i]);
+        }
+        if (!memResult) {
+            unresolved.push_back(i);
+        } else if (!memResult->deleted) {
+            results[i] = std::move(memResult->value);
+        }
+    }
+    pending.swap(unresolved);
+
+    // Probe a table with the keys it may hold; found keys (live or deleted)
+    // are settled and dropped from pending
+    auto probe = [&](const SSTable& sst, size_t i) {
+        if (!sst.mightContain(keys[i])) {
+            return false;
+        }
+        auto result = sst.get(keys[i]);
+        if (!result) {
+            return false;
+        }
+        if (!result->deleted) {
+            results[i] = std::move(result->value);
+        }
+        return true;
+    };
+
+    // L0 tables may overlap: every pending key visits each one, newest first
+    for (const auto& sst : (*levels)[0]) {
+        if (pending.empty()) break;
+        unresolved.clear();
+        for (size_t i : pending) {
+            if (!probe(*sst, i)) {
+                unresolved.push_back(i);
+            }
+        }
+        pending.swap(unresolved);
+    }
+
+    // Deeper levels are sorted, so the sorted keys walk the files in one pass
+    for (size_t level = 1; level < levels->size() && !pending.empty(); level++) {
+        const auto& files = (*levels)[level];
+        size_t file = 0;
+        unresolved.clear();
+        for (size_t i : pending) {
+            while (file < files.size() && files[file]->maxKey() < keys[i]) {
+                file++;
+            }
+            if (file == files.size() || keys[i] < files[file]->minKey() || !probe(*files[file], i)) {
+                unresolved.push_back(i);
+            }
+        }
+        pending.swap(unresolved);
+    }
+
+    return results;
+}
+
+bool LSMTree::del(std::string_view key) {
+    LogEntry entry{OpType::DELETE, std::string(key), ""};
+    commit(entry);
     return true;
 }
 
@@ -116,32 +445,281 @@ bool LSMTree::contains(const std::string& key) const {
     return get(key).has_value();
 }
 
-void LSMTree::maybeFlush() {
-    if (memtable_->memoryUsage() >= config_.memtable_size_limit) {
+// ==================== Range scans ====================
+
+class LSMTree::Iterator::Source {
+public:
+    virtual ~Source() = default;
+
+    virtual bool valid() const = 0;
+    virtual void next() = 0;
+    virtual std::string_view key() const = 0;
+    virtual std::string_view value() const = 0;
+    virtual bool deleted() const = 0;
+};
+
+namespace {
+
+class MemTableSource : public LSMTree::Iterator::Source {
+public:
+    MemTableSource(std::shared_ptr<MemTable> memtable, const std::string& start)
+        : memtable_(std::move(memtable)), it_(*memtable_) {
+        it_.seek(start);
+    }
+
+    bool valid() const override { return it_.valid(); }
+    void next() override { it_.next(); }
+    std::string_view key() const override { return it_.key(); }
+    std::string_view value() const override { return it_.value(); }
+    bool deleted() const override { return it_.deleted(); }
+
+private:
+    std::shared_ptr<MemTable> memtable_;
+    MemTable::Iterator it_;
+};
+
+// Walks a run of non-overlapping SSTables sorted by key (a level >= 1, or a
+// single L0 file), opening each file only when the scan reaches it
+class SSTableRunSource : public LSMTree::Iterator::Source {
+public:
+    SSTableRunSource(std::vector<std::shared_ptr<SSTable>> files, const std::string& start)
+        : files_(std::move(files)) {
+        file_ = std::lower_bound(files_.begin(), files_.end(), start,
+            [](const std::shared_ptr<SSTable>& sst, const std::string& k) {
+                return sst->maxKey() < k;
+            }) - files_.begin();
+
+        if (file_ < files_.size()) {
+            it_ = std::make_unique<SSTable::Iterator>(*files_[file_], true);
+            it_->seek(start);
+            skipEmptyFiles();
+        }
+    }
+
+    bool valid() const override { return it_ && it_->valid(); }
+
+    void next() override {
+        it_->next();
+        skipEmptyFiles();
+    }
+
+    std::string_view key() const override { return it_->entry().key; }
+    std::string_view value() const override { return it_->entry().value; }
+    bool deleted() const override { return it_->entry().deleted; }
+
+private:
+    void skipEmptyFiles() {
+        while (!it_->valid() && ++file_ < files_.size()) {
+            it_ = std::make_unique<SSTable::Iterator>(*files_[file_], true);
+        }
+    }
+
+    std::vector<std::shared_ptr<SSTable>> files_;
+    size_t file_ = 0;
+    std::unique_ptr<SSTable::Iterator> it_;
+};
+
+} // namespace
+
+LSMTree::Iterator::Iterator(const LSMTree& tree, const std::string& start) {
+    std::shared_ptr<MemTable> memtable;
+    std::vector<std::shared_ptr<MemTable>> immutables;
+    std::shared_ptr<const Levels> levels;
+    {
+        std::lock_guard<std::mutex> lock(tree.mutex_);
+        memtable = tree.memtable_;
+        for (const auto& imm : tree.immutables_) {
+            immutables.push_back(imm.memtable);
+        }
+        levels = tree.levels_;
+    }
+
+    // Same precedence as get(): memtables, then L0 newest first, then each level
+    sources_.push_back(std::make_unique<MemTableSource>(memtable, start));
+    for (auto& imm : immutables) {
+        sources_.push_back(std::make_unique<MemTableSource>(std::move(imm), start));
+    }
+    for (const auto& sst : (*levels)[0]) {
+        sources_.push_back(std::make_unique<SSTableRunSource>(std::vector<SSTablePtr>{sst}, start));
+    }
+    for (size_t level = 1; level < levels->size(); level++) {
+        if (!(*levels)[level].empty()) {
+            sources_.push_back(std::make_unique<SSTableRunSource>((*levels)[level], start));
+        }
+    }
+
+    for (size_t i = 0; i < sources_.size(); i++) {
+        if (sources_[i]->valid()) {
+            heap_.push({sources_[i]->key(), i});
+        }
+    }
+    skipShadowed();
+}
+
+LSMTree::Iterator::~Iterator() = default;
+
+std::string_view LSMTree::Iterator::value() const {
+    return sources_[heap_.top().second]->value();
+}
+
+void LSMTree::Iterator::next() {
+    size_t src = heap_.top().second;
+    heap_.pop();
+    advance(src);
+    skipShadowed();
+}
+
+void LSMTree::Iterator::advance(size_t src) {
+    sources_[src]->next();
+    if (sources_[src]->valid()) {
+        heap_.push({sources_[src]->key(), src});
+    }
+}
+
+void LSMTree::Iterator::skipShadowed() {
+    while (!heap_.empty()) {
+        auto [key, src] = heap_.top();
+        heap_.pop();
+
+        // Ties pop the lowest (newest) source first; older versions are shadowed
+        while (!heap_.empty() && heap_.top().first == key) {
+            size_t older = heap_.top().second;
+            heap_.pop();
+            advance(older);
+        }
+
+        if (!sources_[src]->deleted()) {
+            heap_.push({key, src});
+            return;
+        }
+        advance(src);
+    }
+}
+
+std::vector<std::pair<std::string, std::string>> LSMTree::scan(const std::string& start,
+                                                               const std::string& end,
+                                                               size_t limit) const {
+    std::vector<std::pair<std::string, std::string>> result;
+    for (Iterator it(*this, start); it.valid(); it.next()) {
+        if ((!end.empty() && it.key() >= end) || (limit && result.size() >= limit)) {
+            break;
+        }
+        result.emplace_back(it.key(), it.value());
+    }
+    return result;
+}
+
+void LSMTree::makeRoomForWrite(std::unique_lock<std::mutex>& lock) {
+    while (!stop_) {
+        if ((*levels_)[0].size() >= config_.max_sstables) {
+            // Too many L0 tables make every read slower; let compaction catch up
+            background_done_cv_.wait(lock);
+        } else if (memtable_->memoryUsage() < config_.memtable_size_limit) {
+            return;
+        } else if (immutables_.size() >= std::max<size_t>(config_.max_immutable_memtables, 1)) {
+            // The flush queue is full; wait for the flush thread
+            background_done_cv_.wait(lock);
+        } else {
+            switchMemTable();
+        }
+    }
+}
+
+void LSMTree::switchMemTable() {
+    uint64_t segment = next_wal_segment_;
+    auto wal = std::make_unique<WAL>(walPath(segment),
+                                     WALOptions{config_.wal_sync_mode, config_.wal_sync_interval_ms});
+    next_wal_segment_++;
+
+    immutables_.push_front({memtable_, std::move(wal_segments_)});
+    memtable_ = std::make_shared<MemTable>();
+    wal_ = std::move(wal);
+    wal_segments_ = {segment};
+
+    flush_cv_.notify_one();
+}
+
+void LSMTree::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        flush_cv_.wait(lock, [this] { return stop_ || !immutables_.empty(); });
+        if (immutables_.empty() || (stop_ && flush_failed_)) break;
+
+        // Oldest first, so L0 stays ordered newest to oldest
+        ImmutableMemTable imm = immutables_.back();
         uint64_t id = nextSSTableId();
-        std::string path = SSTable::create(data_dir_, id, *memtable_);
-        
-        sstables_.insert(sstables_.begin(), std::make_unique<SSTable>(path));
-        
-        memtable_->clear();
-        wal_->checkpoint();
+        flushing_ = true;
+        lock.unlock();
+
+        SSTablePtr sst;
+        try {
+            sst = openSSTable(SSTable::create(data_dir_, id, *imm.memtable,
+                                              config_.bloom_bits_per_key,
+                                              config_.sstable_block_size, syncFiles()));
+        } catch (const std::exception& e) {
+            std::cerr << "[LSM] Memtable flush failed: " << e.what() << std::endl;
+        }
+
+        lock.lock();
+        flushing_ = false;
+        bool installed = false;
+        if (sst) {
+            auto levels = std::make_shared<Levels>(*levels_);
+            (*levels)[0].insert((*levels)[0].begin(), sst);
+            try {
+                writeManifest(*levels);
+                levels_ = std::move(levels);
+                installed = true;
+            } catch (const std::exception& e) {
+                std::cerr << "[LSM] Memtable flush failed: " << e.what() << std::endl;
+                sst->markObsolete();
+            }
+        }
+
+        if (installed) {
+            immutables_.pop_back();
+            for (uint64_t segment : imm.wal_segments) {
+                std::error_code ec;
+                std::filesystem::remove(walPath(segment), ec);
+            }
+            compaction_cv_.notify_one();
+        }
+        flush_failed_ = !installed;
+        background_done_cv_.notify_all();
+
+        if (!installed) {
+            // Back off before retrying so a persistent error doesn't spin
+            flush_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return stop_; });
+        }
     }
 }
 
 void LSMTree::flush() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (memtable_->empty()) {
-        return;
+    // Queue like a write so no leader is appending to the memtable being switched out
+    Writer w(nullptr);
+    std::unique_lock<std::mutex> lock(mutex_);
+    writers_.push_back(&w);
+    w.cv.wait(lock, [&] { return writers_.front() == &w; });
+
+    std::exception_ptr error;
+    try {
+        if (!memtable_->empty()) {
+            switchMemTable();
+        }
+    } catch (...) {
+        error = std::current_exception();
     }
-    
-    uint64_t id = nextSSTableId();
-    std::string path = SSTable::create(data_dir_, id, *memtable_);
-    
-    sstables_.insert(sstables_.begin(), std::make_unique<SSTable>(path));
-    
-    memtable_->clear();
-    wal_->checkpoint();
+    writers_.pop_front();
+    if (!writers_.empty()) {
+        writers_.front()->cv.notify_one();
+    }
+    if (error) std::rethrow_exception(error);
+
+    // Gives up early if flushes are failing; the data stays in the WAL
+    background_done_cv_.wait(lock, [this] {
+        return stop_ || immutables_.empty() || flush_failed_;
+    });
 }
 
 void LSMTree::sync() {
@@ -149,6 +727,109 @@ void LSMTree::sync() {
     wal_->sync();
 }
 
+void LSMTree::compact() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    compaction_cv_.notify_one();
+    background_done_cv_.wait(lock, [this] {
+        return stop_ || (!compaction_running_ && !needsCompaction());
+    });
+}
+
+namespace {
+
+// Hard link where the filesystem allows it; SSTables are immutable, so a
+// copy is only a slower way to get the same bytes
+void linkOrCopy(const std::string& from, const std::string& to) {
+    std::error_code ec;
+    std::filesystem::create_hard_link(from, to, ec);
+    if (ec) {
+        std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing);
+    }
+}
+
+} // namespace
+
+void LSMTree::checkpoint(const std::string& dir) {
+    flush();
+
+    std::shared_ptr<const Levels> levels;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        levels = levels_;
+    }
+
+    // Holding the snapshot keeps compacted-away files on disk until linked
+    std::filesystem::create_directories(dir);
+    for (const auto& level : *levels) {
+        for (const auto& sst : level) {
+            std::string name = std::filesystem::path(sst->path()).filename().string();
+            linkOrCopy(sst->path(), dir + "/" + name);
+        }
+    }
+    writeManifest(*levels, dir);
+}
+
+void LSMTree::restore(const std::string& dir) {
+    // Take a turn like a write, so no group commit is mid-way through the memtable
+    Writer w(nullptr);
+    std::unique_lock<std::mutex> lock(mutex_);
+    writers_.push_back(&w);
+    w.cv.wait(lock, [&] { return writers_.front() == &w; });
+
+    // A flush or compaction finishing later would install files from the old contents
+    background_done_cv_.wait(lock, [this] { return stop_ || (!flushing_ && !compaction_running_); });
+
+    std::exception_ptr error;
+    try {
+        Levels levels(compact_pointer_.size());
+        std::ifstream manifest(dir + "/MANIFEST");
+        if (!manifest) {
+            throw std::runtime_error("No MANIFEST in checkpoint: " + dir);
+        }
+        size_t level;
+        std::string filename;
+        while (manifest >> level >> filename) {
+            if (level >= levels.size()) {
+                levels.resize(level + 1);
+                compact_pointer_.resize(level + 1);
+            }
+            std::string path = SSTable::pathFor(data_dir_, nextSSTableId());
+            linkOrCopy(dir + "/" + filename, path);
+            levels[level].push_back(openSSTable(path));
+        }
+
+        // Writes to the old contents must not be replayed over the new ones
+        std::vector<uint64_t> old_segments = wal_segments_;
+        for (const auto& imm : immutables_) {
+            old_segments.insert(old_segments.end(), imm.wal_segments.begin(), imm.wal_segments.end());
+        }
+        switchMemTable();
+        immutables_.clear();
+        for (uint64_t segment : old_segments) {
+            std::error_code ec;
+            std::filesystem::remove(walPath(segment), ec);
+        }
+
+        writeManifest(levels);
+        for (const auto& old_level : *levels_) {
+            for (const auto& sst : old_level) {
+                sst->markObsolete();
+            }
+        }
+        levels_ = std::make_shared<const Levels>(std::move(levels));
+        std::fill(compact_pointer_.begin(), compact_pointer_.end(), std::string());
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    writers_.pop_front();
+    if (!writers_.empty()) {
+        writers_.front()->cv.notify_one();
+    }
+    compaction_cv_.notify_one();
+    if (error) std::rethrow_exception(error);
+}
+
 uint64_t LSMTree::nextSSTableId() {
     return sstable_id_++;
 }
@@ -160,7 +841,300 @@ size_t LSMTree::memtableSize() const {
 
 size_t LSMTree::sstableCount() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return sstables_.size();
+    size_t count = 0;
+    for (const auto& files : *levels_) {
+        count += files.size();
+    }
+    return count;
+}
+
+size_t LSMTree::levelSSTableCount(size_t level) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return level < levels_->size() ? (*levels_)[level].size() : 0;
+}
+
+std::string LSMStats::toString() const {
+    std::ostringstream ss;
+    ss << "memtable_bytes:" << memtable_bytes << "\n";
+    ss << "immutable_memtables:" << immutable_memtables << "\n";
+    ss << "sstables:";
+    for (size_t level = 0; level < level_sstables.size(); level++) {
+        ss << (level ? "," : "") << "L" << level << "=" << level_sstables[level];
+    }
+    ss << "\n";
+    ss << "block_cache_hits:" << block_cache.hits << "\n";
+    ss << "block_cache_misses:" << block_cache.misses << "\n";
+    ss << "block_cache_usage:" << block_cache.usage << "/" << block_cache.capacity << "\n";
+    return ss.str();
+}
+
+LSMStats LSMTree::stats() const {
+    LSMStats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.memtable_bytes = memtable_->memoryUsage();
+        s.immutable_memtables = immutables_.size();
+        for (const auto& files : *levels_) {
+            s.level_sstables.push_back(files.size());
+        }
+    }
+    s.block_cache = BlockCache::global().stats();
+    return s;
+}
+
+// ==================== Compaction ====================
+
+void LSMTree::compactionLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stop_) {
+        compaction_cv_.wait(lock, [this] { return stop_ || needsCompaction(); });
+        if (stop_) break;
+
+        auto c = pickCompaction();
+        if (!c) continue;
+
+        compaction_running_ = true;
+        lock.unlock();
+
+        std::vector<SSTablePtr> outputs;
+        bool ok = true;
+        try {
+            outputs = runCompaction(*c);
+        } catch (const std::exception& e) {
+            std::cerr << "[LSM] Compaction of level " << c->level << " failed: "
+                      << e.what() << std::endl;
+            ok = false;
+        }
+
+        lock.lock();
+        if (ok) {
+            try {
+                installCompaction(*c, outputs);
+            } catch (const std::exception& e) {
+                std::cerr << "[LSM] Compaction of level " << c->level << " failed: "
+                          << e.what() << std::endl;
+                for (const auto& sst : outputs) {
+                    sst->markObsolete();
+                }
+                ok = false;
+            }
+        }
+        compaction_running_ = false;
+        background_done_cv_.notify_all();
+
+        if (!ok) {
+            // Back off before retrying so a persistent error doesn't spin
+            compaction_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return stop_; });
+        }
+    }
+}
+
+uint64_t LSMTree::maxBytesForLevel(size_t level) const {
+    uint64_t bytes = config_.level1_max_bytes;
+    for (size_t i = 1; i < level; i++) {
+        bytes *= config_.level_size_multiplier;
+    }
+    return bytes;
+}
+
+uint64_t LSMTree::levelBytes(size_t level) const {
+    uint64_t bytes = 0;
+    for (const auto& sst : (*levels_)[level]) {
+        bytes += sst->fileSize();
+    }
+    return bytes;
+}
+
+bool LSMTree::needsCompaction() const {
+    const Levels& levels = *levels_;
+    if (levels[0].size() >= config_.level0_compaction_trigger) {
+        return true;
+    }
+    // The last level has nowhere to push data down to
+    for (size_t level = 1; level + 1 < levels.size(); level++) {
+        if (levelBytes(level) > maxBytesForLevel(level)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<LSMTree::Compaction> LSMTree::pickCompaction() {
+    // Compact the level that is furthest over its budget
+    const Levels& levels = *levels_;
+    size_t best_level = 0;
+    double best_score = static_cast<double>(levels[0].size()) /
+                        std::max<size_t>(config_.level0_compaction_trigger, 1);
+
+    for (size_t level = 1; level + 1 < levels.size(); level++) {
+        double score = static_cast<double>(levelBytes(level)) / maxBytesForLevel(level);
+        if (score > best_score) {
+            best_score = score;
+            best_level = level;
+        }
+    }
+
+    if (best_score < 1.0) {
+        return std::nullopt;
+    }
+
+    Compaction c;
+    c.level = best_level;
+
+    if (best_level == 0) {
+        c.inputs = levels[0];
+    } else {
+        // Rotate through the key space so every file eventually moves down
+        const auto& files = levels[best_level];
+        auto it = std::find_if(files.begin(), files.end(), [&](const SSTablePtr& sst) {
+            return sst->minKey() > compact_pointer_[best_level];
+        });
+        if (it == files.end()) {
+            it = files.begin();
+        }
+        c.inputs.push_back(*it);
+        compact_pointer_[best_level] = (*it)->maxKey();
+    }
+
+    std::string smallest = c.inputs.front()->minKey();
+    std::string largest = c.inputs.front()->maxKey();
+    for (const auto& sst : c.inputs) {
+        smallest = std::min(smallest, sst->minKey());
+        largest = std::max(largest, sst->maxKey());
+    }
+
+    for (const auto& sst : levels[best_level + 1]) {
+        if (!(sst->maxKey() < smallest || sst->minKey() > largest)) {
+            c.next_inputs.push_back(sst);
+        }
+    }
+
+    for (size_t level = best_level + 2; level < levels.size(); level++) {
+        c.deeper.insert(c.deeper.end(), levels[level].begin(), levels[level].end());
+    }
+
+    return c;
+}
+
+std::vector<LSMTree::SSTablePtr> LSMTree::runCompaction(const Compaction& c) {
+    // Sources in precedence order: a lower index holds the newer version of a key
+    std::vector<std::unique_ptr<SSTable::Iterator>> iters;
+    for (const auto& sst : c.inputs) {
+        iters.push_back(std::make_unique<SSTable::Iterator>(*sst));
+    }
+    for (const auto& sst : c.next_inputs) {
+        iters.push_back(std::make_unique<SSTable::Iterator>(*sst));
+    }
+
+    using HeapItem = std::pair<std::string, size_t>;  // key, source
+    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+    for (size_t i = 0; i < iters.size(); i++) {
+        if (iters[i]->valid()) {
+            heap.push({iters[i]->entry().key, i});
+        }
+    }
+
+    // A tombstone can be dropped once no deeper level could hold the key
+    auto isBaseLevelForKey = [&c](const std::string& key) {
+        for (const auto& sst : c.deeper) {
+            if (sst->mightContain(key)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::vector<std::string> paths;
+    std::unique_ptr<SSTableBuilder> builder;
+    std::string building;
+
+    try {
+        while (!heap.empty()) {
+            auto [key, src] = heap.top();
+            heap.pop();
+
+            const SSTableEntry& entry = iters[src]->entry();
+            if (!entry.deleted || !isBaseLevelForKey(key)) {
+                if (!builder) {
+                    building = SSTable::pathFor(data_dir_, nextSSTableId());
+                    builder = std::make_unique<SSTableBuilder>(building, config_.bloom_bits_per_key,
+                                                               config_.sstable_block_size,
+                                                               syncFiles());
+                }
+                builder->add(entry.key, entry.value, entry.deleted);
+
+                if (builder->fileSize() >= config_.sstable_target_size) {
+                    paths.push_back(builder->finish());
+                    builder.reset();
+                }
+            }
+
+            iters[src]->next();
+            if (iters[src]->valid()) {
+                heap.push({iters[src]->entry().key, src});
+            }
+
+            // Older versions of the same key are shadowed
+            while (!heap.empty() && heap.top().first == key) {
+                size_t older = heap.top().second;
+                heap.pop();
+                iters[older]->next();
+                if (iters[older]->valid()) {
+                    heap.push({iters[older]->entry().key, older});
+                }
+            }
+        }
+
+        if (builder) {
+            paths.push_back(builder->finish());
+        }
+
+        std::vector<SSTablePtr> outputs;
+        for (const auto& path : paths) {
+            outputs.push_back(openSSTable(path));
+        }
+        return outputs;
+    } catch (...) {
+        if (builder) {
+            builder.reset();
+            paths.push_back(building);
+        }
+        for (const auto& path : paths) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+        throw;
+    }
+}
+
+void LSMTree::installCompaction(const Compaction& c, const std::vector<SSTablePtr>& outputs) {
+    auto removeAll = [](std::vector<SSTablePtr>& files, const std::vector<SSTablePtr>& gone) {
+        files.erase(std::remove_if(files.begin(), files.end(), [&gone](const SSTablePtr& sst) {
+            return std::find(gone.begin(), gone.end(), sst) != gone.end();
+        }), files.end());
+    };
+
+    // Flushes may have added L0 tables since the pick, so edit the current snapshot
+    auto levels = std::make_shared<Levels>(*levels_);
+    removeAll((*levels)[c.level], c.inputs);
+    removeAll((*levels)[c.level + 1], c.next_inputs);
+
+    auto& next = (*levels)[c.level + 1];
+    next.insert(next.end(), outputs.begin(), outputs.end());
+    std::sort(next.begin(), next.end(),
+        [](const SSTablePtr& a, const SSTablePtr& b) { return a->minKey() < b->minKey(); });
+
+    writeManifest(*levels);
+    levels_ = std::move(levels);
+
+    // Files are unlinked when the last reader drops its reference
+    for (const auto& sst : c.inputs) {
+        sst->markObsolete();
+    }
+    for (const auto& sst : c.next_inputs) {
+        sst->markObsolete();
+    }
 }
 
 } // namespace dkv
@@ -1,68 +1,182 @@
 #include "storage/memtable.hpp"
+#include "storage/write_batch.hpp"
+#include <cstring>
+#include <new>
 
 namespace dkv {
 
+// Value bytes follow the header in the same arena allocation
+struct MemTable::Value {
+    uint32_t size;
+    bool deleted;
+
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+};
+
+struct MemTable::Node {
+    const char* key_data;
+    uint32_t key_size;
+    std::atomic<const Value*> value;
+    std::atomic<Node*> next_[1];  // Allocated with one slot per level of the node's height
+
+    std::string_view key() const { return {key_data, key_size}; }
+
+    // Acquire/release so a reader following a link sees a fully built node
+    Node* next(int level) const { return next_[level].load(std::memory_order_acquire); }
+    void setNext(int level, Node* node) { next_[level].store(node, std::memory_order_release); }
+};
+
+MemTable::MemTable() : head_(newNode({}, MAX_HEIGHT)) {}
+
 void MemTable::put(const std::string& key, const std::string& value) {
-    std::unique_lock lock(mutex_);
-    
-    auto it = data_.find(key);
-    if (it != data_.end()) {
-        memory_usage_ -= it->second.value.size();
-        it->second = {value, false};
-    } else {
-        data_[key] = {value, false};
-        memory_usage_ += key.size();
-    }
-    memory_usage_ += value.size();
+    insert(key, value, false);
 }
 
 void MemTable::del(const std::string& key) {
-    std::unique_lock lock(mutex_);
-    
-    auto it = data_.find(key);
-    if (it != data_.end()) {
-        memory_usage_ -= it->second.value.size();
-        it->second = {"", true};
-    } else {
-        data_[key] = {"", true};
-        memory_usage_ += key.size();
+    insert(key, {}, true);
+}
+
+void MemTable::apply(const WriteBatch& batch) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    batch.forEach([this](OpType op, std::string_view key, std::string_view value) {
+        insertLocked(key, value, op == OpType::DELETE);
+    });
+}
+
+void MemTable::insert(std::string_view key, std::string_view value, bool deleted) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    insertLocked(key, value, deleted);
+}
+
+void MemTable::insertLocked(std::string_view key, std::string_view value, bool deleted) {
+    Node* prev[MAX_HEIGHT];
+    Node* node = findGreaterOrEqual(key, prev);
+    const Value* record = newValue(value, deleted);
+
+    if (node && node->key() == key) {
+        node->value.store(record, std::memory_order_release);
+        return;
+    }
+
+    int height = randomHeight();
+    int max_height = max_height_.load(std::memory_order_relaxed);
+    if (height > max_height) {
+        for (int level = max_height; level < height; level++) {
+            prev[level] = head_;
+        }
+        // Readers that see the new height early just find nullptr at head_ and drop a level
+        max_height_.store(height, std::memory_order_relaxed);
+    }
+
+    node = newNode(key, height);
+    node->value.store(record, std::memory_order_relaxed);
+    for (int level = 0; level < height; level++) {
+        node->next_[level].store(prev[level]->next_[level].load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+        prev[level]->setNext(level, node);
+    }
+    count_.fetch_add(1, std::memory_order_release);
+}
+
+MemTable::Node* MemTable::findGreaterOrEqual(std::string_view key, Node** prev) const {
+    Node* node = head_;
+    int level = max_height_.load(std::memory_order_relaxed) - 1;
+
+    while (true) {
+        Node* next = node->next(level);
+        if (next && next->key() < key) {
+            node = next;
+        } else {
+            if (prev) {
+                prev[level] = node;
+            }
+            if (level == 0) {
+                return next;
+            }
+            level--;
+        }
+    }
+}
+
+MemTable::Node* MemTable::newNode(std::string_view key, int height) {
+    char* key_data = arena_.allocate(key.size());
+    std::memcpy(key_data, key.data(), key.size());
+
+    char* mem = arena_.allocateAligned(sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
+    Node* node = new (mem) Node;
+    node->key_data = key_data;
+    node->key_size = static_cast<uint32_t>(key.size());
+    node->value.store(nullptr, std::memory_order_relaxed);
+    for (int level = 0; level < height; level++) {
+        new (&node->next_[level]) std::atomic<Node*>(nullptr);
+    }
+    return node;
+}
+
+const MemTable::Value* MemTable::newValue(std::string_view value, bool deleted) {
+    char* mem = arena_.allocateAligned(sizeof(Value) + value.size());
+    Value* record = new (mem) Value{static_cast<uint32_t>(value.size()), deleted};
+    std::memcpy(mem + sizeof(Value), value.data(), value.size());
+    return record;
+}
+
+int MemTable::randomHeight() {
+    // Each level holds roughly a quarter of the nodes of the level below
+    int height = 1;
+    while (height < MAX_HEIGHT && rng_() % 4 == 0) {
+        height++;
     }
+    return height;
 }
 
 std::optional<MemTableEntry> MemTable::get(const std::string& key) const {
-    std::shared_lock lock(mutex_);
-    
-    auto it = data_.find(key);
-    if (it != data_.end()) {
-        return it->second;
+    Node* node = findGreaterOrEqual(key, nullptr);
+    if (node && node->key() == key) {
+        const Value* record = node->value.load(std::memory_order_acquire);
+        return MemTableEntry{std::string(record->data(), record->size), record->deleted};
     }
     return std::nullopt;
 }
 
 bool MemTable::contains(const std::string& key) const {
-    std::shared_lock lock(mutex_);
-    return data_.count(key) > 0;
+    Node* node = findGreaterOrEqual(key, nullptr);
+    return node && node->key() == key;
 }
 
 size_t MemTable::size() const {
-    std::shared_lock lock(mutex_);
-    return data_.size();
+    return count_.load(std::memory_order_acquire);
 }
 
 size_t MemTable::memoryUsage() const {
-    std::shared_lock lock(mutex_);
-    return memory_usage_;
+    return arena_.memoryUsage();
 }
 
 bool MemTable::empty() const {
-    std::shared_lock lock(mutex_);
-    return data_.empty();
+    return size() == 0;
+}
+
+MemTable::Iterator::Iterator(const MemTable& table)
+    : table_(table), node_(table.head_->next(0)) {}
+
+void MemTable::Iterator::next() {
+    node_ = node_->next(0);
+}
+
+void MemTable::Iterator::seek(std::string_view target) {
+    node_ = table_.findGreaterOrEqual(target, nullptr);
+}
+
+std::string_view MemTable::Iterator::key() const {
+    return node_->key();
+}
+
+std::string_view MemTable::Iterator::value() const {
+    const Value* record = node_->value.load(std::memory_order_acquire);
+    return {record->data(), record->size};
 }
 
-void MemTable::clear() {
-    std::unique_lock lock(mutex_);
-    data_.clear();
-    memory_usage_ = 0;
+bool MemTable::Iterator::deleted() const {
+    return node_->value.load(std::memory_order_acquire)->deleted;
 }
 
 } // namespace dkv
@@ -15,9 +15,7 @@ PersistentKVStore::PersistentKVStore(const std::string& data_dir)
 }
 
 void PersistentKVStore::recover() {
-    auto entries = wal_->recover();
-    
-    for (const auto& entry : entries) {
+    wal_->replay([this](const LogEntry& entry) {
         switch (entry.op) {
             case OpType::PUT:
                 store_.put(entry.key, entry.value);
@@ -25,8 +23,11 @@ void PersistentKVStore::recover() {
             case OpType::DELETE:
                 store_.del(entry.key);
                 break;
+            case OpType::BATCH:
+                // Replay hands over a batch's entries one by one
+                break;
         }
-    }
+    });
 }
 
 bool PersistentKVStore::put(const std::string& key, const std::string& value) {
@@ -1,61 +1,260 @@
 #include "storage/sstable.hpp"
+#include "storage/file_sync.hpp"
 #include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <stdexcept>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace dkv {
 
-std::string SSTable::create(const std::string& dir, uint64_t id, const MemTable& memtable) {
-    std::string path = dir + "/sstable_" + std::to_string(id) + ".sst";
-    std::ofstream file(path, std::ios::binary);
-    
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to create SSTable: " + path);
+struct RecordView {
+    bool deleted;
+    std::string_view key;
+    std::string_view value;
+};
+
+// Parse one flat (format 0/1) record from an in-memory block, advancing p past it
+static bool parseRecord(const char*& p, const char* end, RecordView& record) {
+    uint32_t keyLen, valLen;
+    if (end - p < static_cast<ptrdiff_t>(1 + sizeof(keyLen))) {
+        return false;
+    }
+    record.deleted = *p != 0;
+    std::memcpy(&keyLen, p + 1, sizeof(keyLen));
+    p += 1 + sizeof(keyLen);
+
+    if (static_cast<size_t>(end - p) < keyLen + sizeof(valLen)) {
+        return false;
     }
+    record.key = std::string_view(p, keyLen);
+    std::memcpy(&valLen, p + keyLen, sizeof(valLen));
+    p += keyLen + sizeof(valLen);
 
-    std::vector<IndexEntry> index;
-    size_t count = 0;
-    uint64_t offset = 0;
+    if (static_cast<size_t>(end - p) < valLen) {
+        return false;
+    }
+    record.value = std::string_view(p, valLen);
+    p += valLen;
+    return true;
+}
+
+static void putVarint32(std::string& dst, uint32_t v) {
+    while (v >= 0x80) {
+        dst.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    dst.push_back(static_cast<char>(v));
+}
 
-    for (auto it = memtable.begin(); it != memtable.end(); ++it) {
-        if (count % INDEX_INTERVAL == 0) {
-            index.push_back({it->first, offset});
+static const char* getVarint32(const char* p, const char* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift <= 28 && p < end; shift += 7) {
+        uint32_t byte = static_cast<uint8_t>(*p++);
+        v |= (byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return p;
         }
+    }
+    return nullptr;
+}
 
-        uint8_t deleted = it->second.deleted ? 1 : 0;
-        file.write(reinterpret_cast<const char*>(&deleted), sizeof(deleted));
+struct BlockEntryHeader {
+    uint32_t shared;
+    uint32_t unshared;
+    uint32_t valLen;
+    bool deleted;
+};
 
-        uint32_t keyLen = static_cast<uint32_t>(it->first.size());
-        file.write(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
-        file.write(it->first.data(), keyLen);
+// Decode a format 2 entry header; returns a pointer to the key suffix or nullptr
+static const char* decodeEntry(const char* p, const char* end, BlockEntryHeader& h) {
+    if (!(p = getVarint32(p, end, h.shared))) return nullptr;
+    if (!(p = getVarint32(p, end, h.unshared))) return nullptr;
+    if (!(p = getVarint32(p, end, h.valLen))) return nullptr;
+    if (p >= end) return nullptr;
+    h.deleted = *p++ != 0;
+    if (static_cast<uint64_t>(end - p) < static_cast<uint64_t>(h.unshared) + h.valLen) {
+        return nullptr;
+    }
+    return p;
+}
+
+// ==================== SSTableBuilder ====================
 
-        uint32_t valLen = static_cast<uint32_t>(it->second.value.size());
-        file.write(reinterpret_cast<const char*>(&valLen), sizeof(valLen));
-        file.write(it->second.value.data(), valLen);
+SSTableBuilder::SSTableBuilder(const std::string& path, size_t bloom_bits_per_key,
+                               size_t block_size, bool sync)
+    : path_(path), bloom_bits_per_key_(bloom_bits_per_key), block_size_(block_size), sync_(sync) {
+    file_.open(path_, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        throw std::runtime_error("Failed to create SSTable: " + path_);
+    }
+}
 
-        offset = file.tellp();
-        count++;
+void SSTableBuilder::add(std::string_view key, std::string_view value, bool deleted) {
+    if (block_entries_ == 0) {
+        index_.push_back({std::string(key), offset_});
     }
+    if (bloom_bits_per_key_ > 0) {
+        key_hashes_.push_back(BloomFilter::hash(key));
+    }
+
+    size_t shared = 0;
+    if (block_entries_ % RESTART_INTERVAL == 0) {
+        restarts_.push_back(static_cast<uint32_t>(block_.size()));
+    } else {
+        size_t limit = std::min(last_key_.size(), key.size());
+        while (shared < limit && last_key_[shared] == key[shared]) {
+            shared++;
+        }
+    }
+
+    putVarint32(block_, static_cast<uint32_t>(shared));
+    putVarint32(block_, static_cast<uint32_t>(key.size() - shared));
+    putVarint32(block_, static_cast<uint32_t>(value.size()));
+    block_.push_back(deleted ? 1 : 0);
+    block_.append(key.data() + shared, key.size() - shared);
+    block_.append(value.data(), value.size());
+
+    last_key_.assign(key.data(), key.size());
+    block_entries_++;
+    count_++;
+
+    if (block_.size() >= block_size_) {
+        flushBlock();
+    }
+}
+
+void SSTableBuilder::flushBlock() {
+    if (block_entries_ == 0) {
+        return;
+    }
+
+    for (uint32_t restart : restarts_) {
+        block_.append(reinterpret_cast<const char*>(&restart), sizeof(restart));
+    }
+    uint32_t numRestarts = static_cast<uint32_t>(restarts_.size());
+    block_.append(reinterpret_cast<const char*>(&numRestarts), sizeof(numRestarts));
+
+    file_.write(block_.data(), block_.size());
+    offset_ += block_.size();
+
+    block_.clear();
+    restarts_.clear();
+    block_entries_ = 0;
+}
+
+std::string SSTableBuilder::finish() {
+    flushBlock();
 
-    uint64_t indexOffset = offset;
-    uint32_t indexSize = static_cast<uint32_t>(index.size());
-    file.write(reinterpret_cast<const char*>(&indexSize), sizeof(indexSize));
+    uint64_t indexOffset = offset_;
+    uint32_t indexSize = static_cast<uint32_t>(index_.size());
+    file_.write(reinterpret_cast<const char*>(&indexSize), sizeof(indexSize));
 
-    for (const auto& entry : index) {
+    for (const auto& entry : index_) {
         uint32_t keyLen = static_cast<uint32_t>(entry.key.size());
-        file.write(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
-        file.write(entry.key.data(), keyLen);
-        file.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
+        file_.write(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
+        file_.write(entry.key.data(), keyLen);
+        file_.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
     }
 
-    file.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
-    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    uint64_t bloomOffset = file_.tellp();
+    BloomFilter bloom = BloomFilter::build(key_hashes_, bloom_bits_per_key_);
+    uint32_t bloomSize = static_cast<uint32_t>(bloom.data().size());
+    file_.write(reinterpret_cast<const char*>(&bloomSize), sizeof(bloomSize));
+    file_.write(bloom.data().data(), bloomSize);
 
-    file.close();
-    return path;
+    // Footer: bloomOffset | indexOffset | count | version | magic
+    uint64_t count = count_;
+    uint64_t version = SSTable::FORMAT_VERSION;
+    uint64_t magic = SSTable::FOOTER_MAGIC;
+    file_.write(reinterpret_cast<const char*>(&bloomOffset), sizeof(bloomOffset));
+    file_.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    file_.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file_.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file_.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error("Failed to write SSTable: " + path_);
+    }
+    if (sync_) {
+        syncPath(path_);
+    }
+    return path_;
+}
+
+// ==================== SSTable ====================
+
+std::string SSTable::pathFor(const std::string& dir, uint64_t id) {
+    return dir + "/sstable_" + std::to_string(id) + ".sst";
+}
+
+std::string SSTable::create(const std::string& dir, uint64_t id, const MemTable& memtable,
+                            size_t bloom_bits_per_key, size_t block_size, bool sync) {
+    SSTableBuilder builder(pathFor(dir, id), bloom_bits_per_key, block_size, sync);
+    for (MemTable::Iterator it(memtable); it.valid(); it.next()) {
+        builder.add(it.key(), it.value(), it.deleted());
+    }
+    return builder.finish();
+}
+
+SSTable::SSTable(const std::string& path, bool use_mmap)
+    : path_(path), cache_id_(BlockCache::newTableId()) {
+#ifndef _WIN32
+    fd_ = ::open(path_.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open SSTable: " + path_);
+    }
+
+    struct stat st;
+    if (use_mmap && ::fstat(fd_, &st) == 0 && st.st_size > 0) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+        if (addr != MAP_FAILED) {
+            // Lookups touch one block each, so readahead would be wasted
+            ::madvise(addr, size, MADV_RANDOM);
+            map_ = static_cast<const char*>(addr);
+            map_size_ = size;
+        }
+    }
+#else
+    (void)use_mmap;
+#endif
+    try {
+        loadIndex();
+    } catch (...) {
+        // The destructor won't run for a half-built table
+        closeFile();
+        throw;
+    }
 }
 
-SSTable::SSTable(const std::string& path) : path_(path) {
-    loadIndex();
+SSTable::~SSTable() {
+    closeFile();
+    if (obsolete_) {
+        std::error_code ec;
+        std::filesystem::remove(path_, ec);
+    }
+}
+
+void SSTable::closeFile() {
+#ifndef _WIN32
+    if (map_) {
+        ::munmap(const_cast<char*>(map_), map_size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
 }
 
 void SSTable::loadIndex() {
@@ -64,52 +263,76 @@ void SSTable::loadIndex() {
         throw std::runtime_error("Failed to open SSTable: " + path_);
     }
 
-    file.seekg(-static_cast<int>(sizeof(uint64_t) + sizeof(size_t)), std::ios::end);
-    
+    file_size_ = std::filesystem::file_size(path_);
+
+    uint64_t magic = 0;
+    if (file_size_ >= sizeof(magic)) {
+        file.seekg(-static_cast<int>(sizeof(magic)), std::ios::end);
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    }
+
     uint64_t indexOffset;
-    file.read(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
-    file.read(reinterpret_cast<char*>(&entry_count_), sizeof(entry_count_));
+    if (magic == FOOTER_MAGIC || magic == FOOTER_MAGIC_V1) {
+        uint64_t bloomOffset, count, version = 1;
+        if (magic == FOOTER_MAGIC) {
+            file.seekg(-static_cast<int>(5 * sizeof(uint64_t)), std::ios::end);
+        } else {
+            file.seekg(-static_cast<int>(4 * sizeof(uint64_t)), std::ios::end);
+        }
+        file.read(reinterpret_cast<char*>(&bloomOffset), sizeof(bloomOffset));
+        file.read(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
+        file.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (magic == FOOTER_MAGIC) {
+            file.read(reinterpret_cast<char*>(&version), sizeof(version));
+            if (version != FORMAT_VERSION) {
+                throw std::runtime_error("Unsupported SSTable format " + std::to_string(version) +
+                                         ": " + path_);
+            }
+        }
+        entry_count_ = count;
+        format_version_ = static_cast<uint32_t>(version);
+
+        file.seekg(bloomOffset);
+        uint32_t bloomSize = 0;
+        file.read(reinterpret_cast<char*>(&bloomSize), sizeof(bloomSize));
+        std::string bloomData(bloomSize, '\0');
+        file.read(bloomData.data(), bloomSize);
+        bloom_ = BloomFilter(std::move(bloomData));
+    } else {
+        // Tables written before bloom filters end with indexOffset | count
+        file.seekg(-static_cast<int>(sizeof(uint64_t) + sizeof(size_t)), std::ios::end);
+        file.read(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
+        file.read(reinterpret_cast<char*>(&entry_count_), sizeof(entry_count_));
+    }
+    data_end_ = indexOffset;
 
     file.seekg(indexOffset);
-    
+
     uint32_t indexSize;
     file.read(reinterpret_cast<char*>(&indexSize), sizeof(indexSize));
 
     index_.reserve(indexSize);
     for (uint32_t i = 0; i < indexSize; i++) {
         IndexEntry entry;
-        
+
         uint32_t keyLen;
         file.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen));
         entry.key.resize(keyLen);
         file.read(entry.key.data(), keyLen);
         file.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
-        
+
         index_.push_back(std::move(entry));
     }
 
     if (!index_.empty()) {
-        auto firstEntry = readEntryAt(0);
-        if (firstEntry) min_key_ = firstEntry->key;
-        
-        // Find last entry by scanning from last index position
-        file.seekg(index_.back().offset);
-        std::string lastKey;
-        while (file.tellg() < static_cast<std::streampos>(indexOffset)) {
-            uint8_t deleted;
-            if (!file.read(reinterpret_cast<char*>(&deleted), sizeof(deleted))) break;
-            
-            uint32_t keyLen;
-            if (!file.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen))) break;
-            
-            lastKey.resize(keyLen);
-            if (!file.read(lastKey.data(), keyLen)) break;
-            
-            uint32_t valLen;
-            if (!file.read(reinterpret_cast<char*>(&valLen), sizeof(valLen))) break;
-            file.seekg(valLen, std::ios::cur);
+        // Every block starts with an index entry, so the first key is indexed
+        min_key_ = index_.front().key;
+
+        BlockCache::Block holder;
+        BlockCursor cursor(blockData(index_.size() - 1, holder), format_version_);
+        while (cursor.next()) {
+            max_key_.assign(cursor.key().data(), cursor.key().size());
         }
-        if (!lastKey.empty()) max_key_ = lastKey;
     }
 }
 
@@ -117,83 +340,244 @@ std::optional<SSTableEntry> SSTable::get(const std::string& key) const {
     if (index_.empty()) return std::nullopt;
     if (key < min_key_ || key > max_key_) return std::nullopt;
 
-    uint64_t startOffset = findOffset(key);
-    
-    std::ifstream file(path_, std::ios::binary);
-    file.seekg(startOffset);
-
-    for (size_t i = 0; i < INDEX_INTERVAL + 1 && file.peek() != EOF; i++) {
-        uint64_t currentOffset = file.tellg();
-        auto entry = readEntryAt(currentOffset);
-        
-        if (!entry) break;
-        
-        if (entry->key == key) {
-            return entry;
-        }
-        if (entry->key > key) {
-            break;
+    BlockCache::Block holder;
+    BlockCursor cursor(blockData(findBlock(key), holder), format_version_);
+    if (cursor.seek(key) && cursor.key() == key) {
+        return SSTableEntry{key, std::string(cursor.value()), cursor.deleted()};
+    }
+    return std::nullopt;
+}
+
+size_t SSTable::findBlock(std::string_view key) const {
+    auto it = std::upper_bound(index_.begin(), index_.end(), key,
+        [](std::string_view k, const IndexEntry& e) { return k < e.key; });
+
+    if (it == index_.begin()) {
+        return 0;
+    }
+    return std::prev(it) - index_.begin();
+}
+
+uint64_t SSTable::blockEnd(size_t block) const {
+    return (block + 1 < index_.size()) ? index_[block + 1].offset : data_end_;
+}
+
+std::string_view SSTable::blockData(size_t block, BlockCache::Block& holder) const {
+    uint64_t start = index_[block].offset;
+    uint64_t end = blockEnd(block);
+
+    if (map_) {
+        return std::string_view(map_ + start, end - start);
+    }
+
+    holder = readBlock(block);
+    return *holder;
+}
+
+BlockCache::Block SSTable::readBlock(size_t block) const {
+    uint64_t start = index_[block].offset;
+    uint64_t end = blockEnd(block);
+
+    BlockCache& cache = BlockCache::global();
+    bool cached = cache.capacity() > 0;
+
+    if (cached) {
+        if (auto hit = cache.lookup(cache_id_, start)) {
+            return hit;
         }
-        
-        file.seekg(currentOffset);
-        uint8_t deleted;
-        file.read(reinterpret_cast<char*>(&deleted), sizeof(deleted));
-        uint32_t keyLen, valLen;
-        file.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen));
-        file.seekg(keyLen, std::ios::cur);
-        file.read(reinterpret_cast<char*>(&valLen), sizeof(valLen));
-        file.seekg(valLen, std::ios::cur);
     }
 
-    return std::nullopt;
+    auto data = std::make_shared<const std::string>(readRange(start, end - start));
+    if (cached) {
+        cache.insert(cache_id_, start, data);
+    }
+    return data;
 }
 
-std::optional<SSTableEntry> SSTable::readEntryAt(uint64_t offset) const {
+std::string SSTable::readRange(uint64_t offset, size_t len) const {
+    std::string data(len, '\0');
+#ifdef _WIN32
     std::ifstream file(path_, std::ios::binary);
     file.seekg(offset);
+    if (!file.read(data.data(), len)) {
+        throw std::runtime_error("Failed to read SSTable: " + path_);
+    }
+#else
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = ::pread(fd_, data.data() + done, len - done, offset + done);
+        if (n <= 0) {
+            throw std::runtime_error("Failed to read SSTable: " + path_);
+        }
+        done += n;
+    }
+#endif
+    return data;
+}
+
+bool SSTable::mightContain(const std::string& key) const {
+    if (index_.empty()) return false;
+    if (key < min_key_ || key > max_key_) return false;
+    return bloom_.mightContain(key);
+}
+
+// ==================== SSTable::BlockCursor ====================
 
-    SSTableEntry entry;
-    
-    uint8_t deleted;
-    if (!file.read(reinterpret_cast<char*>(&deleted), sizeof(deleted))) {
-        return std::nullopt;
+SSTable::BlockCursor::BlockCursor(std::string_view block, uint32_t version)
+    : data_(block.data()), p_(block.data()), end_(block.data() + block.size()), version_(version) {
+    if (version_ < 2) {
+        return;
     }
-    entry.deleted = deleted != 0;
 
-    uint32_t keyLen;
-    if (!file.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen))) {
-        return std::nullopt;
+    uint32_t numRestarts = 0;
+    if (block.size() >= sizeof(numRestarts)) {
+        std::memcpy(&numRestarts, end_ - sizeof(numRestarts), sizeof(numRestarts));
     }
-    entry.key.resize(keyLen);
-    if (!file.read(entry.key.data(), keyLen)) {
-        return std::nullopt;
+    uint64_t trailer = (static_cast<uint64_t>(numRestarts) + 1) * sizeof(uint32_t);
+    if (numRestarts == 0 || trailer > block.size()) {
+        end_ = p_;  // Corrupt block: expose no records
+        return;
     }
+    num_restarts_ = numRestarts;
+    end_ -= trailer;
+}
 
-    uint32_t valLen;
-    if (!file.read(reinterpret_cast<char*>(&valLen), sizeof(valLen))) {
-        return std::nullopt;
+bool SSTable::BlockCursor::next() {
+    if (version_ < 2) {
+        RecordView record;
+        if (!parseRecord(p_, end_, record)) {
+            return false;
+        }
+        key_.assign(record.key.data(), record.key.size());
+        value_ = record.value;
+        deleted_ = record.deleted;
+        return true;
+    }
+
+    if (p_ >= end_) {
+        return false;
     }
-    entry.value.resize(valLen);
-    if (!file.read(entry.value.data(), valLen)) {
-        return std::nullopt;
+    BlockEntryHeader h;
+    const char* suffix = decodeEntry(p_, end_, h);
+    if (!suffix || h.shared > key_.size()) {
+        p_ = end_;
+        return false;
     }
+    key_.resize(h.shared);
+    key_.append(suffix, h.unshared);
+    value_ = std::string_view(suffix + h.unshared, h.valLen);
+    deleted_ = h.deleted;
+    p_ = suffix + h.unshared + h.valLen;
+    return true;
+}
 
-    return entry;
+bool SSTable::BlockCursor::restartKey(uint32_t restart, std::string_view& key) const {
+    uint32_t offset;
+    std::memcpy(&offset, end_ + restart * sizeof(uint32_t), sizeof(offset));
+    if (offset >= static_cast<size_t>(end_ - data_)) {
+        return false;
+    }
+    BlockEntryHeader h;
+    const char* suffix = decodeEntry(data_ + offset, end_, h);
+    if (!suffix || h.shared != 0) {
+        return false;
+    }
+    key = std::string_view(suffix, h.unshared);
+    return true;
 }
 
-uint64_t SSTable::findOffset(const std::string& key) const {
-    auto it = std::upper_bound(index_.begin(), index_.end(), key,
-        [](const std::string& k, const IndexEntry& e) { return k < e.key; });
-    
-    if (it == index_.begin()) {
-        return 0;
+bool SSTable::BlockCursor::seek(std::string_view target) {
+    if (version_ >= 2 && num_restarts_ > 0) {
+        // Find the last restart point whose key is < target, then scan from it
+        uint32_t lo = 0, hi = num_restarts_ - 1;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi + 1) / 2;
+            std::string_view key;
+            if (!restartKey(mid, key)) {
+                return false;
+            }
+            if (key < target) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        uint32_t offset;
+        std::memcpy(&offset, end_ + lo * sizeof(uint32_t), sizeof(offset));
+        p_ = data_ + std::min<size_t>(offset, end_ - data_);
+        key_.clear();
+    }
+
+    while (next()) {
+        if (std::string_view(key_) >= target) {
+            return true;
+        }
     }
-    return std::prev(it)->offset;
+    return false;
 }
 
-bool SSTable::mightContain(const std::string& key) const {
-    if (index_.empty()) return false;
-    return key >= min_key_ && key <= max_key_;
+// ==================== SSTable::Iterator ====================
+
+SSTable::Iterator::Iterator(const SSTable& table, bool fill_cache)
+    : table_(table), fill_cache_(fill_cache) {
+    if (!table_.index_.empty()) {
+        loadBlock(0);
+    }
+    next();
+}
+
+void SSTable::Iterator::loadBlock(size_t block) {
+    block_ = block;
+    if (fill_cache_) {
+        cursor_ = BlockCursor(table_.blockData(block, holder_), table_.format_version_);
+    } else {
+        uint64_t start = table_.index_[block].offset;
+        data_ = table_.readRange(start, table_.blockEnd(block) - start);
+        cursor_ = BlockCursor(data_, table_.format_version_);
+    }
+}
+
+void SSTable::Iterator::setCurrent() {
+    current_.key.assign(cursor_.key().data(), cursor_.key().size());
+    current_.value.assign(cursor_.value().data(), cursor_.value().size());
+    current_.deleted = cursor_.deleted();
+    valid_ = true;
+}
+
+void SSTable::Iterator::next() {
+    while (block_ < table_.index_.size()) {
+        if (cursor_.next()) {
+            setCurrent();
+            return;
+        }
+        if (block_ + 1 < table_.index_.size()) {
+            loadBlock(block_ + 1);
+        } else {
+            block_++;
+        }
+    }
+    valid_ = false;
+}
+
+void SSTable::Iterator::seek(std::string_view target) {
+    if (table_.index_.empty()) {
+        valid_ = false;
+        return;
+    }
+
+    loadBlock(table_.findBlock(target));
+    if (cursor_.seek(target)) {
+        setCurrent();
+        return;
+    }
+
+    // Everything in this block sorts before target; start at the next one
+    if (block_ + 1 < table_.index_.size()) {
+        loadBlock(block_ + 1);
+    } else {
+        block_++;
+    }
+    next();
 }
 
 } // namespace dkv
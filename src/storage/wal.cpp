@@ -1,123 +1,480 @@
 #include "storage/wal.hpp"
+#include "storage/crc32c.hpp"
+#include "storage/file_sync.hpp"
+#include "storage/write_batch.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
 #include <stdexcept>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 namespace dkv {
 
-WAL::WAL(const std::string& path) : path_(path) {
-    file_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::app);
-    if (!file_.is_open()) {
-        file_.open(path_, std::ios::out | std::ios::binary);
-        file_.close();
-        file_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::app);
+namespace {
+
+constexpr char MAGIC[8] = {'D', 'K', 'V', 'W', 'A', 'L', '0', '1'};
+constexpr size_t BUFFER_LIMIT = 64 * 1024;     // NONE mode writes once this much is pending
+constexpr size_t READ_CHUNK = 1024 * 1024;     // Replay reads the file this much at a time
+constexpr size_t FRAME_SIZE = 4 + 4;           // crc | length
+constexpr size_t KEY_HEADER_SIZE = 1 + 4;      // op | keyLen
+constexpr size_t HEADER_SIZE = FRAME_SIZE + KEY_HEADER_SIZE;
+constexpr int MAX_IOV = 1024;
+
+#ifdef _WIN32
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
+#endif
+
+int openFd(const std::string& path, bool write) {
+#ifdef _WIN32
+    int flags = write ? (_O_RDWR | _O_CREAT | _O_APPEND) : _O_RDONLY;
+    return ::_open(path.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int flags = write ? (O_RDWR | O_CREAT | O_APPEND) : O_RDONLY;
+    return ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+#endif
+}
+
+void closeFd(int fd) {
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+uint64_t fileSize(int fd) {
+#ifdef _WIN32
+    struct _stat64 st;
+    return ::_fstat64(fd, &st) == 0 ? st.st_size : 0;
+#else
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? st.st_size : 0;
+#endif
+}
+
+void writeFully(int fd, iovec* iov, int count, const std::string& path) {
+    while (count > 0) {
+#ifdef _WIN32
+        int n = ::_write(fd, iov->iov_base, static_cast<unsigned>(iov->iov_len));
+#else
+        ssize_t n = ::writev(fd, iov, std::min(count, MAX_IOV));
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to write WAL: " + path + ": " + std::strerror(errno));
+        }
+
+        // Skip the fully written slices and trim a partially written one
+        size_t written = static_cast<size_t>(n);
+        while (count > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
     }
-    if (!file_.is_open()) {
-        throw std::runtime_error("Failed to open WAL file: " + path_);
+}
+
+void syncFd(int fd, const std::string& path) {
+#if defined(_WIN32)
+    int rc = ::_commit(fd);
+#elif defined(__APPLE__)
+    int rc = ::fsync(fd);
+#else
+    int rc = ::fdatasync(fd);
+#endif
+    if (rc != 0) {
+        throw std::runtime_error("Failed to sync WAL: " + path + ": " + std::strerror(errno));
     }
 }
 
-WAL::~WAL() {
-    if (file_.is_open()) {
-        file_.flush();
-        file_.close();
+void truncateFd(int fd, uint64_t size, const std::string& path) {
+#ifdef _WIN32
+    int rc = ::_chsize_s(fd, static_cast<__int64>(size));
+#else
+    int rc = ::ftruncate(fd, static_cast<off_t>(size));
+#endif
+    if (rc != 0) {
+        throw std::runtime_error("Failed to truncate WAL: " + path);
     }
 }
 
-bool WAL::append(OpType op, const std::string& key, const std::string& value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    LogEntry entry{op, key, value};
-    writeEntry(entry);
-    file_.flush();
-    
+/**
+ * Sequential reader that keeps at least the requested number of bytes
+ * contiguous in memory, refilling in READ_CHUNK reads.
+ */
+class ChunkReader {
+public:
+    explicit ChunkReader(const std::string& path) : path_(path), fd_(openFd(path, false)) {
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open WAL file: " + path_);
+        }
+        size_ = fileSize(fd_);
+    }
+
+    ~ChunkReader() { closeFd(fd_); }
+
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator=(const ChunkReader&) = delete;
+
+    // False if the file ends before n more bytes
+    bool fill(size_t n) {
+        if (end_ - pos_ >= n) return true;
+        if (n > remaining()) return false;
+
+        std::memmove(buf_.data(), buf_.data() + pos_, end_ - pos_);
+        end_ -= pos_;
+        pos_ = 0;
+        buf_.resize(std::max(n, READ_CHUNK));
+
+        while (end_ < n) {
+#ifdef _WIN32
+            int got = ::_read(fd_, buf_.data() + end_, static_cast<unsigned>(buf_.size() - end_));
+#else
+            ssize_t got = ::read(fd_, buf_.data() + end_, buf_.size() - end_);
+#endif
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) {
+                throw std::runtime_error("Failed to read WAL: " + path_ + ": " + std::strerror(errno));
+            }
+            if (got == 0) return false;
+            end_ += got;
+        }
+        return true;
+    }
+
+    const char* data() const { return buf_.data() + pos_; }
+    void consume(size_t n) { pos_ += n; offset_ += n; }
+    uint64_t offset() const { return offset_; }
+    uint64_t remaining() const { return size_ - offset_; }
+
+private:
+    std::string path_;
+    int fd_;
+    uint64_t size_ = 0;
+    uint64_t offset_ = 0;
+    std::vector<char> buf_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+};
+
+// payload: op | keyLen | key | valLen | value
+bool decodePayload(const char* p, size_t len, LogEntry& entry) {
+    uint32_t keyLen, valLen;
+    if (len < KEY_HEADER_SIZE + sizeof(valLen)) return false;
+
+    std::memcpy(&keyLen, p + 1, sizeof(keyLen));
+    if (keyLen > len - KEY_HEADER_SIZE - sizeof(valLen)) return false;
+
+    std::memcpy(&valLen, p + KEY_HEADER_SIZE + keyLen, sizeof(valLen));
+    if (valLen != len - KEY_HEADER_SIZE - keyLen - sizeof(valLen)) return false;
+
+    entry.op = static_cast<OpType>(static_cast<uint8_t>(p[0]));
+    if (entry.op != OpType::PUT && entry.op != OpType::DELETE && entry.op != OpType::BATCH) {
+        return false;
+    }
+
+    entry.key.assign(p + KEY_HEADER_SIZE, keyLen);
+    entry.value.assign(p + KEY_HEADER_SIZE + keyLen + sizeof(valLen), valLen);
     return true;
 }
 
-void WAL::writeEntry(const LogEntry& entry) {
-    uint8_t op = static_cast<uint8_t>(entry.op);
-    file_.write(reinterpret_cast<const char*>(&op), sizeof(op));
+// Records written before framing: op | keyLen | key | valLen | value
+bool readLegacyEntry(ChunkReader& reader, LogEntry& entry) {
+    uint32_t keyLen, valLen;
 
-    uint32_t keyLen = static_cast<uint32_t>(entry.key.size());
-    file_.write(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
-    file_.write(entry.key.data(), keyLen);
+    if (!reader.fill(KEY_HEADER_SIZE)) return false;
+    std::memcpy(&keyLen, reader.data() + 1, sizeof(keyLen));
+    if (!reader.fill(KEY_HEADER_SIZE + keyLen + sizeof(valLen))) return false;
+
+    std::memcpy(&valLen, reader.data() + KEY_HEADER_SIZE + keyLen, sizeof(valLen));
+    size_t len = KEY_HEADER_SIZE + keyLen + sizeof(valLen) + valLen;
+    if (!reader.fill(len)) return false;
+
+    bool ok = decodePayload(reader.data(), len, entry);
+    reader.consume(len);
+    return ok;
+}
 
+// Fill the 13-byte record header and 4-byte value length; returns the frame size
+size_t encodeHeader(const LogEntry& entry, char* header, char* valLenOut) {
+    uint8_t op = static_cast<uint8_t>(entry.op);
+    uint32_t keyLen = static_cast<uint32_t>(entry.key.size());
     uint32_t valLen = static_cast<uint32_t>(entry.value.size());
-    file_.write(reinterpret_cast<const char*>(&valLen), sizeof(valLen));
-    file_.write(entry.value.data(), valLen);
+    uint32_t len = static_cast<uint32_t>(KEY_HEADER_SIZE + keyLen + sizeof(valLen) + valLen);
+
+    std::memcpy(header + FRAME_SIZE, &op, sizeof(op));
+    std::memcpy(header + FRAME_SIZE + sizeof(op), &keyLen, sizeof(keyLen));
+    std::memcpy(valLenOut, &valLen, sizeof(valLen));
+
+    uint32_t crc = crc32c(header + FRAME_SIZE, KEY_HEADER_SIZE);
+    crc = crc32c(entry.key.data(), keyLen, crc);
+    crc = crc32c(valLenOut, sizeof(valLen), crc);
+    crc = crc32c(entry.value.data(), valLen, crc);
+
+    std::memcpy(header, &crc, sizeof(crc));
+    std::memcpy(header + sizeof(crc), &len, sizeof(len));
+    return FRAME_SIZE + len;
 }
 
-std::vector<LogEntry> WAL::recover() {
-    std::lock_guard<std::mutex> lock(mutex_);
+} // namespace
+
+WAL::WAL(const std::string& path, WALOptions options) : path_(path), options_(options) {
+    openFile();
+
+    if (options_.sync_mode == WALSyncMode::PERIODIC) {
+        sync_thread_ = std::thread(&WAL::syncLoop, this);
+    }
+}
+
+WAL::~WAL() {
+    if (sync_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        sync_cv_.notify_all();
+        sync_thread_.join();
+    }
+
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flushBuffer();
+        if (options_.sync_mode == WALSyncMode::PERIODIC && dirty_) {
+            syncFd(fd_, path_);
+        }
+    } catch (...) {
+    }
+
+    closeFd(fd_);
+}
+
+void WAL::openFile() {
+    fd_ = openFd(path_, true);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open WAL file: " + path_);
+    }
+
+    if (fileSize(fd_) == 0) {
+        iovec iov{const_cast<char*>(MAGIC), sizeof(MAGIC)};
+        writeFully(fd_, &iov, 1, path_);
+        // fdatasync on appends doesn't make the new file's name durable
+        if (options_.sync_mode == WALSyncMode::FDATASYNC ||
+            options_.sync_mode == WALSyncMode::PERIODIC) {
+            syncFd(fd_, path_);
+            std::string dir = std::filesystem::path(path_).parent_path().string();
+            syncPath(dir.empty() ? "." : dir);
+        }
+        return;
+    }
+
+    ChunkReader reader(path_);
+    if (!reader.fill(sizeof(MAGIC)) || std::memcmp(reader.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        upgradeLegacyFormat();
+    }
+}
+
+void WAL::upgradeLegacyFormat() {
     std::vector<LogEntry> entries;
+    {
+        ChunkReader reader(path_);
+        LogEntry entry;
+        while (readLegacyEntry(reader, entry)) {
+            entries.push_back(std::move(entry));
+        }
+    }
 
-    file_.seekg(0, std::ios::beg);
-    file_.clear();
+    // Rewrite into a temp file and swap it in, so a crash leaves one intact copy
+    std::string tmp_path = path_ + ".tmp";
+    std::filesystem::remove(tmp_path);
+    {
+        WAL upgraded(tmp_path, WALOptions{WALSyncMode::FLUSH});
+        upgraded.appendBatch(entries);
+        upgraded.sync();
+    }
+    closeFd(fd_);
+    std::filesystem::rename(tmp_path, path_);
 
-    while (hasMore()) {
+    fd_ = openFd(path_, true);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open WAL file: " + path_);
+    }
+}
+
+bool WAL::append(OpType op, const std::string& key, const std::string& value) {
+    appendBatch({LogEntry{op, key, value}});
+    return true;
+}
+
+void WAL::appendBatch(const std::vector<LogEntry>& entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (options_.sync_mode == WALSyncMode::NONE) {
+        writeBuffered(entries);
+        return;
+    }
+
+    writeDirect(entries);
+    if (options_.sync_mode == WALSyncMode::FDATASYNC) {
+        syncFd(fd_, path_);
+    } else {
+        dirty_ = true;
+    }
+}
+
+void WAL::writeBuffered(const std::vector<LogEntry>& entries) {
+    for (const auto& entry : entries) {
+        char header[HEADER_SIZE];
+        char valLen[sizeof(uint32_t)];
+        encodeHeader(entry, header, valLen);
+
+        buffer_.append(header, HEADER_SIZE);
+        buffer_.append(entry.key);
+        buffer_.append(valLen, sizeof(valLen));
+        buffer_.append(entry.value);
+    }
+
+    if (buffer_.size() >= BUFFER_LIMIT) {
+        flushBuffer();
+    }
+}
+
+void WAL::writeDirect(const std::vector<LogEntry>& entries) {
+    // Headers are staged in one array; keys and values are written in place
+    std::vector<char> headers(entries.size() * (HEADER_SIZE + sizeof(uint32_t)));
+    std::vector<iovec> iov;
+    iov.reserve(entries.size() * 4);
+
+    char* h = headers.data();
+    for (const auto& entry : entries) {
+        encodeHeader(entry, h, h + HEADER_SIZE);
+
+        iov.push_back({h, HEADER_SIZE});
+        iov.push_back({const_cast<char*>(entry.key.data()), entry.key.size()});
+        iov.push_back({h + HEADER_SIZE, sizeof(uint32_t)});
+        iov.push_back({const_cast<char*>(entry.value.data()), entry.value.size()});
+        h += HEADER_SIZE + sizeof(uint32_t);
+    }
+
+    writeFully(fd_, iov.data(), static_cast<int>(iov.size()), path_);
+}
+
+void WAL::flushBuffer() {
+    if (buffer_.empty()) {
+        return;
+    }
+    iovec iov{buffer_.data(), buffer_.size()};
+    writeFully(fd_, &iov, 1, path_);
+    buffer_.clear();
+    dirty_ = true;
+}
+
+void WAL::syncLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto interval = std::chrono::milliseconds(options_.sync_interval_ms);
+
+    while (!sync_cv_.wait_for(lock, interval, [this] { return stop_; })) {
+        if (!dirty_.exchange(false)) {
+            continue;
+        }
+        // fdatasync can take milliseconds; don't hold up appenders meanwhile
+        lock.unlock();
         try {
-            entries.push_back(readEntry());
+            syncFd(fd_, path_);
         } catch (...) {
-            break;
+            dirty_ = true;
         }
+        lock.lock();
     }
+}
 
-    file_.clear();
-    file_.seekp(0, std::ios::end);
+size_t WAL::replay(const ReplayFn& fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushBuffer();
 
-    return entries;
-}
+    ChunkReader reader(path_);
+    if (!reader.fill(sizeof(MAGIC))) {
+        return 0;
+    }
+    reader.consume(sizeof(MAGIC));
 
-LogEntry WAL::readEntry() {
+    size_t count = 0;
     LogEntry entry;
+    WriteBatch batch;
+    while (reader.fill(FRAME_SIZE)) {
+        uint32_t crc, len;
+        std::memcpy(&crc, reader.data(), sizeof(crc));
+        std::memcpy(&len, reader.data() + sizeof(crc), sizeof(len));
 
-    uint8_t op;
-    file_.read(reinterpret_cast<char*>(&op), sizeof(op));
-    if (file_.gcount() != sizeof(op)) {
-        throw std::runtime_error("Failed to read op");
-    }
-    entry.op = static_cast<OpType>(op);
+        // A corrupt length must not send us allocating past the end of the file
+        if (len > reader.remaining() - FRAME_SIZE || !reader.fill(FRAME_SIZE + len)) break;
 
-    uint32_t keyLen;
-    file_.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen));
-    if (file_.gcount() != sizeof(keyLen)) {
-        throw std::runtime_error("Failed to read key length");
+        const char* payload = reader.data() + FRAME_SIZE;
+        if (crc32c(payload, len) != crc || !decodePayload(payload, len, entry)) break;
+
+        if (entry.op == OpType::BATCH) {
+            if (!batch.setData(std::move(entry.value))) break;
+            batch.forEach([&fn](OpType op, std::string_view key, std::string_view value) {
+                fn(LogEntry{op, std::string(key), std::string(value)});
+            });
+            count += batch.count();
+        } else {
+            fn(entry);
+            count++;
+        }
+        reader.consume(FRAME_SIZE + len);
     }
-    entry.key.resize(keyLen);
-    file_.read(entry.key.data(), keyLen);
 
-    uint32_t valLen;
-    file_.read(reinterpret_cast<char*>(&valLen), sizeof(valLen));
-    if (file_.gcount() != sizeof(valLen)) {
-        throw std::runtime_error("Failed to read value length");
+    if (reader.remaining() > 0) {
+        // Torn write or corruption: drop the tail so new appends follow the last good record
+        std::cerr << "[WAL] " << path_ << ": discarding " << reader.remaining()
+                  << " bytes after offset " << reader.offset() << " (torn or corrupt record)"
+                  << std::endl;
+        truncateFd(fd_, reader.offset(), path_);
     }
-    entry.value.resize(valLen);
-    file_.read(entry.value.data(), valLen);
 
-    return entry;
+    return count;
 }
 
-bool WAL::hasMore() {
-    auto pos = file_.tellg();
-    char c;
-    if (!file_.get(c)) {
-        return false;
-    }
-    file_.seekg(pos);
-    return true;
+std::vector<LogEntry> WAL::recover() {
+    std::vector<LogEntry> entries;
+    replay([&entries](const LogEntry& entry) { entries.push_back(entry); });
+    return entries;
 }
 
 void WAL::checkpoint() {
     std::lock_guard<std::mutex> lock(mutex_);
-    file_.close();
-    
-    std::ofstream clear(path_, std::ios::binary | std::ios::trunc);
-    clear.close();
-    
-    file_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::app);
+    buffer_.clear();
+
+    truncateFd(fd_, 0, path_);
+    iovec iov{const_cast<char*>(MAGIC), sizeof(MAGIC)};
+    writeFully(fd_, &iov, 1, path_);
 }
 
 void WAL::sync() {
     std::lock_guard<std::mutex> lock(mutex_);
-    file_.flush();
+    flushBuffer();
+    syncFd(fd_, path_);
+    dirty_ = false;
 }
 
 } // namespace dkv
@@ -0,0 +1,104 @@
+#include "storage/write_batch.hpp"
+#include <cstring>
+
+namespace dkv {
+
+namespace {
+
+constexpr size_t COUNT_SIZE = sizeof(uint32_t);
+constexpr size_t ENTRY_HEADER_SIZE = 1 + sizeof(uint32_t);  // op | keyLen
+
+// Decode the entry at p; returns the position after it, or nullptr if it
+// runs past end or isn't a PUT or DELETE
+const char* decodeEntry(const char* p, const char* end, OpType& op,
+                        std::string_view& key, std::string_view& value) {
+    uint32_t keyLen, valLen;
+    if (static_cast<size_t>(end - p) < ENTRY_HEADER_SIZE) return nullptr;
+
+    op = static_cast<OpType>(static_cast<uint8_t>(p[0]));
+    if (op != OpType::PUT && op != OpType::DELETE) return nullptr;
+
+    std::memcpy(&keyLen, p + 1, sizeof(keyLen));
+    p += ENTRY_HEADER_SIZE;
+    if (static_cast<size_t>(end - p) < keyLen + sizeof(valLen)) return nullptr;
+    key = std::string_view(p, keyLen);
+    p += keyLen;
+
+    std::memcpy(&valLen, p, sizeof(valLen));
+    p += sizeof(valLen);
+    if (static_cast<size_t>(end - p) < valLen) return nullptr;
+    value = std::string_view(p, valLen);
+    return p + valLen;
+}
+
+} // namespace
+
+WriteBatch::WriteBatch() {
+    clear();
+}
+
+void WriteBatch::put(std::string_view key, std::string_view value) {
+    append(OpType::PUT, key, value);
+}
+
+void WriteBatch::del(std::string_view key) {
+    append(OpType::DELETE, key, {});
+}
+
+void WriteBatch::clear() {
+    rep_.assign(COUNT_SIZE, '\0');
+    count_ = 0;
+}
+
+void WriteBatch::append(OpType op, std::string_view key, std::string_view value) {
+    uint32_t keyLen = static_cast<uint32_t>(key.size());
+    uint32_t valLen = static_cast<uint32_t>(value.size());
+
+    rep_.push_back(static_cast<char>(op));
+    rep_.append(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
+    rep_.append(key);
+    rep_.append(reinterpret_cast<const char*>(&valLen), sizeof(valLen));
+    rep_.append(value);
+
+    count_++;
+    std::memcpy(rep_.data(), &count_, sizeof(count_));
+}
+
+void WriteBatch::forEach(const Handler& fn) const {
+    const char* p = rep_.data() + COUNT_SIZE;
+    const char* end = rep_.data() + rep_.size();
+
+    OpType op;
+    std::string_view key, value;
+    for (uint32_t i = 0; i < count_; i++) {
+        p = decodeEntry(p, end, op, key, value);  // Validated when built or adopted
+        fn(op, key, value);
+    }
+}
+
+bool WriteBatch::setData(std::string data) {
+    uint32_t count;
+    if (data.size() < COUNT_SIZE) {
+        clear();
+        return false;
+    }
+    std::memcpy(&count, data.data(), sizeof(count));
+
+    const char* p = data.data() + COUNT_SIZE;
+    const char* end = data.data() + data.size();
+    OpType op;
+    std::string_view key, value;
+    for (uint32_t i = 0; i < count && p; i++) {
+        p = decodeEntry(p, end, op, key, value);
+    }
+    if (p != end) {
+        clear();
+        return false;
+    }
+
+    rep_ = std::move(data);
+    count_ = count;
+    return true;
+}
+
+} // namespace dkv